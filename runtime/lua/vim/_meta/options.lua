@@ -98,6 +98,29 @@ vim.o.arshape = vim.o.arabicshape
 vim.go.arabicshape = vim.o.arabicshape
 vim.go.arshape = vim.go.arabicshape
 
+--- Minimal size of a buffer in Kbyte to write it in the background.
+--- When `:write` or `:update` writes at least this much text to the file
+--- being edited, Nvim takes a snapshot of the buffer and a worker thread
+--- writes it to a new file next to the original one.  Only
+--- when that is done the new file replaces the original, the
+--- `BufWritePost` autocommands are triggered and, when the buffer was
+--- not changed in the meantime, 'modified' is reset.  Editing can
+--- continue while a big file is being written.
+--- Only used for an existing file that needs no conversion, is not a
+--- link, is owned by the user, with 'fileformat' "unix" or "dos", and
+--- when 'backup' and 'patchmode' are not set and 'backupcopy' does not
+--- include "yes".  Otherwise, or when the value is zero, the buffer is
+--- written as usual.
+--- A command that follows, such as in ":w | !make", may run before
+--- writing is done.  Writing the buffer again, or abandoning or
+--- unloading it, first waits for the write to finish.
+---
+--- @type integer
+vim.o.asyncwrite = 0
+vim.o.awr = vim.o.asyncwrite
+vim.go.asyncwrite = vim.o.asyncwrite
+vim.go.awr = vim.go.asyncwrite
+
 --- When on, Vim will change the current working directory whenever you
 --- open a file, switch buffers, delete a buffer or open/close a window.
 --- It will change to the directory containing the file which was opened
@@ -2531,6 +2554,25 @@ vim.o.ft = vim.o.filetype
 vim.bo.filetype = vim.o.filetype
 vim.bo.ft = vim.bo.filetype
 
+--- When on, the files of loaded buffers are watched for changes made
+--- outside of Nvim, using the file system notifications of the operating
+--- system.  A change marks the buffer, and when checking timestamps
+--- `timestamp` only the marked buffers are looked at, instead of getting
+--- the file info for every buffer.  For a buffer with 'autoread' set
+--- that was not changed in Nvim, the file is read again as soon as the
+--- change is noticed, without waiting for focus to return to Nvim or a
+--- shell command to finish.
+--- Buffers whose file cannot be watched are always checked.  Switch this
+--- option off for file systems that do not report all changes, e.g. a
+--- network file system where the file may be changed on another
+--- machine.  `:checktime` always checks all buffers.
+---
+--- @type boolean
+vim.o.filewatch = true
+vim.o.fw = vim.o.filewatch
+vim.go.filewatch = vim.o.filewatch
+vim.go.fw = vim.go.filewatch
+
 --- Characters to fill the statuslines, vertical separators, special
 --- lines in the window and truncated text in the `ins-completion-menu`.
 --- It is a comma-separated list of items.  Each item has a name, a colon
@@ -3972,6 +4014,28 @@ vim.o.ls = vim.o.laststatus
 vim.go.laststatus = vim.o.laststatus
 vim.go.ls = vim.go.laststatus
 
+--- Minimal size of a file in Kbyte to load it lazily.  When editing a
+--- file at least this big, Nvim keeps it open instead of reading it.
+--- A block of lines is read from the file when it is first used, and
+--- dropped again when it was not changed and has not been used for a
+--- while.  Opening a very large file is much faster and takes little
+--- memory this way.
+--- Only used for a file that needs no conversion (it is valid UTF-8 and
+--- has no BOM), is in "unix" 'fileformat' and when there is no
+--- 'undofile' to read.  Otherwise, or when the value is zero, the file
+--- is read as usual.
+--- Unchanged lines are read from the file as it is when they are used.
+--- Appending to the file does not change them.  When the file is changed
+--- or truncated in another way, lines read after that may be empty and a
+--- warning is given.  Writing the buffer to the file first reads all the
+--- lines.
+---
+--- @type integer
+vim.o.lazyload = 0
+vim.o.lzl = vim.o.lazyload
+vim.go.lazyload = vim.o.lazyload
+vim.go.lzl = vim.go.lazyload
+
 --- When this option is set, the screen will not be redrawn while
 --- executing macros, registers and other commands that have not been
 --- typed.  Also, updating the window title is postponed.  To force an
@@ -4422,6 +4486,21 @@ vim.o.msc = vim.o.maxsearchcount
 vim.go.maxsearchcount = vim.o.maxsearchcount
 vim.go.msc = vim.go.maxsearchcount
 
+--- Maximum amount of memory in Kbyte used for the text of a buffer that
+--- has no swap file.  When more is used, the blocks of lines that were
+--- not used for the longest time are compressed in memory, and they are
+--- uncompressed again when used.  This makes a big buffer without a
+--- swap file take much less memory, at the cost of some time when
+--- jumping around in it.
+--- When the value is zero nothing is compressed.  See `nvim__stats()`
+--- for how well it works.
+---
+--- @type integer
+vim.o.memcompress = 0
+vim.o.mcm = vim.o.memcompress
+vim.go.memcompress = vim.o.memcompress
+vim.go.mcm = vim.go.memcompress
+
 --- Maximum number of items to use in a menu.  Used for menus that are
 --- generated from a list of items, e.g., the Buffers menu.  Changing this
 --- option has no direct effect, the menu must be refreshed first.
@@ -5212,6 +5291,19 @@ vim.o.rdb = vim.o.redrawdebug
 vim.go.redrawdebug = vim.o.redrawdebug
 vim.go.rdb = vim.go.redrawdebug
 
+--- Maximum number of screen updates per second for redrawing caused by
+--- events, such as job output, RPC requests and timers.  Redraws asked
+--- for in between are combined into the next update.  Typed keys are
+--- always handled and displayed right away.
+--- When the value is zero there is no limit.  See `nvim__stats()` for
+--- the number of combined and skipped updates.
+---
+--- @type integer
+vim.o.redrawrate = 0
+vim.o.rdr = vim.o.redrawrate
+vim.go.redrawrate = vim.o.redrawrate
+vim.go.rdr = vim.go.redrawrate
+
 --- Time in milliseconds for redrawing the display.  Applies to
 --- 'hlsearch', 'inccommand', `:match` highlighting, syntax highlighting,
 --- and async `LanguageTree:parse()`.
@@ -81,6 +81,7 @@ local options_list = {
     { 'lines', N_ 'number of lines in the display' },
     { 'window', N_ 'number of lines to scroll for CTRL-F and CTRL-B' },
     { 'lazyredraw', N_ "don't redraw while executing macros" },
+    { 'redrawrate', N_ 'max number of redraws per second for events' },
     { 'redrawtime', N_ "timeout for 'hlsearch' and :match highlighting in msec" },
     { 'writedelay', N_ 'delay in msec for each char written to the display' },
     { 'redrawdebug', N_ 'change the way redrawing works (debug)' },
@@ -345,13 +346,17 @@ local options_list = {
     { 'autowriteall', N_ "as 'autowrite', but works with more commands" },
     { 'writeany', N_ 'always write without asking for confirmation' },
     { 'autoread', N_ 'automatically read a file when it was modified outside of Vim' },
+    { 'filewatch', N_ 'watch files of buffers for changes' },
     { 'patchmode', N_ 'keep oldest version of a file; specifies file name extension' },
     { 'fsync', N_ 'forcibly sync the file to disk after writing it' },
+    { 'asyncwrite', N_ 'minimal size in Kbyte for writing in the background' },
+    { 'lazyload', N_ 'minimal file size in Kbyte for lazy loading' },
   },
   {
     header = N_ 'the swap file',
     { 'directory', N_ 'list of directories for the swap file' },
     { 'swapfile', N_ 'use a swap file for this buffer' },
+    { 'memcompress', N_ 'max memory in Kbyte used for uncompressed text without a swap file' },
     { 'updatecount', N_ 'number of characters typed to cause a swap file update' },
     { 'updatetime', N_ 'time in msec after which the swap file will be updated' },
   },
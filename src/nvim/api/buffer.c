@@ -406,14 +406,18 @@ void nvim_buf_set_lines(uint64_t channel_id, Buffer buffer, Integer start, Integ
     }
 
     // Now we may need to insert the remaining new old_len
+    mlbulk_T bulk;
+    ml_append_bulk_start(&bulk, buf, (linenr_T)(start + (int64_t)to_replace - 1), 0);
     for (size_t i = to_replace; i < new_len; i++) {
       int64_t lnum = start + (int64_t)i - 1;
 
       VALIDATE(lnum < MAXLNUM, "%s", "Index out of bounds", {
+        ml_append_bulk_end(&bulk);
         goto end;
       });
 
-      if (ml_append_buf(buf, (linenr_T)lnum, lines[i], 0, false) == FAIL) {
+      if (ml_append_bulk(&bulk, lines[i], 0) == FAIL) {
+        ml_append_bulk_end(&bulk);
         api_set_error(err, kErrorTypeException, "Failed to insert line");
         goto end;
       }
@@ -422,6 +426,10 @@ void nvim_buf_set_lines(uint64_t channel_id, Buffer buffer, Integer start, Integ
 
       extra++;
     }
+    if (ml_append_bulk_end(&bulk) == FAIL) {
+      api_set_error(err, kErrorTypeException, "Failed to insert line");
+      goto end;
+    }
 
     // Adjust marks. Invalidate any which lie in the
     // changed range, and move any in the remainder of the buffer.
@@ -637,20 +645,28 @@ void nvim_buf_set_text(uint64_t channel_id, Buffer buffer, Integer start_row, In
     }
 
     // Now we may need to insert the remaining new old_len
+    mlbulk_T bulk;
+    ml_append_bulk_start(&bulk, buf, (linenr_T)(start_row + (int64_t)to_replace - 1), 0);
     for (size_t i = to_replace; i < new_len; i++) {
       int64_t lnum = start_row + (int64_t)i - 1;
 
       VALIDATE((lnum < MAXLNUM), "%s", "Index out of bounds", {
+        ml_append_bulk_end(&bulk);
         goto end;
       });
 
-      if (ml_append_buf(buf, (linenr_T)lnum, lines[i], 0, false) == FAIL) {
+      if (ml_append_bulk(&bulk, lines[i], 0) == FAIL) {
+        ml_append_bulk_end(&bulk);
         api_set_error(err, kErrorTypeException, "Failed to insert line");
         goto end;
       }
 
       extra++;
     }
+    if (ml_append_bulk_end(&bulk) == FAIL) {
+      api_set_error(err, kErrorTypeException, "Failed to insert line");
+      goto end;
+    }
 
     colnr_T col_extent = (colnr_T)(end_col
                                    - ((end_row == start_row) ? start_col : 0));
@@ -1763,13 +1763,33 @@ Float nvim__id_float(Float flt)
 ///
 /// @return Map of various internal stats.
 Dict nvim__stats(Arena *arena)
+  FUNC_API_FAST
 {
-  Dict rv = arena_dict(arena, 6);
+  Dict rv = arena_dict(arena, 25);
   PUT_C(rv, "fsync", INTEGER_OBJ(g_stats.fsync));
   PUT_C(rv, "log_skip", INTEGER_OBJ(g_stats.log_skip));
+  PUT_C(rv, "memcompress_hit", INTEGER_OBJ(g_stats.memcompress_hit));
+  PUT_C(rv, "memcompress_miss", INTEGER_OBJ(g_stats.memcompress_miss));
+  PUT_C(rv, "memcompress_bytes", INTEGER_OBJ(g_stats.memcompress_bytes));
+  PUT_C(rv, "memcompress_size", INTEGER_OBJ(g_stats.memcompress_size));
+  PUT_C(rv, "linesize_hit", INTEGER_OBJ(g_stats.linesize_hit));
+  PUT_C(rv, "linesize_miss", INTEGER_OBJ(g_stats.linesize_miss));
+  PUT_C(rv, "regcache_hit", INTEGER_OBJ(g_stats.regcache_hit));
+  PUT_C(rv, "regcache_miss", INTEGER_OBJ(g_stats.regcache_miss));
+  PUT_C(rv, "hlcache_hit", INTEGER_OBJ(g_stats.hlcache_hit));
+  PUT_C(rv, "hlcache_miss", INTEGER_OBJ(g_stats.hlcache_miss));
+  PUT_C(rv, "blendcache_hit", INTEGER_OBJ(g_stats.blendcache_hit));
+  PUT_C(rv, "blendcache_miss", INTEGER_OBJ(g_stats.blendcache_miss));
+  PUT_C(rv, "rows_skipped", INTEGER_OBJ(g_stats.rows_skipped));
+  PUT_C(rv, "rows_drawn", INTEGER_OBJ(g_stats.rows_drawn));
+  PUT_C(rv, "tui_bytes", INTEGER_OBJ(g_stats.tui_bytes));
+  PUT_C(rv, "tui_frames", INTEGER_OBJ(g_stats.tui_frames));
+  PUT_C(rv, "frames_coalesced", INTEGER_OBJ(g_stats.frames_coalesced));
+  PUT_C(rv, "frames_dropped", INTEGER_OBJ(g_stats.frames_dropped));
   PUT_C(rv, "lua_refcount", INTEGER_OBJ(nlua_get_global_ref_count()));
   PUT_C(rv, "redraw", INTEGER_OBJ(g_stats.redraw));
   PUT_C(rv, "arena_alloc_count", INTEGER_OBJ((Integer)arena_alloc_count));
+  PUT_C(rv, "alloc_count", INTEGER_OBJ((Integer)mem_alloc_count));
   PUT_C(rv, "ts_query_parse_count", INTEGER_OBJ((Integer)tslua_query_parse_count));
   return rv;
 }
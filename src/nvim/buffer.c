@@ -74,6 +74,7 @@
 #include "nvim/mapping.h"
 #include "nvim/mark.h"
 #include "nvim/mark_defs.h"
+#include "nvim/match.h"
 #include "nvim/mbyte.h"
 #include "nvim/memfile_defs.h"
 #include "nvim/memline.h"
@@ -100,6 +101,7 @@
 #include "nvim/regexp_defs.h"
 #include "nvim/runtime.h"
 #include "nvim/runtime_defs.h"
+#include "nvim/search.h"
 #include "nvim/spell.h"
 #include "nvim/state_defs.h"
 #include "nvim/statusline.h"
@@ -864,6 +866,10 @@ void buf_freeall(buf_T *buf, int flags)
   }
 
   ml_close(buf, true);              // close and delete the memline/memfile
+  buf_watch_stop(buf);
+  linesize_cache_clear_buf(buf);
+  search_index_clear(buf);
+  hlsearch_cache_clear_buf(buf);
   buf->b_ml.ml_line_count = 0;      // no lines in buffer
   if ((flags & BFA_KEEP_UNDO) == 0) {
     // free the memory allocated for undo
@@ -2787,6 +2793,7 @@ void get_winopts(buf_T *buf)
 {
   clear_winopt(&curwin->w_onebuf_opt);
   clearFolding(curwin);
+  rowfp_clear_all();
 
   WinInfo *const wip = find_wininfo(buf, true, true);
   if (wip != NULL && wip->wi_win != curwin && wip->wi_win != NULL
@@ -3039,6 +3046,7 @@ int setfname(buf_T *buf, char *ffname_arg, char *sfname_arg, bool message)
     buf->file_id = file_id;
   }
 
+  buf_watch_stop(buf);  // watch the new file when it is read or written
   buf_name_changed(buf);
   return OK;
 }
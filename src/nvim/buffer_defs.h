@@ -73,6 +73,8 @@ typedef struct {
 
 typedef struct wininfo_S WinInfo;
 typedef struct frame_S frame_T;
+/// A write of a buffer done by a worker thread, see buf_write_async().
+typedef struct bufwrite bufwrite_T;
 typedef uint64_t disptick_T;  // display tick type
 
 // The taggy struct is used to store the information about a :tag command.
@@ -357,6 +359,29 @@ typedef struct {
 #define BUF_HAS_QF_ENTRY 1
 #define BUF_HAS_LL_ENTRY 2
 
+// Number of matches of the last search pattern in the lines of a buffer, for
+// the search count.  The lines are searched a part at a time, see
+// search_index_update().  Lines changed after they were searched are
+// searched again.
+typedef struct {
+  linenr_T sl_lnum;
+  int sl_count;                 // number of matches in line "sl_lnum"
+} SearchIndexLine;
+
+typedef struct {
+  kvec_t(SearchIndexLine) si_lines;  // lines with a match, in order
+  char *si_pat;                 // pattern the counts are for, NULL if none
+  size_t si_patlen;
+  bool si_magic;                // 'magic' of the pattern
+  bool si_ic;                   // ignoring case
+  bool si_match_end;            // 'cpoptions' contains 'c'
+  uint64_t si_chartab[4];       // 'iskeyword'
+  varnumber_T si_changedtick;   // b:changedtick the counts are for
+  linenr_T si_next;             // next line to search
+  linenr_T si_dirty_top;        // changed lines to search again, zero when
+  linenr_T si_dirty_bot;        // there are none
+} SearchIndex;
+
 // Maximum number of maphash blocks we will have
 #define MAX_MAPHASH 256
 
@@ -416,6 +441,7 @@ struct file_buffer {
 
   bool b_saving;                // Set to true if we are in the middle of
                                 // saving the buffer.
+  bufwrite_T *b_write_job;      // pending write by a worker thread or NULL
 
   // Changes to a buffer require updating of the display.  To minimize the
   // work, remember changes made and update everything at once.
@@ -436,6 +462,9 @@ struct file_buffer {
   int64_t b_mtime_read_ns;      // nanoseconds of last read time
   uint64_t b_orig_size;         // size of original file in bytes
   int b_orig_mode;              // mode of original file
+  struct fs_event_watcher *b_watcher;  // watcher for changes of the file or NULL
+  bool b_watch_stale;           // the file may have changed since the last
+                                // timestamp check
   time_t b_last_used;           // time when the buffer was last used; used
                                 // for viminfo
 
@@ -459,6 +488,8 @@ struct file_buffer {
   // bitset with 4*64=256 bits: 1 bit per character 0-255.
   uint64_t b_chartab[4];
 
+  SearchIndex b_search_index;   // matches of the last search pattern
+
   // Table used for mappings local to a buffer.
   mapblock_T *(b_maphash[MAX_MAPHASH]);
 
@@ -873,6 +904,61 @@ typedef struct {
   linenr_T wl_lastlnum;         // last buffer line number for logical line
 } wline_T;
 
+// Number of cells of buffer lines in a window, used for the height of wrapped
+// lines and linetabsize().  Lines are invalidated by changed_common(), the
+// whole cache when anything else in the key differs.
+typedef struct {
+  kvec_t(int) lc_size;          // cells of line "lnum" at [lnum - 1], -1 if
+                                // not known
+  buf_T *lc_buf;                // buffer the sizes are for
+  varnumber_T lc_changedtick;   // b:changedtick of "lc_buf"
+  int lc_gen;                   // value of "linesize_gen"
+  int lc_width;                 // w_view_width, for 'breakindent' etc.
+  int lc_col_off;               // win_col_off()
+  int lc_col_off2;              // win_col_off2()
+  OptInt lc_ts;                 // 'tabstop'
+  colnr_T *lc_vts;              // 'vartabstop'
+  bool lc_list;                 // 'list'
+  bool lc_wrap;                 // 'wrap'
+  bool lc_lbr;                  // 'linebreak'
+  bool lc_bri;                  // 'breakindent'
+} LineSizeCache;
+
+// One search for a 'hlsearch' match in a window line: the first match at or
+// after column "hm_col".
+typedef struct {
+  linenr_T hm_lnum;             // line searched
+  colnr_T hm_col;               // column the search started at
+  colnr_T hm_start;             // start column of the match, -1 for no match
+  colnr_T hm_end;               // end column of the match
+} HlMatch;
+
+// 'hlsearch' matches found in a window, so that redrawing lines that did not
+// change doesn't need the regexp engine.  Lines are invalidated by
+// changed_common(), the whole cache when anything else in the key differs.
+// Only used for patterns that match within one line and don't depend on the
+// cursor, marks or the Visual area.
+typedef struct {
+  kvec_t(HlMatch) hc_matches;   // sorted on line and column
+  bool hc_valid;                // cache can be used for the current redraw
+  buf_T *hc_buf;                // buffer the matches are for
+  varnumber_T hc_changedtick;   // b:changedtick of "hc_buf"
+  char *hc_pat;                 // the pattern
+  size_t hc_patlen;             // length of "hc_pat"
+  int hc_magic;                 // 'magic' for "hc_pat"
+  bool hc_ic;                   // ignoring case
+  uint64_t hc_chartab[4];       // 'iskeyword'
+} HlMatchCache;
+
+// What win_line() drew for a line at a window row, so that win_update() can
+// leave the rows alone when the line would be drawn the same way again.
+typedef struct {
+  uint64_t rf_input;            // hash of what drawing the line depends on
+  uint64_t rf_output;           // hash of the grid rows that were drawn
+  linenr_T rf_lastlnum;         // "wl_lastlnum" of the line
+  int rf_size;                  // number of rows drawn, 0 when not valid
+} RowFingerprint;
+
 // Windows are kept in a tree of frames.  Each frame has a column (FR_COL)
 // or row (FR_ROW) layout or is a leaf, which has a window.
 struct frame_S {
@@ -1261,6 +1347,9 @@ struct window_S {
   int w_lines_valid;                // number of valid entries
   wline_T *w_lines;
   int w_lines_size;
+  LineSizeCache w_linesize;         // number of cells of buffer lines
+  HlMatchCache w_hlcache;           // 'hlsearch' matches
+  kvec_t(RowFingerprint) w_rowfp;   // what was drawn at each row
 
   garray_T w_folds;                 // array of nested folds
   bool w_fold_manual;               // when true: some folds are opened/closed
@@ -10,6 +10,11 @@
 #include <uv.h>
 
 #include "auto/config.h"
+
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
+
 #include "nvim/ascii_defs.h"
 #include "nvim/autocmd.h"
 #include "nvim/autocmd_defs.h"
@@ -21,6 +26,8 @@
 #include "nvim/errors.h"
 #include "nvim/eval/typval_defs.h"
 #include "nvim/eval/vars.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
 #include "nvim/ex_cmds.h"
 #include "nvim/ex_cmds_defs.h"
 #include "nvim/ex_eval.h"
@@ -31,7 +38,10 @@
 #include "nvim/iconv_defs.h"
 #include "nvim/input.h"
 #include "nvim/macros_defs.h"
+#include "nvim/main.h"
 #include "nvim/mbyte.h"
+#include "nvim/memfile.h"
+#include "nvim/memfile_defs.h"
 #include "nvim/memline.h"
 #include "nvim/memline_defs.h"
 #include "nvim/memory.h"
@@ -73,6 +83,7 @@ typedef struct {
 } Error_T;
 
 #define SMALLBUFSIZE 256     // size of emergency write buffer
+#define WRITEV_COUNT 1024    // buffers for one writev(), two for each line
 
 // Structure to pass arguments from buf_write() to buf_write_bytes().
 struct bw_info {
@@ -91,6 +102,30 @@ struct bw_info {
   iconv_t bw_iconv_fd;            // descriptor for iconv() or -1
 };
 
+struct bufwrite {
+  uv_work_t req;
+  buf_T *buf;                     ///< NULL when the result was handled
+  mlsnap_T *snap;                 ///< text to write
+  int fd;                         ///< "tmpname" opened for writing
+  char *ffname;                   ///< file to replace, full path
+  char *fname;                    ///< idem, for messages and autocommands
+  char *tmpname;                  ///< file written first
+  int fileformat;
+  bool no_eol;                    ///< no end-of-line after the last line
+  bool ctrl_z;                    ///< write a trailing CTRL-Z
+  bool do_fsync;
+  bool do_sha;                    ///< compute "sha_ctx" for the undo file
+  char bom[4];
+  int bom_len;
+  context_sha256_T sha_ctx;
+  varnumber_T changedtick;        ///< b:changedtick of the text in "snap"
+  off_T nchars;                   ///< number of bytes written
+  Error_T err;                    ///< set by the worker when failing
+  uv_mutex_t mutex;
+  uv_cond_t cond;
+  bool done;                      ///< worker finished, protected by "mutex"
+};
+
 #include "bufwrite.c.generated.h"
 
 /// Convert a Unicode character to bytes.
@@ -337,6 +372,82 @@ static int buf_write_bytes(struct bw_info *ip)
   return (wlen < len) ? FAIL : OK;
 }
 
+#ifdef HAVE_WRITEV
+/// Write the lines "*lnump" to "end" of "buf" to "fd", with writev() straight
+/// from the memline blocks. Only for text that needs no conversion, written
+/// with NL or CR-NL line endings. A NL in the text is written as a NUL.
+///
+/// @param[in,out] lnump  first line to write, set to the line after the last
+///                       one written.
+/// @param[in,out] ncharsp  number of bytes written is added.
+/// @param[out] no_eolp  set when the last line has no end-of-line.
+/// @param sha_ctx  when not NULL, updated with the text of the lines.
+///
+/// @return  FAIL for a write error or when interrupted, OK otherwise.
+static int buf_write_lines(buf_T *buf, int fd, linenr_T *lnump, linenr_T end, bool write_bin,
+                           int fileformat, int *ncharsp, bool *no_eolp,
+                           context_sha256_T *sha_ctx)
+{
+  struct iovec iov[WRITEV_COUNT];
+  char *lines[WRITEV_COUNT / 2];
+  colnr_T lens[WRITEV_COUNT / 2];
+  char *copies[WRITEV_COUNT / 2];
+  char *eol = fileformat == EOL_DOS ? "\r\n" : "\n";
+  size_t eol_len = strlen(eol);
+  int retval = OK;
+
+  while (*lnump <= end && retval == OK) {
+    linenr_T lnum = *lnump;
+    int count = ml_get_block_lines(buf, lnum, MIN(WRITEV_COUNT / 2, end - lnum + 1), lines, lens);
+    if (count == 0) {
+      return FAIL;
+    }
+    size_t iov_count = 0;
+    int copy_count = 0;
+    size_t size = 0;
+    for (int i = 0; i < count; i++, lnum++) {
+      char *ptr = lines[i];
+      size_t len = (size_t)lens[i];
+      if (sha_ctx != NULL) {
+        sha256_update(sha_ctx, (uint8_t *)ptr, (uint32_t)len + 1);
+      }
+      if (memchr(ptr, NL, len) != NULL) {
+        // Newlines are written as NULs, this needs a copy.
+        ptr = copies[copy_count++] = xmemdup(ptr, len);
+        memchrsub(ptr, NL, NUL, len);
+      }
+      iov[iov_count++] = (struct iovec){ .iov_base = ptr, .iov_len = len };
+      size += len;
+      if (lnum == end
+          && (write_bin || !buf->b_p_fixeol)
+          && ((write_bin && lnum == buf->b_no_eol_lnum)
+              || (lnum == buf->b_ml.ml_line_count && !buf->b_p_eol))) {
+        *no_eolp = true;
+      } else {
+        iov[iov_count++] = (struct iovec){ .iov_base = eol, .iov_len = eol_len };
+        size += eol_len;
+      }
+    }
+
+    ptrdiff_t written = os_writev(fd, iov, iov_count, false);
+    for (int i = 0; i < copy_count; i++) {
+      xfree(copies[i]);
+    }
+    if (written < (ptrdiff_t)size) {
+      retval = FAIL;
+    } else {
+      *ncharsp += (int)size;
+      *lnump = lnum;
+      os_breakcheck();
+      if (got_int) {
+        retval = FAIL;
+      }
+    }
+  }
+  return retval;
+}
+#endif
+
 /// Check modification time of file, before writing to it.
 /// The size isn't checked, because using a tool like "gzip" takes care of
 /// using the same timestamp but can't set the size.
@@ -1069,6 +1180,10 @@ int buf_write(buf_T *buf, char *fname, char *sfname, linenr_T start, linenr_T en
     return FAIL;
   }
 
+  // Finish a previous write in the background first, it may be to the same
+  // file.
+  buf_write_wait(buf, false);
+
   // must init bw_conv_buf and bw_iconv_fd before jumping to "fail"
   struct bw_info write_info;            // info for buf_write_bytes()
   write_info.bw_conv_buf = NULL;
@@ -1209,6 +1324,26 @@ int buf_write(buf_T *buf, char *fname, char *sfname, linenr_T start, linenr_T en
   // Mark the buffer as 'being saved' to prevent changed buffer warnings
   buf->b_saving = true;
 
+  // A big buffer may be written in the background, without a backup: the
+  // file is only replaced when the new one was written.
+  if (overwriting && reset_changed && whole && !append && !filtering && !newfile && !device
+      && buf_write_async(buf, ffname, fname, eap, &file_info_old, perm, acl, bkc) == OK) {
+    if (forceit && vim_strchr(p_cpo, CPO_KEEPRO) == NULL) {
+      buf->b_p_ro = false;
+      need_maketitle = true;
+      status_redraw_all();
+    }
+    // Everything else is done by buf_write_job_finish().
+    no_wait_return--;
+    msg_scroll = msg_save;
+    if (buffer != smallbuf) {
+      xfree(buffer);
+    }
+    os_free_acl(acl);
+    got_int |= prev_got_int;
+    return OK;
+  }
+
   // If we are not appending or filtering, the file exists, and the
   // 'writebackup', 'backup' or 'patchmode' option is set, need a backup.
   // When 'patchmode' is set also make a backup when appending.
@@ -1264,6 +1399,17 @@ int buf_write(buf_T *buf, char *fname, char *sfname, linenr_T start, linenr_T en
     }
   }
 
+  // Lines of a lazily loaded file may still only be in that file, get them
+  // into memory before it is overwritten.
+  if (buf->b_ml.ml_mfp != NULL && buf->b_ml.ml_mfp->mf_lazy_fd >= 0) {
+    FileID file_id;
+    if (overwriting
+        || (buf->file_id_valid && os_fileid(fname, &file_id)
+            && os_fileid_equal(&buf->file_id, &file_id))) {
+      mf_lazy_load_all(buf->b_ml.ml_mfp);
+    }
+  }
+
   // Default: write the file directly.  May write to a temp file for
   // multi-byte conversion.
   wfname = fname;
@@ -1500,7 +1646,19 @@ restore_backup:
     fileformat = get_fileformat_force(buf, eap);
     char *s = buffer;
     int len = 0;
-    for (lnum = start; lnum <= end; lnum++) {
+    lnum = start;
+#ifdef HAVE_WRITEV
+    if (fd >= 0 && wb_flags == 0 && write_info.bw_iconv_fd == (iconv_t)-1
+        && fileformat != EOL_MAC) {
+      // Nothing to convert, the lines can be written from the memline
+      // blocks without copying them into "buffer".
+      if (buf_write_lines(buf, fd, &lnum, end, write_bin, fileformat, &nchars, &no_eol,
+                          write_undo_file ? &sha_ctx : NULL) == FAIL) {
+        end = 0;
+      }
+    }
+#endif
+    for (; lnum <= end; lnum++) {
       // The next while loop is done once for each character written.
       // Keep it fast!
       char *ptr = ml_get_buf(buf, lnum) - 1;
@@ -1917,3 +2075,361 @@ nofail:
 
   return retval;
 }
+
+/// Start writing buffer "buf" to its file "ffname" in the background, when it
+/// is big enough for 'asyncwrite'. A snapshot of the text is written to a new
+/// file by a worker thread, buf_write_job_finish() then puts it in place of
+/// "ffname" and does what buf_write() does after writing.
+///
+/// @param fname  name of the file for messages
+/// @param file_info_old  information about the existing file "ffname"
+/// @param perm  permissions of "ffname"
+/// @param acl  ACL of "ffname"
+///
+/// @return  OK when started, NOTDONE when the buffer must be written as usual.
+static int buf_write_async(buf_T *buf, char *ffname, char *fname, exarg_T *eap,
+                           FileInfo *file_info_old, int perm, vim_acl_T acl, unsigned bkc)
+{
+  // Only for a plain write of a regular file that can be replaced by a new
+  // one. Not when a backup or a copy of the original is wanted, not when
+  // going to exit.
+  if (p_awr <= 0 || exiting || eap == NULL
+      || (eap->cmdidx != CMD_write && eap->cmdidx != CMD_update)
+      || eap->force_enc != 0 || need_conversion(buf->b_p_fenc)
+      || p_bk || *p_pm != NUL || (bkc & kOptBkcFlagYes)
+      || perm < 0 || !(perm & 0200)) {
+    return NOTDONE;
+  }
+#ifdef UNIX
+  FileInfo file_info;
+  if (file_info_old->stat.st_uid != getuid()
+      || os_fileinfo_hardlinks(file_info_old) > 1
+      || !os_fileinfo_link(ffname, &file_info)
+      || !os_fileinfo_id_equal(&file_info, file_info_old)) {
+    return NOTDONE;
+  }
+#endif
+  const int fileformat = get_fileformat_force(buf, eap);
+  if (fileformat == EOL_MAC) {
+    return NOTDONE;
+  }
+
+  mlsnap_T *snap = ml_snapshot(buf);
+  if (snap == NULL) {
+    return NOTDONE;
+  }
+  if (snap->ms_size / 1024 < p_awr) {
+    ml_snapshot_free(snap);
+    return NOTDONE;
+  }
+
+  // Create the new file next to "ffname", so that it can be renamed.
+  size_t tmplen = strlen(ffname) + 16;
+  char *tmpname = xmalloc(tmplen);
+  int fd = -1;
+  for (int i = 0; i < 100 && fd < 0; i++) {
+    snprintf(tmpname, tmplen, "%s.nvimwrite%d", ffname, i);
+    fd = os_open(tmpname, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, perm & 0777);
+    if (fd < 0 && fd != UV_EEXIST) {
+      break;
+    }
+  }
+  if (fd < 0) {
+    xfree(tmpname);
+    ml_snapshot_free(snap);
+    return NOTDONE;
+  }
+#ifdef UNIX
+  if (file_info_old->stat.st_gid != getgid()
+      && os_fchown(fd, (uv_uid_t)file_info_old->stat.st_uid,
+                   (uv_gid_t)file_info_old->stat.st_gid) != 0) {
+    // Cannot keep the group, write the file itself.
+    os_close(fd);
+    os_remove(tmpname);
+    xfree(tmpname);
+    ml_snapshot_free(snap);
+    return NOTDONE;
+  }
+#endif
+  os_setperm(tmpname, perm);
+  os_set_acl(tmpname, acl);
+#ifdef HAVE_XATTR
+  os_copy_xattr(ffname, tmpname);
+#endif
+
+  bool write_bin = eap->force_bin != 0 ? eap->force_bin == FORCE_BIN : buf->b_p_bin;
+  bufwrite_T *job = xcalloc(1, sizeof(bufwrite_T));
+  job->buf = buf;
+  job->snap = snap;
+  job->fd = fd;
+  job->ffname = xstrdup(ffname);
+  job->fname = xstrdup(fname);
+  job->tmpname = tmpname;
+  job->fileformat = fileformat;
+  job->no_eol = (write_bin || !buf->b_p_fixeol)
+                && ((write_bin && snap->ms_line_count == buf->b_no_eol_lnum) || !buf->b_p_eol);
+  job->ctrl_z = !buf->b_p_fixeol && buf->b_p_eof;
+  job->do_fsync = p_fs;
+  if (buf->b_p_bomb && !write_bin) {
+    job->bom_len = make_bom(job->bom, buf->b_p_fenc);
+  }
+  job->do_sha = buf->b_p_udf;
+  if (job->do_sha) {
+    sha256_start(&job->sha_ctx);
+  }
+  job->changedtick = buf_get_changedtick(buf);
+  uv_mutex_init(&job->mutex);
+  uv_cond_init(&job->cond);
+  job->req.data = job;
+  buf->b_write_job = job;
+  uv_queue_work(&main_loop.uv, &job->req, buf_write_job_work, buf_write_job_done);
+  return OK;
+}
+
+/// Write "count" buffers of a write job. Runs in the worker thread.
+static int buf_write_job_flush(bufwrite_T *job, uv_buf_t *bufs, size_t count)
+{
+  size_t size = 0;
+  for (size_t i = 0; i < count; i++) {
+    size += bufs[i].len;
+  }
+  if (size == 0) {
+    return OK;
+  }
+  uv_fs_t req;
+  int r = uv_fs_write(NULL, &req, job->fd, bufs, (unsigned)count, -1, NULL);
+  uv_fs_req_cleanup(&req);
+  if (r < 0 || (size_t)r != size) {
+    job->err = set_err(_(e_write_error_file_system_full));
+    return FAIL;
+  }
+  job->nchars += (off_T)size;
+  return OK;
+}
+
+/// Write the text of a write job to its file. Runs in a worker thread: must
+/// not use anything but the job.
+static void buf_write_job_work(uv_work_t *req)
+{
+  bufwrite_T *job = req->data;
+  mlsnap_T *snap = job->snap;
+  uv_buf_t bufs[WRITEV_COUNT];
+  char *lines[WRITEV_COUNT / 2];
+  colnr_T lens[WRITEV_COUNT / 2];
+  char *eol = job->fileformat == EOL_DOS ? "\r\n" : "\n";
+  size_t count = 0;
+  linenr_T lnum = 0;
+  int status = OK;
+
+  if (job->bom_len > 0) {
+    bufs[count++] = uv_buf_init(job->bom, (unsigned)job->bom_len);
+  }
+  for (size_t blk = 0; blk < kv_size(snap->ms_blocks) && status == OK; blk++) {
+    int n;
+    for (int idx = 0; status == OK
+         && (n = ml_snapshot_lines(snap, blk, idx, WRITEV_COUNT / 2, lines, lens)) > 0;
+         idx += n) {
+      for (int i = 0; i < n && status == OK; i++) {
+        lnum++;
+        size_t len = (size_t)lens[i];
+        if (job->do_sha) {
+          sha256_update(&job->sha_ctx, (uint8_t *)lines[i], (uint32_t)len + 1);
+        }
+        if (memchr(lines[i], NL, len) == NULL) {
+          bufs[count++] = uv_buf_init(lines[i], (unsigned)len);
+        } else {
+          // Newlines are written as NULs, convert a piece at a time.
+          status = buf_write_job_flush(job, bufs, count);
+          count = 0;
+          char piece[SMALLBUFSIZE];
+          for (size_t done = 0; done < len && status == OK; done += sizeof(piece)) {
+            size_t piece_len = MIN(len - done, sizeof(piece));
+            memcpy(piece, lines[i] + done, piece_len);
+            memchrsub(piece, NL, NUL, piece_len);
+            uv_buf_t piece_buf = uv_buf_init(piece, (unsigned)piece_len);
+            status = buf_write_job_flush(job, &piece_buf, 1);
+          }
+        }
+        if (lnum < snap->ms_line_count || !job->no_eol) {
+          bufs[count++] = uv_buf_init(eol, (unsigned)strlen(eol));
+        }
+        if (count + 3 > WRITEV_COUNT && status == OK) {
+          status = buf_write_job_flush(job, bufs, count);
+          count = 0;
+        }
+      }
+    }
+  }
+  if (job->ctrl_z) {
+    bufs[count++] = uv_buf_init("\x1a", 1);
+  }
+  if (status == OK) {
+    status = buf_write_job_flush(job, bufs, count);
+  }
+
+  uv_fs_t fs_req;
+  int r;
+  if (status == OK && job->do_fsync) {
+    r = uv_fs_fsync(NULL, &fs_req, job->fd, NULL);
+    uv_fs_req_cleanup(&fs_req);
+    // fsync not supported on this storage.
+    if (r < 0 && r != UV_ENOTSUP) {
+      job->err = set_err_arg(e_fsync, r);
+      status = FAIL;
+    }
+  }
+  r = uv_fs_close(NULL, &fs_req, job->fd, NULL);
+  uv_fs_req_cleanup(&fs_req);
+  if (r < 0 && status == OK) {
+    job->err = set_err_arg(_("E512: Close failed: %s"), r);
+  }
+
+  uv_mutex_lock(&job->mutex);
+  job->done = true;
+  uv_cond_signal(&job->cond);
+  uv_mutex_unlock(&job->mutex);
+}
+
+/// Called in the main thread when the worker finished a write job.
+static void buf_write_job_done(uv_work_t *req, int status)
+{
+  bufwrite_T *job = req->data;
+  if (job->buf != NULL) {
+    // Autocommands must not be triggered from here, use the event loop.
+    multiqueue_put(main_loop.events, buf_write_job_event, job);
+  } else {
+    buf_write_job_free(job);
+  }
+}
+
+static void buf_write_job_event(void **argv)
+{
+  bufwrite_T *job = argv[0];
+  if (job->buf != NULL) {
+    buf_write_job_finish(job, false);
+  }
+  buf_write_job_free(job);
+}
+
+static void buf_write_job_free(bufwrite_T *job)
+{
+  uv_cond_destroy(&job->cond);
+  uv_mutex_destroy(&job->mutex);
+  xfree(job->ffname);
+  xfree(job->fname);
+  xfree(job->tmpname);
+  xfree(job);
+}
+
+/// Wait for the worker thread to finish writing "buf" in the background, if it
+/// is busy, and handle the result.
+///
+/// @param closing  the memline of "buf" is being closed, only put the file in
+///                 place, do not change the buffer or trigger autocommands.
+void buf_write_wait(buf_T *buf, bool closing)
+{
+  bufwrite_T *job = buf->b_write_job;
+  if (job == NULL) {
+    return;
+  }
+  uv_mutex_lock(&job->mutex);
+  while (!job->done) {
+    uv_cond_wait(&job->cond, &job->mutex);
+  }
+  uv_mutex_unlock(&job->mutex);
+  buf_write_job_finish(job, closing);
+}
+
+/// Wait for all writes in the background to finish. Used before quitting.
+void buf_write_wait_all(void)
+{
+  for (buf_T *buf = firstbuf; buf != NULL;) {
+    if (buf->b_write_job != NULL) {
+      buf_write_wait(buf, false);
+      buf = firstbuf;  // autocommands may have deleted buffers
+    } else {
+      buf = buf->b_next;
+    }
+  }
+}
+
+/// Handle the result of write job "job": put the new file in place and update
+/// the buffer like buf_write() does. The job itself is freed by whoever comes
+/// last of buf_write_job_done() and buf_write_job_event().
+static void buf_write_job_finish(bufwrite_T *job, bool closing)
+{
+  buf_T *buf = job->buf;
+  job->buf = NULL;
+  buf->b_write_job = NULL;
+  buf->b_saving = false;
+  linenr_T line_count = job->snap->ms_line_count;
+  ml_snapshot_free(job->snap);
+  job->snap = NULL;
+
+  Error_T err = job->err;
+  if (err.msg == NULL) {
+    // Like buf_write(), make the swap file complete before the original file
+    // is replaced.
+    if (!closing) {
+      ml_preserve(buf, false, false);
+    }
+    if (os_rename(job->tmpname, job->ffname) == FAIL) {
+      err = set_err_num("E212", _("Can't open file for writing"));
+    }
+  }
+  if (err.msg != NULL) {
+    os_remove(job->tmpname);
+    add_quoted_fname(IObuff, IOSIZE - 100, buf, job->fname);
+    emit_err(&err);
+    return;
+  }
+  if (closing) {
+    return;
+  }
+
+  add_quoted_fname(IObuff, IOSIZE, buf, job->fname);
+  bool insert_space = false;
+  if (job->no_eol) {
+    xstrlcat(IObuff, _("[noeol]"), IOSIZE);
+    insert_space = true;
+  }
+  if (msg_add_fileformat(job->fileformat)) {
+    insert_space = true;
+  }
+  msg_add_lines(insert_space, line_count, job->nchars);
+  if (!shortmess(SHM_WRITE)) {
+    xstrlcat(IObuff, shortmess(SHM_WRI) ? _(" [w]") : _(" written"), IOSIZE);
+  }
+  msg_ext_set_kind("bufwrite");
+  msg_ext_overwrite = true;
+  set_keep_msg(msg_trunc(IObuff, false, 0), 0);
+
+  // The file is a new one now.
+  FileInfo file_info;
+  if (os_fileinfo(job->ffname, &file_info)) {
+    buf_store_file_info(buf, &file_info);
+    buf->b_mtime_read = buf->b_mtime;
+    buf->b_mtime_read_ns = buf->b_mtime_ns;
+  }
+  buf_set_file_id(buf);
+  ml_timestamp(buf);
+  buf->b_flags &= ~BF_WRITE_MASK;
+
+  // Only when the buffer was not changed while writing it matches the file.
+  if (buf_get_changedtick(buf) == job->changedtick) {
+    unchanged(buf, true, false);
+    const varnumber_T changedtick = buf_get_changedtick(buf);
+    if (buf->b_last_changedtick + 1 == changedtick) {
+      buf->b_last_changedtick = changedtick;
+    }
+    u_unchanged(buf);
+    u_update_save_nr(buf);
+    if (job->do_sha) {
+      uint8_t hash[UNDO_HASH_SIZE];
+      sha256_finish(&job->sha_ctx, hash);
+      u_write_undo(NULL, false, buf, hash);
+    }
+  }
+
+  buf_write_do_post_autocmds(buf, job->fname, NULL, false, false, true, true);
+}
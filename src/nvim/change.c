@@ -33,6 +33,7 @@
 #include "nvim/mark.h"
 #include "nvim/mark_defs.h"
 #include "nvim/marktree_defs.h"
+#include "nvim/match.h"
 #include "nvim/mbyte.h"
 #include "nvim/mbyte_defs.h"
 #include "nvim/memline.h"
@@ -236,6 +237,9 @@ static void changed_common(buf_T *buf, linenr_T lnum, colnr_T col, linenr_T lnum
 {
   // mark the buffer as modified
   changed(buf);
+  linesize_cache_changed(buf, lnum, lnume, xtra);
+  search_index_changed(buf, lnum, lnume, xtra);
+  hlsearch_cache_changed(buf, lnum, lnume, xtra);
 
   FOR_ALL_WINDOWS_IN_TAB(win, curtab) {
     if (win->w_buffer == buf && win->w_p_diff && diff_internal()) {
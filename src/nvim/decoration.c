@@ -91,6 +91,7 @@ void bufhl_add_hl_pos_offset(buf_T *buf, int src_id, int hl_id, lpos_T pos_start
 
 void decor_redraw(buf_T *buf, int row1, int row2, int col1, DecorInline decor)
 {
+  rowfp_clear_all();
   if (decor.ext) {
     DecorVirtText *vt = decor.data.ext.vt;
     while (vt) {
@@ -167,6 +167,18 @@ void decor_providers_invoke_win(win_T *wp)
   }
 }
 
+/// @return whether a provider may draw in the window decor_providers_invoke_win()
+///         was called for.
+bool decor_providers_active(void)
+{
+  for (size_t i = 0; i < kv_size(decor_providers); i++) {
+    if (kv_A(decor_providers, i).state == kDecorProviderActive) {
+      return true;
+    }
+  }
+  return false;
+}
+
 /// For each provider invoke the 'line' callback for a given window row.
 ///
 /// @param      wp        Window
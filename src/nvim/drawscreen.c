@@ -99,6 +99,7 @@
 #include "nvim/option.h"
 #include "nvim/option_vars.h"
 #include "nvim/os/os_defs.h"
+#include "nvim/os/time.h"
 #include "nvim/plines.h"
 #include "nvim/popupmenu.h"
 #include "nvim/pos_defs.h"
@@ -431,6 +432,61 @@ bool redrawing(void)
          && !(p_lz && char_avail() && !KeyTyped && !do_redraw);
 }
 
+// Pacing of redraws for events, see 'redrawrate'.
+static uint64_t frame_time = 0;    // os_hrtime() of the last update_screen()
+static bool frame_typed = false;   // a key was typed since then
+static bool frame_held = false;    // a redraw was held back since then
+
+/// Lets the next redraw happen right away, called for typed keys.
+void redraw_frame_typed(void)
+{
+  frame_typed = true;
+}
+
+/// @return  milliseconds until the next frame when a redraw for events has to
+///          wait for it, zero otherwise.
+int redraw_frame_delay(void)
+{
+  if (p_rdr <= 0 || frame_typed) {
+    return 0;
+  }
+  uint64_t interval = 1000000000 / (uint64_t)p_rdr;
+  uint64_t elapsed = os_hrtime() - frame_time;
+  if (elapsed >= interval) {
+    return 0;
+  }
+  return (int)((interval - elapsed + 999999) / 1000000);
+}
+
+/// Holds back a redraw for events until the next frame, if it is too early.
+///
+/// @return  true if the redraw has to wait.
+bool redraw_frame_hold(void)
+{
+  if (redraw_frame_delay() == 0) {
+    return false;
+  }
+  g_stats.frames_coalesced++;
+  frame_held = true;
+  return true;
+}
+
+static void redraw_frame_start(void)
+{
+  uint64_t now = os_hrtime();
+  if (frame_held && p_rdr > 0) {
+    // Frames that should have been drawn meanwhile, but the loop was busy.
+    uint64_t interval = 1000000000 / (uint64_t)p_rdr;
+    uint64_t missed = (now - frame_time) / interval;
+    if (missed > 1) {
+      g_stats.frames_dropped += (int64_t)missed - 1;
+    }
+  }
+  frame_time = now;
+  frame_typed = false;
+  frame_held = false;
+}
+
 /// Redraw the parts of the screen that is marked for redraw.
 ///
 /// Most code shouldn't call this directly, rather use redraw_later() and
@@ -473,6 +529,7 @@ int update_screen(void)
   // scroll, or a decoration provider requires a redraw, the screen
   // will be redrawn later or in win_update().
   must_redraw = 0;
+  redraw_frame_start();
 
   updating_screen = true;
 
@@ -1338,6 +1395,98 @@ static void draw_sep_connectors_win(win_T *wp)
   }
 }
 
+/// Incremented to invalidate the row fingerprints of all windows.
+static int rowfp_gen = 0;
+
+/// Invalidate the row fingerprints of all windows, when something changed that
+/// drawing a line depends on and that is not part of the fingerprint, e.g. an
+/// option, highlighting, syntax items, matches or decorations.
+void rowfp_clear_all(void)
+{
+  rowfp_gen++;
+}
+
+static uint64_t rowfp_mix(uint64_t h, uint64_t v)
+{
+  h = (h ^ v) * 0x9e3779b97f4a7c15;
+  return h ^ (h >> 29);
+}
+
+/// Get a hash of what drawing a line of window "wp" depends on, other than the
+/// line itself and its folding.  Makes room for a fingerprint for each row.
+///
+/// @return  0 when the fingerprints can't be used: what is drawn depends on
+///          more than that, e.g. a decoration provider, 'statuscolumn' or the
+///          Visual area.
+static uint64_t win_rowfp_context(win_T *wp)
+{
+  buf_T *const buf = wp->w_buffer;
+  if (decor_providers_active()
+      || *wp->w_p_stc != NUL
+      || wp->w_p_diff
+      || wp->w_p_spell
+      || buf->terminal != NULL
+      || bt_quickfix(buf)
+      || highlight_match
+      || (VIsual_active && buf == curwin->w_buffer)
+      || (screen_search_hl.rm.regprog != NULL
+          && re_uses_context(screen_search_hl.rm.regprog))) {
+    return 0;
+  }
+  for (matchitem_T *cur = wp->w_match_head; cur != NULL; cur = cur->mit_next) {
+    if (cur->mit_match.regprog != NULL && re_uses_context(cur->mit_match.regprog)) {
+      return 0;
+    }
+  }
+
+  uint64_t h = rowfp_mix(0, (uint64_t)rowfp_gen);
+  h = rowfp_mix(h, (uint64_t)(uintptr_t)buf);
+  h = rowfp_mix(h, (uint64_t)buf_get_changedtick(buf));
+  h = rowfp_mix(h, wp == curwin);
+  h = rowfp_mix(h, (uint64_t)wp->w_view_width);
+  h = rowfp_mix(h, (uint64_t)wp->w_leftcol);
+  h = rowfp_mix(h, (uint64_t)win_col_off(wp));
+  h = rowfp_mix(h, (uint64_t)win_col_off2(wp));
+  h = rowfp_mix(h, (uint64_t)ns_hl_active);
+  h = rowfp_mix(h, (uint64_t)win_bg_attr(wp));
+  // The cursor line is always drawn, but 'relativenumber', 'cursorcolumn',
+  // concealing and CurSearch may change other lines when the cursor moves.
+  h = rowfp_mix(h, wp->w_p_rnu || wp->w_p_cole > 0 || screen_search_hl.rm.regprog != NULL
+                   ? (uint64_t)wp->w_cursor.lnum : 0);
+  h = rowfp_mix(h, wp->w_p_cuc ? (uint64_t)wp->w_virtcol : 0);
+  h = rowfp_mix(h, screen_search_hl.rm.regprog != NULL);
+  if (screen_search_hl.rm.regprog != NULL) {
+    const char *const pat = last_search_pat();
+    for (size_t i = 0; pat != NULL && i < last_search_pat_len(); i++) {
+      h = rowfp_mix(h, (uint8_t)pat[i]);
+    }
+    h = rowfp_mix(h, (uint64_t)last_search_pat_magic());
+  }
+
+  while (kv_size(wp->w_rowfp) < (size_t)wp->w_view_height) {
+    kv_push(wp->w_rowfp, ((RowFingerprint){ .rf_size = 0 }));
+  }
+  return h == 0 ? 1 : h;
+}
+
+/// Get a hash of the contents of "count" rows of window "wp" from "row".
+static uint64_t win_rowfp_output(win_T *wp, int row, int count)
+{
+  uint64_t h = 0;
+  for (int r = row; r < row + count; r++) {
+    int grid_row = r;
+    int grid_col = 0;
+    ScreenGrid *grid = grid_adjust(&wp->w_grid, &grid_row, &grid_col);
+    size_t off = grid->line_offset[grid_row] + (size_t)grid_col;
+    for (int col = 0; col < wp->w_view_width; col++) {
+      h = rowfp_mix(h, grid->chars[off + (size_t)col]);
+      h = rowfp_mix(h, ((uint64_t)(uint32_t)grid->attrs[off + (size_t)col] << 32)
+                    | (uint32_t)grid->vcols[off + (size_t)col]);
+    }
+  }
+  return h;
+}
+
 /// Update a single window.
 ///
 /// This may cause the windows below it also to be redrawn (when clearing the
@@ -1951,6 +2100,9 @@ static void win_update(win_T *wp)
 
   win_check_ns_hl(wp);
 
+  // Rows that show what win_line() would draw there again are left alone.
+  const uint64_t rowfp_context = win_rowfp_context(wp);
+
   spellvars_T spv = { 0 };
   linenr_T lnum = wp->w_topline;  // first line shown in window
   // Initialize spell related variables for the first drawn line.
@@ -2188,41 +2340,87 @@ static void win_update(win_T *wp)
         // will draw "@  " lines below.
         row = wp->w_view_height + 1;
       } else {
-        prepare_search_hl(wp, &screen_search_hl, lnum);
-        // Let the syntax stuff know we skipped a few lines.
-        if (syntax_last_parsed != 0 && syntax_last_parsed + 1 < lnum
-            && syntax_present(wp)) {
-          syntax_end_parsing(wp, syntax_last_parsed + 1);
+        // Only lines that are not folded or concealed, are not a cursor line
+        // and did not change have a fingerprint.
+        RowFingerprint *rf = NULL;
+        uint64_t rf_input = 0;
+        if (rowfp_context != 0
+            && foldinfo.fi_lines == 0
+            && !concealed
+            && lnum != wp->w_cursor.lnum
+            && lnum != wp->w_cursorline
+            && lnum != wp->w_last_cursorline
+            && !(mod_top != 0 && lnum >= mod_top && lnum < mod_bot)
+            && win_get_fill(wp, lnum) == 0) {
+          rf = &kv_A(wp->w_rowfp, srow);
+          rf_input = rowfp_mix(rowfp_context, (uint64_t)lnum);
+          rf_input = rowfp_mix(rf_input, (uint64_t)srow);
+          rf_input = rowfp_mix(rf_input, (uint64_t)foldinfo.fi_lnum);
+          rf_input = rowfp_mix(rf_input, (uint64_t)foldinfo.fi_level);
+          rf_input = rowfp_mix(rf_input, (uint64_t)foldinfo.fi_low_level);
+          rf_input = rowfp_mix(rf_input, lnum == wp->w_topline ? (uint64_t)wp->w_skipcol : 0);
         }
 
-        bool display_buf_line = !concealed && (foldinfo.fi_lines == 0 || *wp->w_p_fdt == NUL);
+        if (rf != NULL && rf->rf_size > 0 && rf->rf_input == rf_input
+            && srow + rf->rf_size <= wp->w_view_height
+            && win_rowfp_output(wp, srow, rf->rf_size) == rf->rf_output) {
+          // The rows already show this line.
+          row = srow + rf->rf_size;
+          g_stats.rows_skipped += rf->rf_size;
+          wp->w_lines[idx].wl_folded = false;
+          wp->w_lines[idx].wl_foldend = lnum;
+          wp->w_lines[idx].wl_lastlnum = rf->rf_lastlnum;
+          did_update = DID_NONE;
+          spv.spv_capcol_lnum = 0;
+        } else {
+          prepare_search_hl(wp, &screen_search_hl, lnum);
+          // Let the syntax stuff know we skipped a few lines.
+          if (syntax_last_parsed != 0 && syntax_last_parsed + 1 < lnum
+              && syntax_present(wp)) {
+            syntax_end_parsing(wp, syntax_last_parsed + 1);
+          }
+
+          bool display_buf_line = !concealed && (foldinfo.fi_lines == 0 || *wp->w_p_fdt == NUL);
 
-        // Display one line
-        spellvars_T zero_spv = { 0 };
-        row = win_line(wp, lnum, srow, wp->w_view_height, 0, concealed,
-                       display_buf_line ? &spv : &zero_spv, foldinfo);
+          // Display one line
+          spellvars_T zero_spv = { 0 };
+          row = win_line(wp, lnum, srow, wp->w_view_height, 0, concealed,
+                         display_buf_line ? &spv : &zero_spv, foldinfo);
+          g_stats.rows_drawn += MIN(row, wp->w_view_height) - srow;
 
-        if (display_buf_line) {
-          syntax_last_parsed = lnum;
-        } else {
-          spv.spv_capcol_lnum = 0;
-        }
+          if (display_buf_line) {
+            syntax_last_parsed = lnum;
+          } else {
+            spv.spv_capcol_lnum = 0;
+          }
+
+          linenr_T lastlnum = lnum + foldinfo.fi_lines - (foldinfo.fi_lines > 0);
+          wp->w_lines[idx].wl_folded = foldinfo.fi_lines > 0;
+          wp->w_lines[idx].wl_foldend = lastlnum;
+          wp->w_lines[idx].wl_lastlnum = lastlnum;
+          did_update = foldinfo.fi_lines > 0 ? DID_FOLD : DID_LINE;
+
+          // Adjust "wl_lastlnum" for concealed lines below this line, unless it should
+          // still be drawn for below virt_lines attached to the current line. Below
+          // virt_lines attached to a second adjacent concealed line are concealed.
+          bool virt_below = decor_virt_lines(wp, lastlnum, lastlnum + 1, NULL, NULL, true) > 0;
+          while (!virt_below && wp->w_lines[idx].wl_lastlnum < buf->b_ml.ml_line_count
+                 && decor_conceal_line(wp, wp->w_lines[idx].wl_lastlnum, false)) {
+            virt_below = false;
+            wp->w_lines[idx].wl_lastlnum++;
+            hasFolding(wp, wp->w_lines[idx].wl_lastlnum, NULL, &wp->w_lines[idx].wl_lastlnum);
+          }
 
-        linenr_T lastlnum = lnum + foldinfo.fi_lines - (foldinfo.fi_lines > 0);
-        wp->w_lines[idx].wl_folded = foldinfo.fi_lines > 0;
-        wp->w_lines[idx].wl_foldend = lastlnum;
-        wp->w_lines[idx].wl_lastlnum = lastlnum;
-        did_update = foldinfo.fi_lines > 0 ? DID_FOLD : DID_LINE;
-
-        // Adjust "wl_lastlnum" for concealed lines below this line, unless it should
-        // still be drawn for below virt_lines attached to the current line. Below
-        // virt_lines attached to a second adjacent concealed line are concealed.
-        bool virt_below = decor_virt_lines(wp, lastlnum, lastlnum + 1, NULL, NULL, true) > 0;
-        while (!virt_below && wp->w_lines[idx].wl_lastlnum < buf->b_ml.ml_line_count
-               && decor_conceal_line(wp, wp->w_lines[idx].wl_lastlnum, false)) {
-          virt_below = false;
-          wp->w_lines[idx].wl_lastlnum++;
-          hasFolding(wp, wp->w_lines[idx].wl_lastlnum, NULL, &wp->w_lines[idx].wl_lastlnum);
+          if (rf != NULL) {
+            if (row > srow && row <= wp->w_view_height) {
+              rf->rf_input = rf_input;
+              rf->rf_output = win_rowfp_output(wp, srow, row - srow);
+              rf->rf_lastlnum = wp->w_lines[idx].wl_lastlnum;
+              rf->rf_size = row - srow;
+            } else {
+              rf->rf_size = 0;
+            }
+          }
         }
       }
 
@@ -1674,7 +1674,7 @@ int pattern_match(const char *pat, const char *text, bool ic)
   // avoid 'l' flag in 'cpoptions'
   char *save_cpo = p_cpo;
   p_cpo = empty_string_option;
-  regmatch.regprog = vim_regcomp(pat, RE_MAGIC + RE_STRING);
+  regmatch.regprog = vim_regcomp_cached(pat, RE_MAGIC + RE_STRING);
   if (regmatch.regprog != NULL) {
     regmatch.rm_ic = ic;
     matches = vim_regexec_nl(&regmatch, text, 0);
@@ -6344,7 +6344,7 @@ char *do_string_sub(char *str, size_t len, char *pat, char *sub, typval_T *expr,
   ga_init(&ga, 1, 200);
 
   regmatch.rm_ic = p_ic;
-  regmatch.regprog = vim_regcomp(pat, RE_MAGIC + RE_STRING);
+  regmatch.regprog = vim_regcomp_cached(pat, RE_MAGIC + RE_STRING);
   if (regmatch.regprog != NULL) {
     char *tail = str;
     char *end = str + len;
@@ -4090,7 +4090,7 @@ static void find_some_match(typval_T *const argvars, typval_T *const rettv,
     }
   }
 
-  regmatch.regprog = vim_regcomp(pat, RE_MAGIC + RE_STRING);
+  regmatch.regprog = vim_regcomp_cached(pat, RE_MAGIC + RE_STRING);
   if (regmatch.regprog != NULL) {
     regmatch.rm_ic = p_ic;
 
@@ -4326,7 +4326,7 @@ static void f_matchbufline(typval_T *argvars, typval_T *rettv, EvalFuncData fptr
   p_cpo = empty_string_option;
 
   regmatch_T regmatch;
-  regmatch.regprog = vim_regcomp(pat, RE_MAGIC + RE_STRING);
+  regmatch.regprog = vim_regcomp_cached(pat, RE_MAGIC + RE_STRING);
   if (regmatch.regprog == NULL) {
     goto theend;
   }
@@ -4397,7 +4397,7 @@ static void f_matchstrlist(typval_T *argvars, typval_T *rettv, EvalFuncData fptr
   p_cpo = empty_string_option;
 
   regmatch_T regmatch;
-  regmatch.regprog = vim_regcomp(pat, RE_MAGIC + RE_STRING);
+  regmatch.regprog = vim_regcomp_cached(pat, RE_MAGIC + RE_STRING);
   if (regmatch.regprog == NULL) {
     goto theend;
   }
@@ -7008,7 +7008,7 @@ static void f_split(typval_T *argvars, typval_T *rettv, EvalFuncData fptr)
   }
 
   regmatch_T regmatch = {
-    .regprog = vim_regcomp(pat, RE_MAGIC + RE_STRING),
+    .regprog = vim_regcomp_cached(pat, RE_MAGIC + RE_STRING),
     .startp = { NULL },
     .endp = { NULL },
     .rm_ic = false,
@@ -33,6 +33,19 @@ struct signal_watcher {
   MultiQueue *events;
 };
 
+typedef struct fs_event_watcher FsEventWatcher;
+/// @param events  UV_RENAME and/or UV_CHANGE
+typedef void (*fs_event_cb)(FsEventWatcher *watcher, int events, void *data);
+typedef void (*fs_event_close_cb)(FsEventWatcher *watcher, void *data);
+
+struct fs_event_watcher {
+  uv_fs_event_t uv;
+  void *data;
+  fs_event_cb cb;
+  fs_event_close_cb close_cb;
+  MultiQueue *events;
+};
+
 typedef struct time_watcher TimeWatcher;
 typedef void (*time_cb)(TimeWatcher *watcher, void *data);
 
@@ -0,0 +1,75 @@
+#include <stdint.h>
+#include <uv.h>
+
+#include "nvim/event/defs.h"
+#include "nvim/event/fs_event.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
+#include "nvim/types_defs.h"
+
+#include "event/fs_event.c.generated.h"
+
+void fs_event_watcher_init(Loop *loop, FsEventWatcher *watcher, void *data)
+  FUNC_ATTR_NONNULL_ARG(1) FUNC_ATTR_NONNULL_ARG(2)
+{
+  uv_fs_event_init(&loop->uv, &watcher->uv);
+  watcher->uv.data = watcher;
+  watcher->data = data;
+  watcher->cb = NULL;
+  watcher->close_cb = NULL;
+  watcher->events = loop->fast_events;
+}
+
+/// Start watching file or directory "path".
+///
+/// @return  zero for success, libuv error code for failure.
+int fs_event_watcher_start(FsEventWatcher *watcher, fs_event_cb cb, const char *path)
+  FUNC_ATTR_NONNULL_ALL
+{
+  watcher->cb = cb;
+  return uv_fs_event_start(&watcher->uv, fs_event_watcher_cb, path, 0);
+}
+
+void fs_event_watcher_stop(FsEventWatcher *watcher)
+  FUNC_ATTR_NONNULL_ALL
+{
+  uv_fs_event_stop(&watcher->uv);
+}
+
+void fs_event_watcher_close(FsEventWatcher *watcher, fs_event_close_cb cb)
+  FUNC_ATTR_NONNULL_ARG(1)
+{
+  watcher->close_cb = cb;
+  uv_close((uv_handle_t *)&watcher->uv, close_cb);
+}
+
+static void fs_event_event(void **argv)
+{
+  FsEventWatcher *watcher = argv[0];
+  watcher->cb(watcher, (int)(intptr_t)argv[1], watcher->data);
+}
+
+static void fs_event_watcher_cb(uv_fs_event_t *handle, const char *filename, int events,
+                                int status)
+{
+  FsEventWatcher *watcher = handle->data;
+  if (status < 0) {
+    // The file can no longer be watched, handle it like it was renamed.
+    events = UV_RENAME;
+  }
+  CREATE_EVENT(watcher->events, fs_event_event, watcher, (void *)(intptr_t)events);
+}
+
+static void close_event(void **argv)
+{
+  FsEventWatcher *watcher = argv[0];
+  watcher->close_cb(watcher, watcher->data);
+}
+
+static void close_cb(uv_handle_t *handle)
+{
+  FsEventWatcher *watcher = handle->data;
+  if (watcher->close_cb) {
+    CREATE_EVENT(watcher->events, close_event, watcher);
+  }
+}
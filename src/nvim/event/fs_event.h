@@ -0,0 +1,6 @@
+#pragma once
+
+#include "nvim/event/defs.h"  // IWYU pragma: keep
+#include "nvim/types_defs.h"  // IWYU pragma: keep
+
+#include "event/fs_event.h.generated.h"
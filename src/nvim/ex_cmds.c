@@ -133,6 +133,22 @@ typedef struct {
   linenr_T lines_needed;  // lines needed in the preview window
 } PreviewLines;
 
+enum {
+  MATCH_LINES_PART = 20000,  ///< lines for each thread of match_lines_find()
+  MATCH_LINES_MAXPARTS = 16,  ///< maximum number of threads
+};
+
+/// Lines checked by one thread of match_lines_find().
+typedef struct {
+  const mlsnap_T *snap;
+  regfilter_T *rf;
+  linenr_T first;   ///< line number of bit zero of "bits"
+  linenr_T start;   ///< first line to check, "first" plus a multiple of 64
+  linenr_T end;     ///< last line to check
+  uint64_t *bits;   ///< lines that may match, shared by all parts
+  uv_thread_t thread;
+} matchpart_T;
+
 #include "ex_cmds.c.generated.h"
 
 static const char e_non_numeric_argument_to_z[]
@@ -3507,6 +3523,107 @@ static int check_regexp_delim(int c)
   return OK;
 }
 
+/// Check lines part->start to part->end for match_lines_find().
+static void match_lines_part(void *arg)
+{
+  matchpart_T *part = arg;
+  size_t blk;
+  int idx;
+  ml_snapshot_find(part->snap, part->start, &blk, &idx);
+  char *lines[64];
+  colnr_T lens[64];
+  for (linenr_T lnum = part->start; lnum <= part->end;) {
+    int n = ml_snapshot_lines(part->snap, blk, idx, MIN(64, part->end - lnum + 1), lines, lens);
+    if (n == 0) {
+      blk++;
+      idx = 0;
+      continue;
+    }
+    for (int i = 0; i < n; i++) {
+      if (vim_regfilter_line(part->rf, lines[i], lens[i])) {
+        size_t bit = (size_t)(lnum + i - part->first);
+        part->bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+      }
+    }
+    lnum += n;
+    idx += n;
+  }
+}
+
+/// Find the lines from "line1" to "line2" of the current buffer that may
+/// contain a match for "rmp", splitting the lines between worker threads.
+/// These only run the checks of vim_regfilter_line() on a snapshot of the
+/// text, the engines keep their state in globals.  Lines that may match must
+/// still be checked with vim_regexec_multi(), in order.
+///
+/// @return  allocated bitmap with bit "lnum - line1" set for lines that may
+///          match, NULL when it's quicker to check every line.
+static uint64_t *match_lines_find(regmmatch_T *rmp, linenr_T line1, linenr_T line2)
+{
+  int count = MIN(MIN(os_cpu_count(), MATCH_LINES_MAXPARTS),
+                  (line2 - line1 + 1) / MATCH_LINES_PART);
+  if (count < 2) {
+    return NULL;
+  }
+  mlsnap_T *snap = ml_snapshot(curbuf);
+  if (snap == NULL) {
+    return NULL;
+  }
+  matchpart_T *part = xcalloc((size_t)count, sizeof(matchpart_T));
+  uint64_t *bits = xcalloc((size_t)(line2 - line1) / 64 + 1, sizeof(uint64_t));
+  // Parts start at a multiple of 64 lines, so that no two threads set bits
+  // in the same word.
+  linenr_T per_part = ((line2 - line1 + 1) / count + 63) / 64 * 64;
+  for (int i = 0; i < count; i++) {
+    part[i] = (matchpart_T){
+      .snap = snap,
+      .rf = vim_regfilter_new(rmp, curbuf),
+      .first = line1,
+      .start = line1 + i * per_part,
+      .end = i == count - 1 ? line2 : MIN(line2, line1 + (i + 1) * per_part - 1),
+      .bits = bits,
+    };
+  }
+  if (part[0].rf == NULL) {
+    // No check that can be done by another thread.
+    ml_snapshot_free(snap);
+    xfree(part);
+    xfree(bits);
+    return NULL;
+  }
+
+  // Check the first part in this thread while the others are done by worker
+  // threads. When a thread can't be created its part is checked here too.
+  bool *started = xcalloc((size_t)count, sizeof(bool));
+  for (int i = 1; i < count; i++) {
+    started[i] = part[i].start <= part[i].end
+                 && uv_thread_create(&part[i].thread, match_lines_part, &part[i]) == 0;
+  }
+  match_lines_part(&part[0]);
+  for (int i = 1; i < count; i++) {
+    if (started[i]) {
+      uv_thread_join(&part[i].thread);
+    } else if (part[i].start <= part[i].end) {
+      match_lines_part(&part[i]);
+    }
+  }
+  xfree(started);
+
+  for (int i = 0; i < count; i++) {
+    vim_regfilter_free(part[i].rf);
+  }
+  xfree(part);
+  ml_snapshot_free(snap);
+  return bits;
+}
+
+/// Check bit "lnum - line1" of "bits" from match_lines_find().
+static bool match_lines_may_match(const uint64_t *bits, linenr_T line1, linenr_T lnum)
+{
+  size_t bit = (size_t)(lnum - line1);
+  return (bits[bit / 64] >> (bit % 64)) & 1;
+}
+
 /// Perform a substitution from line eap->line1 to line eap->line2 using the
 /// command pointed to by eap->arg which should be of the form:
 ///
@@ -3745,6 +3862,13 @@ static int do_sub(exarg_T *eap, const proftime_T timeout, const int cmdpreview_n
     }
   }
 
+  // Find the lines that may match with worker threads.  An expression may
+  // change any line, then every line is checked.
+  uint64_t *may_match = NULL;
+  if (cmdpreview_ns <= 0 && !(sub[0] == '\\' && sub[1] == '=')) {
+    may_match = match_lines_find(&regmatch, eap->line1, eap->line2);
+  }
+
   // Check for a match on each line.
   // If preview: limit to max('cmdwinheight', viewport).
   linenr_T line2 = eap->line2;
@@ -3754,8 +3878,13 @@ static int do_sub(exarg_T *eap, const proftime_T timeout, const int cmdpreview_n
        && (cmdpreview_ns <= 0 || preview_lines.lines_needed <= (linenr_T)p_cwh
            || lnum <= curwin->w_botline);
        lnum++) {
-    int nmatch = vim_regexec_multi(&regmatch, curwin, curbuf, lnum,
-                                   0, NULL, NULL);
+    // Lines were only inserted or deleted above "lnum".
+    const linenr_T old_lnum = lnum - (curbuf->b_ml.ml_line_count - old_line_count);
+    int nmatch = 0;
+    if (may_match == NULL || old_lnum < eap->line1 || old_lnum > eap->line2
+        || match_lines_may_match(may_match, eap->line1, old_lnum)) {
+      nmatch = vim_regexec_multi(&regmatch, curwin, curbuf, lnum, 0, NULL, NULL);
+    }
     if (nmatch) {
       colnr_T copycol;
       colnr_T matchcol;
@@ -4466,6 +4595,7 @@ skip:
       got_quit = true;
     }
   }
+  xfree(may_match);
 
   curbuf->deleted_bytes2 = 0;
 
@@ -4710,9 +4840,13 @@ void ex_global(exarg_T *eap)
   } else {
     int ndone = 0;
     // pass 1: set marks for each (not) matching line
+    uint64_t *may_match = match_lines_find(&regmatch, eap->line1, eap->line2);
     for (lnum = eap->line1; lnum <= eap->line2 && !got_int; lnum++) {
       // a match on this line?
-      int match = vim_regexec_multi(&regmatch, curwin, curbuf, lnum, 0, NULL, NULL);
+      int match = 0;
+      if (may_match == NULL || match_lines_may_match(may_match, eap->line1, lnum)) {
+        match = vim_regexec_multi(&regmatch, curwin, curbuf, lnum, 0, NULL, NULL);
+      }
       if (regmatch.regprog == NULL) {
         break;  // re-compiling regprog failed
       }
@@ -4722,6 +4856,7 @@ void ex_global(exarg_T *eap)
       }
       line_breakcheck();
     }
+    xfree(may_match);
 
     // pass 2: execute the command for each line that has been marked
     if (got_int) {
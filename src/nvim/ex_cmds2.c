@@ -152,6 +152,14 @@ bool check_changed(buf_T *buf, int flags)
   bufref_T bufref;
   set_bufref(&bufref, buf);
 
+  // Writing in the background may still reset 'modified'.
+  if (!forceit && buf->b_write_job != NULL) {
+    buf_write_wait(buf, false);
+    if (!bufref_valid(&bufref)) {
+      return false;
+    }
+  }
+
   if (!forceit
       && bufIsChanged(buf)
       && ((flags & CCGD_MULTWIN) || buf->b_nwindows <= 1)
@@ -315,6 +323,9 @@ bool check_changed_any(bool hidden, bool unload)
   int bufnum = 0;
   size_t bufcount = 0;
 
+  // Writing in the background may still reset 'modified'.
+  buf_write_wait_all();
+
   // Make a list of all buffers, with the most important ones first.
   FOR_ALL_BUFFERS(buf) {
     bufcount++;
@@ -783,6 +794,11 @@ void ex_checktime(exarg_T *eap)
 
   no_check_timestamps = 0;
   if (eap->addr_count == 0) {    // default is all buffers
+    // Don't trust the watchers, they may miss changes, e.g. on a network
+    // file system.
+    FOR_ALL_BUFFERS(buf) {
+      buf->b_watch_stale = true;
+    }
     check_timestamps(false);
   } else {
     buf_T *buf = buflist_findnr((int)eap->line2);
@@ -30,6 +30,9 @@
 #include "nvim/errors.h"
 #include "nvim/eval.h"
 #include "nvim/eval/vars.h"
+#include "nvim/event/fs_event.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
 #include "nvim/ex_cmds_defs.h"
 #include "nvim/ex_eval.h"
 #include "nvim/fileio.h"
@@ -43,6 +46,7 @@
 #include "nvim/iconv_defs.h"
 #include "nvim/log.h"
 #include "nvim/macros_defs.h"
+#include "nvim/main.h"
 #include "nvim/mbyte.h"
 #include "nvim/mbyte_defs.h"
 #include "nvim/memfile.h"
@@ -93,6 +97,31 @@
 # define UV_FS_COPYFILE_FICLONE 0
 #endif
 
+/// Size of a part of a file that is scanned by a worker thread, see
+/// readfile_scan().
+#define READFILE_SCAN_PART (4 * 1024 * 1024)
+#define READFILE_SCAN_MAXPARTS 16
+/// Number of bytes of a file read at a time by readfile_scan_fd().
+#define READFILE_SCAN_READ (16 * READFILE_SCAN_PART)
+
+/// Minimal size of a file that is checked to be valid UTF-8 before reading
+/// it, to avoid reading it again with the next encoding in 'fileencodings'.
+#define READFILE_UTF8_CHECK (1024 * 1024)
+
+/// Part of a file scanned by readfile_scan_part(), possibly in a worker thread.
+typedef struct {
+  const uint8_t *start;
+  const uint8_t *end;
+  bool check_utf8;      ///< check for valid UTF-8
+  bool allow_tail;      ///< accept an incomplete UTF-8 sequence at "end"
+  bool valid;           ///< [out] valid UTF-8 or not checked
+  size_t lines;         ///< [out] number of NLs
+  size_t first_len;     ///< [out] bytes before the first NL, all when none
+  size_t last_len;      ///< [out] bytes after the last NL
+  size_t max_len;       ///< [out] longest line between two NLs
+  uv_thread_t thread;
+} fscan_T;
+
 #include "fileio.c.generated.h"
 
 static const char *e_auchangedbuf = N_("E812: Autocommands changed buffer or buffer name");
@@ -137,7 +166,7 @@ void filemess(buf_T *buf, char *name, char *s)
 ///
 /// 1. We allocate blocks with try_malloc, as big as possible.
 /// 2. Each block is filled with characters from the file with a single read().
-/// 3. The lines are inserted in the buffer with ml_append().
+/// 3. The lines are inserted in the buffer with ml_append_bulk().
 ///
 /// (caller must check that fname != NULL, unless READ_STDIN is used)
 ///
@@ -188,6 +217,7 @@ int readfile(char *fname, char *sfname, linenr_T from, linenr_T lines_to_skip,
   bool read_undo_file = false;
   int split = 0;  // number of split lines
   linenr_T linecnt;
+  mlbulk_T bulk = { 0 };                // lines being appended
   bool error = false;                   // errors encountered
   int ff_error = EOL_UNKNOWN;           // file format with errors
   ptrdiff_t linerest = 0;               // remaining chars in line
@@ -217,6 +247,7 @@ int readfile(char *fname, char *sfname, linenr_T from, linenr_T lines_to_skip,
   bool fenc_alloced;                    // fenc_next is in allocated memory
   char *fenc_next = NULL;        // next item in 'fencs' or NULL
   bool advance_fenc = false;
+  bool utf8_checked = false;            // checked all of the file is UTF-8
   int real_size = 0;
   iconv_t iconv_fd = (iconv_t)-1;       // descriptor for iconv() or -1
   bool did_iconv = false;               // true when iconv() failed and trying
@@ -722,6 +753,9 @@ int readfile(char *fname, char *sfname, linenr_T from, linenr_T lines_to_skip,
   // "iconv_fd" When != -1 did conversion with iconv().
 retry:
 
+  // The lines collected so far must be in the buffer before deleting them.
+  ml_append_bulk_end(&bulk);
+
   if (file_rewind) {
     if (read_buffer) {
       read_buf_lnum = 1;
@@ -742,6 +776,7 @@ retry:
     }
     conv_error = 0;
   }
+  ml_append_bulk_start(&bulk, curbuf, lnum, newfile ? ML_APPEND_NEW : 0);
 
   // When retrying with another "fenc" and the first time "fileformat"
   // will be reset.
@@ -878,6 +913,39 @@ retry:
     }
   }
 
+  // A large file may be mapped into memory instead of being read, the text
+  // of a block of lines is then only copied when it is used.
+  if (p_lazyload > 0 && newfile && wasempty && !skip_read && !filtering
+      && !read_stdin && !read_buffer && !read_fifo && !recoverymode
+      && !read_undo_file && from == 0 && lines_to_skip == 0
+      && lines_to_read == MAXLNUM && tmpname == NULL
+      && iconv_fd == (iconv_t)-1 && (!converted || fio_flags == FIO_UCSBOM)) {
+    linenr_T lazy_lines = readfile_lazy(fd, &fenc, &fenc_alloced, fenc_next, fio_flags,
+                                        &fileformat, try_unix, try_dos, try_mac,
+                                        set_options, &filesize, &read_no_eol_lnum);
+    if (lazy_lines > 0) {
+      if (set_options) {
+        set_fileformat(fileformat, OPT_LOCAL);
+      }
+      lnum = lazy_lines;
+      // The empty line of the buffer was already replaced.
+      wasempty = false;
+      linecnt = 0;
+      goto failed;
+    }
+  }
+
+  // Finding out that a big file is not UTF-8 near its end means reading it
+  // again with the next encoding, check all of it quickly first.
+  if (can_retry && !converted && !utf8_checked && !curbuf->b_p_bin && !skip_read
+      && !read_buffer && lines_to_skip == 0 && lines_to_read == MAXLNUM) {
+    utf8_checked = true;
+    if (!readfile_utf8_check(fd)) {
+      advance_fenc = true;
+      goto retry;
+    }
+  }
+
   while (!error && !got_int) {
     // We allocate as much space for the file as we can get, plus
     // space for the old line plus room for one terminating NUL.
@@ -1013,13 +1081,11 @@ retry:
                 goto rewind_retry;
               }
               if (conv_error == 0) {
-                conv_error = curbuf->b_ml.ml_line_count
-                             - linecnt + 1;
+                conv_error = lnum - from + 1;
               }
             } else if (illegal_byte == 0) {
               // Remember the first linenr with an illegal byte
-              illegal_byte = curbuf->b_ml.ml_line_count
-                             - linecnt + 1;
+              illegal_byte = lnum - from + 1;
             }
             if (bad_char_behavior == BAD_DROP) {
               *(ptr - conv_restlen) = NUL;
@@ -1123,7 +1189,7 @@ retry:
             goto rewind_retry;
           }
           if (conv_error == 0) {
-            conv_error = readfile_linenr(linecnt, ptr, top);
+            conv_error = readfile_linenr(lnum - from, ptr, top);
           }
 
           // Deal with a bad byte and continue with the next.
@@ -1233,7 +1299,7 @@ retry:
                   goto rewind_retry;
                 }
                 if (conv_error == 0) {
-                  conv_error = readfile_linenr(linecnt, ptr, (char *)p);
+                  conv_error = readfile_linenr(lnum - from, ptr, (char *)p);
                 }
                 if (bad_char_behavior == BAD_DROP) {
                   continue;
@@ -1261,7 +1327,7 @@ retry:
                   goto rewind_retry;
                 }
                 if (conv_error == 0) {
-                  conv_error = readfile_linenr(linecnt, ptr, (char *)p);
+                  conv_error = readfile_linenr(lnum - from, ptr, (char *)p);
                 }
                 if (bad_char_behavior == BAD_DROP) {
                   continue;
@@ -1302,7 +1368,7 @@ retry:
                   goto rewind_retry;
                 }
                 if (conv_error == 0) {
-                  conv_error = readfile_linenr(linecnt, ptr, (char *)p);
+                  conv_error = readfile_linenr(lnum - from, ptr, (char *)p);
                 }
                 if (bad_char_behavior == BAD_DROP) {
                   continue;
@@ -1329,6 +1395,8 @@ retry:
 
         // Reading UTF-8: Check if the bytes are valid UTF-8.
         for (p = (uint8_t *)ptr;; p++) {
+          // Quickly skip over valid bytes, stops at a bad or incomplete one.
+          p += utf_valid_len((char *)p, (size_t)(((uint8_t *)ptr + size) - p));
           int todo = (int)(((uint8_t *)ptr + size) - p);
 
           if (todo <= 0) {
@@ -1368,12 +1436,12 @@ retry:
 
               // When we did a conversion report an error.
               if (iconv_fd != (iconv_t)-1 && conv_error == 0) {
-                conv_error = readfile_linenr(linecnt, ptr, (char *)p);
+                conv_error = readfile_linenr(lnum - from, ptr, (char *)p);
               }
 
               // Remember the first linenr with an illegal byte
               if (conv_error == 0 && illegal_byte == 0) {
-                illegal_byte = readfile_linenr(linecnt, ptr, (char *)p);
+                illegal_byte = readfile_linenr(lnum - from, ptr, (char *)p);
               }
 
               // Drop, keep or replace the bad byte.
@@ -1410,61 +1478,7 @@ rewind_retry:
 
       // when reading the first part of a file: guess EOL type
       if (fileformat == EOL_UNKNOWN) {
-        // First try finding a NL, for Dos and Unix
-        if (try_dos || try_unix) {
-          // Reset the carriage return counter.
-          if (try_mac) {
-            try_mac = 1;
-          }
-
-          for (p = (uint8_t *)ptr; p < (uint8_t *)ptr + size; p++) {
-            if (*p == NL) {
-              if (!try_unix
-                  || (try_dos && p > (uint8_t *)ptr && p[-1] == CAR)) {
-                fileformat = EOL_DOS;
-              } else {
-                fileformat = EOL_UNIX;
-              }
-              break;
-            } else if (*p == CAR && try_mac) {
-              try_mac++;
-            }
-          }
-
-          // Don't give in to EOL_UNIX if EOL_MAC is more likely
-          if (fileformat == EOL_UNIX && try_mac) {
-            // Need to reset the counters when retrying fenc.
-            try_mac = 1;
-            try_unix = 1;
-            for (; p >= (uint8_t *)ptr && *p != CAR; p--) {}
-            if (p >= (uint8_t *)ptr) {
-              for (p = (uint8_t *)ptr; p < (uint8_t *)ptr + size; p++) {
-                if (*p == NL) {
-                  try_unix++;
-                } else if (*p == CAR) {
-                  try_mac++;
-                }
-              }
-              if (try_mac > try_unix) {
-                fileformat = EOL_MAC;
-              }
-            }
-          } else if (fileformat == EOL_UNKNOWN && try_mac == 1) {
-            // Looking for CR but found no end-of-line markers at all:
-            // use the default format.
-            fileformat = default_fileformat();
-          }
-        }
-
-        // No NL found: may use Mac format
-        if (fileformat == EOL_UNKNOWN && try_mac) {
-          fileformat = EOL_MAC;
-        }
-
-        // Still nothing found?  Use first format in 'ffs'
-        if (fileformat == EOL_UNKNOWN) {
-          fileformat = default_fileformat();
-        }
+        fileformat = readfile_guess_ff((uint8_t *)ptr, size, &try_unix, try_dos, &try_mac);
 
         // May set 'p_ff' if editing a new file.
         if (set_options) {
@@ -1480,6 +1494,10 @@ rewind_retry:
       while (++ptr, --size >= 0) {
         // catch most common case first
         if ((c = *ptr) != NUL && c != CAR && c != NL) {
+          // skip to just before the next NUL, CR or NL
+          ptrdiff_t skip = (ptrdiff_t)xmemcspn(ptr + 1, CAR, NL, (size_t)size);
+          ptr += skip;
+          size -= skip;
           continue;
         }
         if (c == NUL) {
@@ -1490,7 +1508,7 @@ rewind_retry:
           if (skip_count == 0) {
             *ptr = NUL;                     // end of line
             len = (colnr_T)(ptr - line_start + 1);
-            if (ml_append(lnum, line_start, len, newfile) == FAIL) {
+            if (ml_append_bulk(&bulk, line_start, len) == FAIL) {
               error = true;
               break;
             }
@@ -1513,6 +1531,10 @@ rewind_retry:
       ptr--;
       while (++ptr, --size >= 0) {
         if ((c = *ptr) != NUL && c != NL) {        // catch most common case
+          // skip to just before the next NUL or NL
+          ptrdiff_t skip = (ptrdiff_t)xmemcspn(ptr + 1, NL, NL, (size_t)size);
+          ptr += skip;
+          size -= skip;
           continue;
         }
         if (c == NUL) {
@@ -1545,7 +1567,7 @@ rewind_retry:
                 ff_error = EOL_DOS;
               }
             }
-            if (ml_append(lnum, line_start, len, newfile) == FAIL) {
+            if (ml_append_bulk(&bulk, line_start, len) == FAIL) {
               error = true;
               break;
             }
@@ -1570,6 +1592,10 @@ rewind_retry:
   }
 
 failed:
+  if (ml_append_bulk_end(&bulk) == FAIL) {
+    error = true;
+  }
+
   // not an error, max. number of lines reached
   if (error && read_count == 0) {
     error = false;
@@ -1901,16 +1927,377 @@ bool is_dev_fd_file(char *fname)
 }
 #endif
 
+/// Guess the end-of-line format from the first "size" bytes of a file.
+/// "try_unix", "try_dos" and "try_mac" tell which formats are allowed, the
+/// counters "try_unix" and "try_mac" are updated.
+///
+/// @return  EOL_UNIX, EOL_DOS or EOL_MAC.
+static int readfile_guess_ff(const uint8_t *ptr, ptrdiff_t size, int *try_unix, int try_dos,
+                             int *try_mac)
+{
+  int fileformat = EOL_UNKNOWN;
+  const uint8_t *p;
+
+  // First try finding a NL, for Dos and Unix
+  if (try_dos || *try_unix) {
+    // Reset the carriage return counter.
+    if (*try_mac) {
+      *try_mac = 1;
+    }
+
+    for (p = ptr; p < ptr + size; p++) {
+      if (*p == NL) {
+        if (!*try_unix
+            || (try_dos && p > ptr && p[-1] == CAR)) {
+          fileformat = EOL_DOS;
+        } else {
+          fileformat = EOL_UNIX;
+        }
+        break;
+      } else if (*p == CAR && *try_mac) {
+        (*try_mac)++;
+      }
+    }
+
+    // Don't give in to EOL_UNIX if EOL_MAC is more likely
+    if (fileformat == EOL_UNIX && *try_mac) {
+      // Need to reset the counters when retrying fenc.
+      *try_mac = 1;
+      *try_unix = 1;
+      for (; p >= ptr && *p != CAR; p--) {}
+      if (p >= ptr) {
+        for (p = ptr; p < ptr + size; p++) {
+          if (*p == NL) {
+            (*try_unix)++;
+          } else if (*p == CAR) {
+            (*try_mac)++;
+          }
+        }
+        if (*try_mac > *try_unix) {
+          fileformat = EOL_MAC;
+        }
+      }
+    } else if (fileformat == EOL_UNKNOWN && *try_mac == 1) {
+      // Looking for CR but found no end-of-line markers at all:
+      // use the default format.
+      fileformat = default_fileformat();
+    }
+  }
+
+  // No NL found: may use Mac format
+  if (fileformat == EOL_UNKNOWN && *try_mac) {
+    fileformat = EOL_MAC;
+  }
+
+  // Still nothing found?  Use first format in 'ffs'
+  if (fileformat == EOL_UNKNOWN) {
+    fileformat = default_fileformat();
+  }
+  return fileformat;
+}
+
+/// Try filling the empty current buffer with file "fd" without keeping its
+/// text: the file is kept open and the text of a block of lines is only read
+/// when it is used, see ml_open_lazy(). Only done for a file of at
+/// least 'lazyload' Kbyte that needs no conversion, has no BOM, is valid
+/// UTF-8 (unless 'binary' is set) and has Unix line endings.
+///
+/// @param[in,out] fencp  'fileencoding' to use, "ucs-bom" is replaced with
+///                       the encoding that follows it in "fenc_next".
+/// @param[in,out] fileformatp  end-of-line format, guessed when EOL_UNKNOWN.
+/// @param[out] filesizep  number of bytes read.
+/// @param[out] no_eol_lnump  set when the last line has no end-of-line.
+///
+/// @return  The number of lines, zero when the file must be read normally.
+static linenr_T readfile_lazy(int fd, char **fencp, bool *fenc_allocedp, char *fenc_next,
+                              int fio_flags, int *fileformatp, int try_unix, int try_dos,
+                              int try_mac, bool set_options, off_T *filesizep,
+                              linenr_T *no_eol_lnump)
+{
+  FileInfo file_info;
+  if (!os_fileinfo_fd(fd, &file_info) || !S_ISREG(file_info.stat.st_mode)) {
+    return 0;
+  }
+  uint64_t fsize = os_fileinfo_size(&file_info);
+  if (fsize < (uint64_t)p_lazyload * 1024 || fsize > SIZE_MAX) {
+    return 0;
+  }
+  size_t size = (size_t)fsize;
+  // Look at the same number of bytes as the first read() would get.
+  size_t head_len = MIN(size, 0x10000);
+  char *head = xmalloc(head_len);
+  char *fenc = NULL;
+  bool fenc_alloced = false;
+  if (os_pread(fd, head, head_len, 0) != (ptrdiff_t)head_len) {
+    goto fail;
+  }
+
+  int blen;
+  // Removing a BOM and converting is left to the normal code.
+  if (!curbuf->b_p_bin && size >= 2
+      && check_for_bom(head, (int)MIN(size, 4), &blen, FIO_ALL) != NULL) {
+    goto fail;
+  }
+  if (fio_flags == FIO_UCSBOM) {
+    // Without a BOM the next item in 'fileencodings' is used.
+    if (fenc_next == NULL) {
+      fenc = "";
+    } else {
+      fenc = next_fenc(&fenc_next, &fenc_alloced);
+    }
+    if (need_conversion(fenc)) {
+      goto fail;
+    }
+  }
+
+  int fileformat = *fileformatp;
+  if (fileformat == EOL_UNKNOWN) {
+    fileformat = readfile_guess_ff((uint8_t *)head, (ptrdiff_t)head_len,
+                                   &try_unix, try_dos, &try_mac);
+  }
+  fscan_T sum;
+  if (fileformat != EOL_UNIX
+      || !readfile_lazy_check(fd, size, !curbuf->b_p_bin, &sum)) {
+    goto fail;
+  }
+
+  // The text is read from the file again when it is used, with another file
+  // descriptor that stays open for the buffer.
+  int lazy_fd = os_dup(fd);
+  if (lazy_fd < 0) {
+    goto fail;
+  }
+  os_set_cloexec(lazy_fd);
+  linenr_T lines = ml_open_lazy(curbuf, lazy_fd, size);  // takes over "lazy_fd"
+  if (lines == 0) {
+    goto fail;  // truncated meanwhile
+  }
+  xfree(head);
+  if (sum.last_len > 0) {  // no NL after the last line
+    if (set_options) {
+      curbuf->b_p_eol = false;
+    }
+    *no_eol_lnump = lines;
+  }
+  if (fenc != NULL) {
+    if (*fenc_allocedp) {
+      xfree(*fencp);
+    }
+    *fencp = fenc;
+    *fenc_allocedp = fenc_alloced;
+  }
+  *fileformatp = fileformat;
+  *filesizep = (off_T)size;
+  return lines;
+
+fail:
+  if (fenc_alloced) {
+    xfree(fenc);
+  }
+  xfree(head);
+  return 0;
+}
+
+/// Scan the bytes of "arg", a fscan_T: count lines and check for valid UTF-8.
+static void readfile_scan_part(void *arg)
+{
+  fscan_T *part = arg;
+  const uint8_t *p = part->start;
+  const uint8_t *const end = part->end;
+
+  part->valid = true;
+  part->lines = 0;
+  part->max_len = 0;
+  while (true) {
+    const uint8_t *nl = memchr(p, NL, (size_t)(end - p));
+    const uint8_t *line_end = nl == NULL ? end : nl;
+    size_t len = (size_t)(line_end - p);
+    if (part->check_utf8 && part->valid) {
+      // A NL is never part of a UTF-8 sequence, check each line by itself.
+      size_t valid_len = utf_valid_len((char *)p, len);
+      if (valid_len < len) {
+        int todo = (int)MIN(len - valid_len, 8);
+        part->valid = nl == NULL && part->allow_tail && (size_t)todo == len - valid_len
+                      && utf_ptr2len_len((char *)p + valid_len, todo) > todo;
+      }
+    }
+    if (part->lines == 0) {
+      part->first_len = len;
+    } else if (nl != NULL) {
+      part->max_len = MAX(part->max_len, len);
+    }
+    if (nl == NULL) {
+      part->last_len = len;
+      break;
+    }
+    part->lines++;
+    p = nl + 1;
+  }
+}
+
+/// Scan the "size" bytes at "map" with readfile_scan_part(). A big file is
+/// split in parts that are scanned in parallel, one per CPU.
+///
+/// @param[out] parts  allocated array of the scanned parts, to be freed.
+///
+/// @return  The number of parts.
+static int readfile_scan(const char *map, size_t size, bool check_utf8, bool allow_tail,
+                         fscan_T **parts)
+{
+  int count = 1;
+  if (size >= 2 * READFILE_SCAN_PART) {
+    count = (int)MIN((size_t)MIN(os_cpu_count(), READFILE_SCAN_MAXPARTS),
+                     size / READFILE_SCAN_PART);
+  }
+
+  fscan_T *part = xcalloc((size_t)count, sizeof(fscan_T));
+  const uint8_t *const start = (const uint8_t *)map;
+  const uint8_t *const end = start + size;
+  const uint8_t *p = start;
+  for (int i = 0; i < count; i++) {
+    const uint8_t *part_end = end;
+    if (i < count - 1) {
+      // Don't split a UTF-8 sequence.
+      part_end = MAX(p, start + size / (size_t)count * (size_t)(i + 1));
+      while (part_end < end && (*part_end & 0xc0) == 0x80) {
+        part_end++;
+      }
+    }
+    part[i] = (fscan_T){
+      .start = p,
+      .end = part_end,
+      .check_utf8 = check_utf8,
+      .allow_tail = allow_tail && i == count - 1,
+    };
+    p = part_end;
+  }
+
+  // Scan the first part in this thread while the others are done by worker
+  // threads. When a thread can't be created its part is scanned here too.
+  bool *started = xcalloc((size_t)count, sizeof(bool));
+  for (int i = 1; i < count; i++) {
+    started[i] = uv_thread_create(&part[i].thread, readfile_scan_part, &part[i]) == 0;
+  }
+  readfile_scan_part(&part[0]);
+  for (int i = 1; i < count; i++) {
+    if (started[i]) {
+      uv_thread_join(&part[i].thread);
+    } else {
+      readfile_scan_part(&part[i]);
+    }
+  }
+  xfree(started);
+
+  *parts = part;
+  return count;
+}
+
+/// Add the result of scanning "part" to "sum", the result of scanning the
+/// text before it.
+static void readfile_scan_add(fscan_T *sum, const fscan_T *part)
+{
+  sum->valid = sum->valid && part->valid;
+  if (part->lines == 0) {
+    // The whole part continues the last line.
+    if (sum->lines == 0) {
+      sum->first_len += part->first_len;
+    }
+    sum->last_len += part->first_len;
+    return;
+  }
+  size_t joined = sum->last_len + part->first_len;  // line across the boundary
+  if (sum->lines == 0) {
+    sum->first_len = joined;
+  } else {
+    sum->max_len = MAX(sum->max_len, joined);
+  }
+  sum->max_len = MAX(sum->max_len, part->max_len);
+  sum->last_len = part->last_len;
+  sum->lines += part->lines;
+}
+
+/// Scan the first "size" bytes of file "fd" with readfile_scan(), reading
+/// READFILE_SCAN_READ bytes at a time. Stops early when the text is found not
+/// to be valid UTF-8.
+///
+/// @param[out] sum  result for the whole text, as if it was one part.
+///
+/// @return  false when the file could not be read, e.g. it was truncated.
+static bool readfile_scan_fd(int fd, size_t size, bool check_utf8, bool allow_tail, fscan_T *sum)
+{
+  *sum = (fscan_T){ .valid = true };
+  char *buf = xmalloc(MIN(size, READFILE_SCAN_READ));
+  bool ok = true;
+  size_t off = 0;
+  while (off < size && sum->valid) {
+    size_t len = MIN(size - off, READFILE_SCAN_READ);
+    if (os_pread(fd, buf, len, off) != (ptrdiff_t)len) {
+      ok = false;
+      break;
+    }
+    if (off + len < size) {
+      // Don't split a UTF-8 sequence, the rest is read again.
+      for (size_t i = 1; i <= 4 && i < len; i++) {
+        if (((uint8_t)buf[len - i] & 0xc0) != 0x80) {
+          len -= i;
+          break;
+        }
+      }
+    }
+    fscan_T *parts;
+    int count = readfile_scan(buf, len, check_utf8, allow_tail && off + len == size, &parts);
+    for (int i = 0; i < count; i++) {
+      readfile_scan_add(sum, &parts[i]);
+    }
+    xfree(parts);
+    off += len;
+  }
+  xfree(buf);
+  return ok;
+}
+
+/// Check if the first "size" bytes of file "fd" can be loaded by
+/// ml_open_lazy(): no line is MAXCOL bytes or longer, there are less than
+/// MAXLNUM lines and, when "check_utf8" is true, the text is valid UTF-8.
+///
+/// @param[out] sum  result of scanning the text, see readfile_scan_fd().
+static bool readfile_lazy_check(int fd, size_t size, bool check_utf8, fscan_T *sum)
+{
+  return readfile_scan_fd(fd, size, check_utf8, false, sum)
+         && sum->valid && sum->lines < MAXLNUM - 1 && sum->first_len < MAXCOL
+         && sum->max_len < MAXCOL && sum->last_len < MAXCOL;
+}
+
+/// Check if file "fd" is valid UTF-8, when it is a big regular file. An
+/// incomplete byte sequence at the end is accepted, a truncated file is more
+/// likely than a wrong encoding.
+///
+/// @return  false when it is not valid UTF-8, true otherwise or when not
+///          checked.
+static bool readfile_utf8_check(int fd)
+{
+  FileInfo file_info;
+  if (!os_fileinfo_fd(fd, &file_info) || !S_ISREG(file_info.stat.st_mode)) {
+    return true;
+  }
+  uint64_t fsize = os_fileinfo_size(&file_info);
+  if (fsize < READFILE_UTF8_CHECK || fsize > SIZE_MAX) {
+    return true;
+  }
+  fscan_T sum;
+  return !readfile_scan_fd(fd, (size_t)fsize, true, true, &sum) || sum.valid;
+}
+
 /// From the current line count and characters read after that, estimate the
 /// line number where we are now.
 /// Used for error messages that include a line number.
 ///
-/// @param linecnt  line count before reading more bytes
-/// @param p        start of more bytes read
-/// @param endp     end of more bytes read
-static linenr_T readfile_linenr(linenr_T linecnt, char *p, const char *endp)
+/// @param lines_read  number of lines read before reading more bytes
+/// @param p           start of more bytes read
+/// @param endp        end of more bytes read
+static linenr_T readfile_linenr(linenr_T lines_read, char *p, const char *endp)
 {
-  linenr_T lnum = curbuf->b_ml.ml_line_count - linecnt + 1;
+  linenr_T lnum = lines_read + 1;
   for (char *s = p; s < endp; s++) {
     if (*s == '\n') {
       lnum++;
@@ -2772,9 +3159,17 @@ int check_timestamps(int focus)
     no_wait_return++;
     did_check_timestamps = true;
     already_warned = false;
+    // Handle pending file change notifications.
+    loop_poll_events(&main_loop, 0);
     FOR_ALL_BUFFERS(buf) {
-      // Only check buffers in a window.
-      if (buf->b_nwindows > 0) {
+      if (!p_fw) {
+        buf_watch_stop(buf);
+      } else if (buf->b_nwindows > 0 && buf->b_watcher == NULL) {
+        buf_watch_start(buf);
+      }
+      // Only check buffers in a window.  A watched file that did not change
+      // doesn't need to be checked.
+      if (buf->b_nwindows > 0 && (buf->b_watcher == NULL || buf->b_watch_stale)) {
         bufref_T bufref;
         set_bufref(&bufref, buf);
         const int n = buf_check_timestamp(buf);
@@ -2874,6 +3269,7 @@ int buf_check_timestamp(buf_T *buf)
       || busy) {
     return 0;
   }
+  buf->b_watch_stale = false;
 
   FileInfo file_info;
   bool file_info_ok;
@@ -3204,6 +3600,100 @@ void buf_store_file_info(buf_T *buf, FileInfo *file_info)
   buf->b_mtime_ns = file_info->stat.st_mtim.tv_nsec;
   buf->b_orig_size = os_fileinfo_size(file_info);
   buf->b_orig_mode = (int)file_info->stat.st_mode;
+  buf_watch_start(buf);
+}
+
+static bool watch_check_pending = false;
+
+/// Watch the file of buffer "buf" for changes made outside of Nvim, see
+/// 'filewatch'.  When the file is already watched, watch it again, it may
+/// have been replaced by another file.
+/// A buffer whose file cannot be watched has no watcher and is always
+/// checked by check_timestamps().
+void buf_watch_start(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (!p_fw || buf->terminal || buf->b_ffname == NULL || !bt_normal(buf)) {
+    return;
+  }
+
+  FsEventWatcher *watcher = xmalloc(sizeof(*watcher));
+  fs_event_watcher_init(&main_loop, watcher, (void *)(intptr_t)buf->b_fnum);
+  if (fs_event_watcher_start(watcher, buf_watch_cb, buf->b_ffname) != 0) {
+    // E.g. the file does not exist (yet).
+    fs_event_watcher_close(watcher, buf_watch_close_cb);
+    buf_watch_stop(buf);
+    return;
+  }
+
+  if (buf->b_watcher == NULL) {
+    // A change before the watcher started is not noticed, check once.
+    buf->b_watch_stale = true;
+  } else {
+    // Pending events of the old watcher are ignored.
+    fs_event_watcher_close(buf->b_watcher, buf_watch_close_cb);
+  }
+  buf->b_watcher = watcher;
+}
+
+/// Stop watching the file of buffer "buf".
+void buf_watch_stop(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (buf->b_watcher == NULL) {
+    return;
+  }
+  fs_event_watcher_close(buf->b_watcher, buf_watch_close_cb);
+  buf->b_watcher = NULL;
+  buf->b_watch_stale = true;
+}
+
+/// Stop watching the files of all buffers, when exiting.
+void buf_watch_stop_all(void)
+{
+  FOR_ALL_BUFFERS(buf) {
+    if (buf->b_watcher != NULL) {
+      // The event queues are freed before the close event could be handled.
+      buf->b_watcher->events = NULL;
+      buf_watch_stop(buf);
+    }
+  }
+}
+
+static void buf_watch_close_cb(FsEventWatcher *watcher, void *data)
+{
+  xfree(watcher);
+}
+
+/// Called when the file of a buffer changed, was deleted or renamed.
+static void buf_watch_cb(FsEventWatcher *watcher, int events, void *data)
+{
+  buf_T *buf = buflist_findnr((int)(intptr_t)data);
+  if (buf == NULL || buf->b_watcher != watcher) {
+    // Buffer was wiped out or watches another file by now.
+    return;
+  }
+
+  buf->b_watch_stale = true;
+  if (events & UV_RENAME) {
+    // The watcher keeps watching the old file, if it still exists.  Watch
+    // the file again when checking the timestamp.
+    buf_watch_stop(buf);
+  }
+
+  // Reload right away for 'autoread', the check is done when getting back
+  // to Normal or Insert mode.
+  if (p_fw && !watch_check_pending && buf->b_nwindows > 0
+      && (buf->b_p_ar >= 0 ? buf->b_p_ar : p_ar) && !bufIsChanged(buf)) {
+    watch_check_pending = true;
+    multiqueue_put(main_loop.events, buf_watch_check_event, NULL);
+  }
+}
+
+static void buf_watch_check_event(void **argv)
+{
+  watch_check_pending = false;
+  need_check_timestamps = true;
 }
 
 /// Adjust the line with missing eol, used for the next write.
@@ -85,7 +85,33 @@ EXTERN struct nvim_stats_s {
   int64_t fsync;
   int64_t redraw;
   int16_t log_skip;  // How many logs were tried and skipped before log_init.
-} g_stats INIT( = { 0, 0, 0 });
+  // Compressed memfile blocks, see 'memcompress'.
+  int64_t memcompress_hit;    // blocks used that were not compressed
+  int64_t memcompress_miss;   // blocks used that had to be uncompressed
+  int64_t memcompress_bytes;  // size of the compressed blocks before compression
+  int64_t memcompress_size;   // size of the compressed blocks
+  // Line size cache of windows, see linetabsize().
+  int64_t linesize_hit;
+  int64_t linesize_miss;
+  // Compiled patterns, see vim_regcomp_cached().
+  int64_t regcache_hit;
+  int64_t regcache_miss;
+  // 'hlsearch' match cache of windows, see next_search_hl().
+  int64_t hlcache_hit;
+  int64_t hlcache_miss;
+  // Blended attrs of 'winblend' and 'pumblend', see hl_blend_attrs().
+  int64_t blendcache_hit;
+  int64_t blendcache_miss;
+  // Window rows, see win_update().
+  int64_t rows_skipped;       // rows left alone that would look the same
+  int64_t rows_drawn;         // rows drawn by win_line()
+  // Output of the TUI, see tui_flush().
+  int64_t tui_bytes;          // bytes written to the terminal
+  int64_t tui_frames;         // flushes of the screen
+  // Redraws for events, see 'redrawrate'.
+  int64_t frames_coalesced;   // redraws held back until the next frame
+  int64_t frames_dropped;     // frames missed while the loop was busy
+} g_stats INIT( = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
 
 // Values for "starting".
 #define NO_SCREEN       2       // no screen updating yet
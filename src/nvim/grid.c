@@ -52,6 +52,17 @@ static size_t linebuf_size = 0;
 // The maximum byte size of a glyph is MAX_SCHAR_SIZE (including the final NUL).
 static Set(glyph) glyph_cache = SET_INIT;
 
+// Cells per row chunk. Rows are allocated in whole chunks, so that a grid that
+// is resized by a few columns keeps its rows where they are, and rows start
+// 64 bytes apart.
+#define GRID_ROW_CHUNK 16
+#define GRID_POOL_SIZE 4
+
+// Storage of freed grids, taken again by grid_alloc() when it fits. Only the
+// arrays and their capacity are used.
+static ScreenGrid grid_pool[GRID_POOL_SIZE];
+static int grid_pool_len = 0;
+
 /// Determine if dedicated window grid should be used or the default_grid
 ///
 /// If UI did not request multigrid support, draw all windows on the
@@ -320,7 +331,9 @@ void grid_clear_line(ScreenGrid *grid, size_t off, int width, bool valid)
 
 void grid_invalidate(ScreenGrid *grid)
 {
-  memset(grid->attrs, -1, sizeof(sattr_T) * (size_t)grid->rows * (size_t)grid->cols);
+  for (int row = 0; row < grid->rows; row++) {
+    memset(grid->attrs + grid->line_offset[row], -1, sizeof(sattr_T) * (size_t)grid->cols);
+  }
 }
 
 static bool grid_invalid_row(ScreenGrid *grid, int row)
@@ -839,47 +852,100 @@ void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int col, int endcol
   }
 }
 
+/// Whether the storage of "grid" can hold "rows" by "columns" cells, without
+/// keeping much more memory than needed.
+static bool grid_storage_fits(const ScreenGrid *grid, int rows, int columns)
+{
+  size_t need = (size_t)rows * (size_t)columns;
+  size_t have = (size_t)grid->row_capacity * (size_t)grid->row_stride;
+  return grid->chars != NULL && rows <= grid->row_capacity && columns <= grid->row_stride
+         && need * 4 >= have;
+}
+
+/// Gives "grid" storage for "rows" by "columns" cells, from the pool when some
+/// fits, with its rows in order.
+static void grid_storage_alloc(ScreenGrid *grid, int rows, int columns)
+{
+  int i;
+  for (i = 0; i < grid_pool_len; i++) {
+    if (grid_storage_fits(&grid_pool[i], rows, columns)) {
+      break;
+    }
+  }
+  if (i < grid_pool_len) {
+    grid->chars = grid_pool[i].chars;
+    grid->attrs = grid_pool[i].attrs;
+    grid->vcols = grid_pool[i].vcols;
+    grid->line_offset = grid_pool[i].line_offset;
+    grid->row_stride = grid_pool[i].row_stride;
+    grid->row_capacity = grid_pool[i].row_capacity;
+    grid_pool[i] = grid_pool[--grid_pool_len];
+  } else {
+    // Leave room to grow, windows are often resized a bit at a time.
+    int stride = columns + columns / 8 + GRID_ROW_CHUNK;
+    grid->row_stride = stride - stride % GRID_ROW_CHUNK;
+    grid->row_capacity = rows + rows / 8;
+    size_t ncells = (size_t)grid->row_capacity * (size_t)grid->row_stride;
+    grid->chars = xmalloc(ncells * sizeof(schar_T));
+    grid->attrs = xmalloc(ncells * sizeof(sattr_T));
+    grid->vcols = xmalloc(ncells * sizeof(colnr_T));
+    grid->line_offset = xmalloc((size_t)grid->row_capacity * sizeof(*grid->line_offset));
+  }
+  for (int row = 0; row < grid->row_capacity; row++) {
+    grid->line_offset[row] = (size_t)row * (size_t)grid->row_stride;
+  }
+}
+
 void grid_alloc(ScreenGrid *grid, int rows, int columns, bool copy, bool valid)
 {
-  int new_row;
-  ScreenGrid ngrid = *grid;
   assert(rows >= 0 && columns >= 0);
-  size_t ncells = (size_t)rows * (size_t)columns;
-  ngrid.chars = xmalloc(ncells * sizeof(schar_T));
-  ngrid.attrs = xmalloc(ncells * sizeof(sattr_T));
-  ngrid.vcols = xmalloc(ncells * sizeof(colnr_T));
-  memset(ngrid.vcols, -1, ncells * sizeof(colnr_T));
-  ngrid.line_offset = xmalloc((size_t)rows * sizeof(*ngrid.line_offset));
-
-  ngrid.rows = rows;
-  ngrid.cols = columns;
-
-  for (new_row = 0; new_row < ngrid.rows; new_row++) {
-    ngrid.line_offset[new_row] = (size_t)new_row * (size_t)ngrid.cols;
-
-    grid_clear_line(&ngrid, ngrid.line_offset[new_row], columns, valid);
-
-    if (copy) {
-      // If the screen is not going to be cleared, copy as much as
-      // possible from the old screen to the new one and clear the rest
-      // (used when resizing the window at the "--more--" prompt or when
-      // executing an external command, for the GUI).
-      if (new_row < grid->rows && grid->chars != NULL) {
-        int len = MIN(grid->cols, ngrid.cols);
-        memmove(ngrid.chars + ngrid.line_offset[new_row],
-                grid->chars + grid->line_offset[new_row],
-                (size_t)len * sizeof(schar_T));
-        memmove(ngrid.attrs + ngrid.line_offset[new_row],
-                grid->attrs + grid->line_offset[new_row],
-                (size_t)len * sizeof(sattr_T));
-        memmove(ngrid.vcols + ngrid.line_offset[new_row],
-                grid->vcols + grid->line_offset[new_row],
-                (size_t)len * sizeof(colnr_T));
+  if (grid_storage_fits(grid, rows, columns)) {
+    // Resize in place: rows that are kept only need their new columns cleared.
+    int old_rows = grid->rows;
+    int old_cols = grid->cols;
+    grid->rows = rows;
+    grid->cols = columns;
+    for (int row = 0; row < rows; row++) {
+      if (copy && row < old_rows) {
+        if (columns > old_cols) {
+          grid_clear_line(grid, grid->line_offset[row] + (size_t)old_cols, columns - old_cols,
+                          valid);
+        }
+      } else {
+        grid_clear_line(grid, grid->line_offset[row], columns, valid);
+      }
+    }
+  } else {
+    ScreenGrid ngrid = *grid;
+    grid_storage_alloc(&ngrid, rows, columns);
+    ngrid.rows = rows;
+    ngrid.cols = columns;
+
+    for (int new_row = 0; new_row < ngrid.rows; new_row++) {
+      grid_clear_line(&ngrid, ngrid.line_offset[new_row], columns, valid);
+
+      if (copy) {
+        // If the screen is not going to be cleared, copy as much as
+        // possible from the old screen to the new one and clear the rest
+        // (used when resizing the window at the "--more--" prompt or when
+        // executing an external command, for the GUI).
+        if (new_row < grid->rows && grid->chars != NULL) {
+          int len = MIN(grid->cols, ngrid.cols);
+          memmove(ngrid.chars + ngrid.line_offset[new_row],
+                  grid->chars + grid->line_offset[new_row],
+                  (size_t)len * sizeof(schar_T));
+          memmove(ngrid.attrs + ngrid.line_offset[new_row],
+                  grid->attrs + grid->line_offset[new_row],
+                  (size_t)len * sizeof(sattr_T));
+          memmove(ngrid.vcols + ngrid.line_offset[new_row],
+                  grid->vcols + grid->line_offset[new_row],
+                  (size_t)len * sizeof(colnr_T));
+        }
       }
     }
+    grid_free(grid);
+    *grid = ngrid;
   }
-  grid_free(grid);
-  *grid = ngrid;
 
   // Share a single scratch buffer for all grids, by
   // ensuring it is as wide as the widest grid.
@@ -896,17 +962,24 @@ void grid_alloc(ScreenGrid *grid, int rows, int columns, bool copy, bool valid)
   }
 }
 
+/// Frees the storage of "grid", or keeps it in the pool for grid_alloc().
 void grid_free(ScreenGrid *grid)
 {
-  xfree(grid->chars);
-  xfree(grid->attrs);
-  xfree(grid->vcols);
-  xfree(grid->line_offset);
+  if (grid->chars != NULL && grid_pool_len < GRID_POOL_SIZE) {
+    grid_pool[grid_pool_len++] = *grid;
+  } else {
+    xfree(grid->chars);
+    xfree(grid->attrs);
+    xfree(grid->vcols);
+    xfree(grid->line_offset);
+  }
 
   grid->chars = NULL;
   grid->attrs = NULL;
   grid->vcols = NULL;
   grid->line_offset = NULL;
+  grid->row_stride = 0;
+  grid->row_capacity = 0;
 }
 
 #ifdef EXITFREE
@@ -915,6 +988,13 @@ void grid_free_all_mem(void)
 {
   grid_free(&default_grid);
   grid_free(&msg_grid);
+  for (int i = 0; i < grid_pool_len; i++) {
+    xfree(grid_pool[i].chars);
+    xfree(grid_pool[i].attrs);
+    xfree(grid_pool[i].vcols);
+    xfree(grid_pool[i].line_offset);
+  }
+  grid_pool_len = 0;
   XFREE_CLEAR(msg_grid.dirty_col);
   xfree(linebuf_char);
   xfree(linebuf_attr);
@@ -1010,7 +1090,7 @@ void grid_assign_handle(ScreenGrid *grid)
 void grid_ins_lines(ScreenGrid *grid, int row, int line_count, int end, int col, int width)
 {
   int j;
-  unsigned temp;
+  size_t temp;
 
   if (line_count <= 0) {
     return;
@@ -1029,7 +1109,7 @@ void grid_ins_lines(ScreenGrid *grid, int row, int line_count, int end, int col,
       grid_clear_line(grid, grid->line_offset[j] + (size_t)col, width, false);
     } else {
       j = end - 1 - i;
-      temp = (unsigned)grid->line_offset[j];
+      temp = grid->line_offset[j];
       while ((j -= line_count) >= row) {
         grid->line_offset[j + line_count] = grid->line_offset[j];
       }
@@ -1050,7 +1130,7 @@ void grid_ins_lines(ScreenGrid *grid, int row, int line_count, int end, int col,
 void grid_del_lines(ScreenGrid *grid, int row, int line_count, int end, int col, int width)
 {
   int j;
-  unsigned temp;
+  size_t temp;
 
   if (line_count <= 0) {
     return;
@@ -1070,7 +1150,7 @@ void grid_del_lines(ScreenGrid *grid, int row, int line_count, int end, int col,
     } else {
       // whole width, moving the line pointers is faster
       j = row + i;
-      temp = (unsigned)grid->line_offset[j];
+      temp = grid->line_offset[j];
       while ((j += line_count) <= end - 1) {
         grid->line_offset[j - line_count] = grid->line_offset[j];
       }
@@ -41,6 +41,10 @@ enum {
 /// line_offset[n] is the offset from chars[], attrs[] and vcols[] for the start
 /// of line 'n'. These offsets are in general not linear, as full screen scrolling
 /// is implemented by rotating the offsets in the line_offset array.
+///
+/// Each row takes "row_stride" cells, which may be more than "cols", and there
+/// is room for "row_capacity" rows. This way resizing the grid by a few cells
+/// keeps its storage, see grid_alloc().
 typedef struct ScreenGrid ScreenGrid;
 struct ScreenGrid {
   handle_T handle;
@@ -58,6 +62,10 @@ struct ScreenGrid {
   int rows;
   int cols;
 
+  // the size of the storage: cells per row and number of rows.
+  int row_stride;
+  int row_capacity;
+
   // The state of the grid is valid. Otherwise it needs to be redrawn.
   bool valid;
 
@@ -99,7 +107,7 @@ struct ScreenGrid {
   bool pending_comp_index_update;
 };
 
-#define SCREEN_GRID_INIT { 0, NULL, NULL, NULL, NULL, NULL, 0, 0, false, \
+#define SCREEN_GRID_INIT { 0, NULL, NULL, NULL, NULL, NULL, 0, 0, 0, 0, false, \
                            false, false, true, 0, \
                            0, 0, 0, 0, 0,  false, true }
 
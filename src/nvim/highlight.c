@@ -42,6 +42,22 @@ static Map(int, int) blend_attr_entries = MAP_INIT;
 static Map(int, int) blendthrough_attr_entries = MAP_INIT;
 static Set(cstr_t) urls = SET_INIT;
 
+/// Direct-mapped cache in front of blend_attr_entries and
+/// blendthrough_attr_entries, see hl_blend_attrs(). It also remembers the
+/// attrs that do not blend, which saves looking up the front attr.
+typedef struct {
+  int gen;
+  int back_attr;
+  int front_attr;
+  int attr;
+  bool through;      ///< "through" argument
+  bool through_out;  ///< "through" result
+} BlendCacheEntry;
+
+#define BLEND_CACHE_SIZE 256
+static BlendCacheEntry blend_cache[BLEND_CACHE_SIZE];
+static int blend_cache_gen = 1;
+
 #define attr_entry(i) attr_entries.keys[i]
 
 /// highlight entries private to a namespace
@@ -176,6 +192,7 @@ void ns_hl_def(NS ns_id, int hl_id, HlAttrs attrs, int link_id, Dict(highlight)
                    .link_global = (attrs.rgb_ae_attr & HL_GLOBAL) };
   map_put(ColorKey, ColorItem)(&ns_hls, ColorKey(ns_id, hl_id), it);
   p->hl_cached = false;
+  rowfp_clear_all();
 }
 
 int ns_get_hl(NS *ns_hl, int hl_id, bool link, bool nodefault)
@@ -544,6 +561,7 @@ void clear_hl_tables(bool reinit)
     map_clear(int, &combine_attr_entries);
     map_clear(int, &blend_attr_entries);
     map_clear(int, &blendthrough_attr_entries);
+    blend_cache_gen++;
     set_clear(cstr_t, &urls);
     memset(highlight_attr_last, -1, sizeof(highlight_attr_last));
     highlight_attr_set_all();
@@ -563,6 +581,7 @@ void hl_invalidate_blends(void)
 {
   map_clear(int, &blend_attr_entries);
   map_clear(int, &blendthrough_attr_entries);
+  blend_cache_gen++;
   highlight_changed();
   update_window_hl(curwin, true);
 }
@@ -701,6 +720,26 @@ int hl_blend_attrs(int back_attr, int front_attr, bool *through)
     return front_attr;
   }
 
+  BlendCacheEntry *entry = &blend_cache[((unsigned)back_attr * 31 + (unsigned)front_attr * 2
+                                         + *through) % BLEND_CACHE_SIZE];
+  if (entry->gen == blend_cache_gen && entry->back_attr == back_attr
+      && entry->front_attr == front_attr && entry->through == *through) {
+    g_stats.blendcache_hit++;
+    *through = entry->through_out;
+    return entry->attr;
+  }
+  g_stats.blendcache_miss++;
+
+  bool through_in = *through;
+  int attr = blend_attrs(back_attr, front_attr, through);
+  *entry = (BlendCacheEntry){ .gen = blend_cache_gen, .back_attr = back_attr,
+                              .front_attr = front_attr, .attr = attr, .through = through_in,
+                              .through_out = *through };
+  return attr;
+}
+
+static int blend_attrs(int back_attr, int front_attr, bool *through)
+{
   HlAttrs fattrs_raw = syn_attr2entry(front_attr);
   HlAttrs fattrs = get_colors_force(fattrs_raw);
   int ratio = fattrs.hl_blend;
@@ -2265,6 +2265,7 @@ void highlight_changed(void)
   int id_SNC = 0;
 
   need_highlight_changed = false;
+  rowfp_clear_all();
 
   // sentinel value. used when no highlight is active
   highlight_attr[HLF_NONE] = 0;
@@ -97,6 +97,7 @@
 #include "nvim/register.h"
 #include "nvim/runtime.h"
 #include "nvim/runtime_defs.h"
+#include "nvim/search.h"
 #include "nvim/shada.h"
 #include "nvim/statusline.h"
 #include "nvim/strings.h"
@@ -182,6 +183,8 @@ static bool event_teardown(void)
   server_teardown();
   signal_teardown();
   terminal_teardown();
+  buf_watch_stop_all();
+  search_index_teardown();
 
   return loop_close(&main_loop, true);
 }
@@ -191,6 +194,7 @@ static bool event_teardown(void)
 /// Needed for unit tests.
 void early_init(mparm_T *paramp)
 {
+  mem_count_init();
   os_hint_priority();
   estack_init();
   cmdline_init();
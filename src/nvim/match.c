@@ -6,7 +6,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "klib/kvec.h"
 #include "nvim/ascii_defs.h"
+#include "nvim/buffer.h"
 #include "nvim/buffer_defs.h"
 #include "nvim/charset.h"
 #include "nvim/drawscreen.h"
@@ -33,6 +35,7 @@
 #include "nvim/pos_defs.h"
 #include "nvim/profile.h"
 #include "nvim/regexp.h"
+#include "nvim/search.h"
 #include "nvim/strings.h"
 #include "nvim/types_defs.h"
 #include "nvim/vim_defs.h"
@@ -92,7 +95,7 @@ static int match_add(win_T *wp, const char *const grp, const char *const pat, in
   if ((hlg_id = syn_check_group(grp, strlen(grp))) == 0) {
     return -1;
   }
-  if (pat != NULL && (regprog = vim_regcomp(pat, RE_MAGIC)) == NULL) {
+  if (pat != NULL && (regprog = vim_regcomp_cached(pat, RE_MAGIC)) == NULL) {
     semsg(_(e_invarg2), pat);
     return -1;
   }
@@ -210,6 +213,7 @@ static int match_add(win_T *wp, const char *const grp, const char *const pat, in
   }
   m->mit_next = cur;
 
+  rowfp_clear_all();
   redraw_later(wp, rtype);
   return id;
 
@@ -260,6 +264,7 @@ static int match_delete(win_T *wp, int id, bool perr)
   }
   xfree(cur->mit_pos_array);
   xfree(cur);
+  rowfp_clear_all();
   redraw_later(wp, rtype);
   return 0;
 }
@@ -275,6 +280,7 @@ void clear_matches(win_T *wp)
     xfree(wp->w_match_head);
     wp->w_match_head = m;
   }
+  rowfp_clear_all();
   redraw_later(wp, UPD_SOME_VALID);
 }
 
@@ -315,10 +321,152 @@ void init_search_hl(win_T *wp, match_T *search_hl)
   search_hl->lnum = 0;
   search_hl->first_lnum = 0;
   search_hl->attr = win_hl_attr(wp, HLF_L);
+  hlsearch_cache_init(wp, search_hl);
 
   // time limit is set at the toplevel, for all windows
 }
 
+enum { HLCACHE_MAX = 10000, };  ///< max number of matches in the 'hlsearch' cache
+
+/// Check whether the 'hlsearch' match cache of window "wp" can be used for
+/// "search_hl" in this redraw, clear it when the matches it has may be wrong
+/// now.
+static void hlsearch_cache_init(win_T *wp, match_T *search_hl)
+{
+  HlMatchCache *hc = &wp->w_hlcache;
+  buf_T *const buf = wp->w_buffer;
+  const char *const pat = last_search_pat();
+  const size_t patlen = last_search_pat_len();
+  hc->hc_valid = search_hl->rm.regprog != NULL && pat != NULL
+                 && re_line_local(search_hl->rm.regprog);
+  if (!hc->hc_valid) {
+    return;
+  }
+  if (hc->hc_buf != buf
+      || hc->hc_changedtick != buf_get_changedtick(buf)
+      || hc->hc_pat == NULL
+      || hc->hc_patlen != patlen
+      || memcmp(hc->hc_pat, pat, patlen) != 0
+      || hc->hc_magic != last_search_pat_magic()
+      || hc->hc_ic != search_hl->rm.rmm_ic
+      || memcmp(hc->hc_chartab, buf->b_chartab, sizeof(hc->hc_chartab)) != 0) {
+    kv_size(hc->hc_matches) = 0;
+    hc->hc_buf = buf;
+    hc->hc_changedtick = buf_get_changedtick(buf);
+    xfree(hc->hc_pat);
+    hc->hc_pat = xmemdupz(pat, patlen);
+    hc->hc_patlen = patlen;
+    hc->hc_magic = last_search_pat_magic();
+    hc->hc_ic = search_hl->rm.rmm_ic;
+    memcpy(hc->hc_chartab, buf->b_chartab, sizeof(hc->hc_chartab));
+  }
+}
+
+/// Invalidate the 'hlsearch' matches of lines "lnum" to "lnume" (exclusive)
+/// of buffer "buf" in all windows after they were changed, and move the ones
+/// below them when "xtra" lines were inserted or deleted.  The cached
+/// patterns match within one line, other lines don't need to be searched
+/// again.
+/// Must be called right after b:changedtick was incremented for the change.
+void hlsearch_cache_changed(buf_T *buf, linenr_T lnum, linenr_T lnume, linenr_T xtra)
+{
+  varnumber_T const changedtick = buf_get_changedtick(buf);
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    HlMatchCache *hc = &wp->w_hlcache;
+    if (hc->hc_buf != buf) {
+      continue;
+    }
+    if (hc->hc_changedtick != changedtick - 1) {
+      // There was another change, don't know which lines it changed.
+      kv_size(hc->hc_matches) = 0;
+    } else {
+      size_t i = hlsearch_cache_find(hc, lnum, 0);
+      size_t j = hlsearch_cache_find(hc, lnume, 0);
+      kv_shift(hc->hc_matches, i, j - i);
+      for (; xtra != 0 && i < kv_size(hc->hc_matches); i++) {
+        kv_A(hc->hc_matches, i).hm_lnum += xtra;
+      }
+    }
+    hc->hc_changedtick = changedtick;
+  }
+}
+
+/// Forget the 'hlsearch' matches of buffer "buf" in all windows, when it is
+/// unloaded.
+void hlsearch_cache_clear_buf(buf_T *buf)
+{
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    if (wp->w_hlcache.hc_buf == buf) {
+      kv_size(wp->w_hlcache.hc_matches) = 0;
+      wp->w_hlcache.hc_buf = NULL;
+    }
+  }
+}
+
+/// @return  the index of the first item in the 'hlsearch' cache "hc" at or
+///          after column "col" of line "lnum".
+static size_t hlsearch_cache_find(const HlMatchCache *hc, linenr_T lnum, colnr_T col)
+{
+  size_t lo = 0;
+  size_t hi = kv_size(hc->hc_matches);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const HlMatch *hm = &kv_A(hc->hc_matches, mid);
+    if (hm->hm_lnum < lnum || (hm->hm_lnum == lnum && hm->hm_col < col)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/// Search for the 'hlsearch' match in line "lnum" at or after "col" like
+/// vim_regexec_multi(), using the match cache of window "wp" when possible.
+static int hlsearch_regexec(win_T *wp, match_T *shl, linenr_T lnum, colnr_T col, int *timed_out)
+{
+  HlMatchCache *hc = &wp->w_hlcache;
+  if (!hc->hc_valid || hc->hc_buf != shl->buf) {
+    return vim_regexec_multi(&shl->rm, wp, shl->buf, lnum, col, &shl->tm, timed_out);
+  }
+
+  size_t i = hlsearch_cache_find(hc, lnum, col);
+  if (i < kv_size(hc->hc_matches)
+      && kv_A(hc->hc_matches, i).hm_lnum == lnum && kv_A(hc->hc_matches, i).hm_col == col) {
+    HlMatch *hm = &kv_A(hc->hc_matches, i);
+    g_stats.hlcache_hit++;
+    if (hm->hm_start < 0) {
+      return 0;
+    }
+    shl->rm.startpos[0] = (lpos_T){ .lnum = 0, .col = hm->hm_start };
+    shl->rm.endpos[0] = (lpos_T){ .lnum = 0, .col = hm->hm_end };
+    return 1;
+  }
+
+  g_stats.hlcache_miss++;
+  int nmatched = vim_regexec_multi(&shl->rm, wp, shl->buf, lnum, col, &shl->tm, timed_out);
+  if (*timed_out || got_int || shl->rm.regprog == NULL
+      || (nmatched > 0 && (nmatched > 1 || shl->rm.startpos[0].lnum != 0
+                           || shl->rm.endpos[0].lnum != 0))) {
+    return nmatched;
+  }
+  if (kv_size(hc->hc_matches) >= HLCACHE_MAX) {
+    kv_size(hc->hc_matches) = 0;
+    i = 0;
+  }
+  kv_ensure_space(hc->hc_matches, 1);
+  memmove(&kv_A(hc->hc_matches, i + 1), &kv_A(hc->hc_matches, i),
+          (kv_size(hc->hc_matches) - i) * sizeof(HlMatch));
+  kv_size(hc->hc_matches)++;
+  kv_A(hc->hc_matches, i) = (HlMatch){
+    .hm_lnum = lnum,
+    .hm_col = col,
+    .hm_start = nmatched > 0 ? shl->rm.startpos[0].col : -1,
+    .hm_end = nmatched > 0 ? shl->rm.endpos[0].col : -1,
+  };
+  return nmatched;
+}
+
 /// @param shl       points to a match. Fill on match.
 /// @param posmatch  match item with positions
 /// @param mincol    minimal column for a match
@@ -449,8 +597,12 @@ static void next_search_hl(win_T *win, match_T *search_hl, match_T *shl, linenr_
                               && cur->mit_match.regprog == cur->mit_hl.rm.regprog);
       int timed_out = false;
 
-      nmatched = vim_regexec_multi(&shl->rm, win, shl->buf, lnum, matchcol,
-                                   &(shl->tm), &timed_out);
+      if (shl == search_hl) {
+        nmatched = hlsearch_regexec(win, shl, lnum, matchcol, &timed_out);
+      } else {
+        nmatched = vim_regexec_multi(&shl->rm, win, shl->buf, lnum, matchcol,
+                                     &(shl->tm), &timed_out);
+      }
       // Copy the regprog, in case it got freed and recompiled.
       if (regprog_is_copy) {
         cur->mit_match.regprog = cur->mit_hl.rm.regprog;
@@ -56,6 +56,7 @@
 #include "nvim/keycodes.h"
 #include "nvim/macros_defs.h"
 #include "nvim/mark.h"
+#include "nvim/math.h"
 #include "nvim/mbyte.h"
 #include "nvim/mbyte_defs.h"
 #include "nvim/memline.h"
@@ -65,6 +66,7 @@
 #include "nvim/option_vars.h"
 #include "nvim/optionstr.h"
 #include "nvim/os/os.h"
+#include "nvim/plines.h"
 #include "nvim/pos_defs.h"
 #include "nvim/strings.h"
 #include "nvim/types_defs.h"
@@ -1215,6 +1217,53 @@ bool utf_printable(int c)
 
 #endif
 
+/// Get the length of the longest start of "p[len]" that is valid UTF-8, as far
+/// as utf_ptr2len_len() can tell. An incomplete byte sequence at the end is
+/// not included. Quick for stretches of ASCII, which are checked 16 or 8 bytes
+/// at a time.
+size_t utf_valid_len(const char *p, size_t len)
+  FUNC_ATTR_PURE FUNC_ATTR_NONNULL_ALL FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  const uint8_t *s = (const uint8_t *)p;
+  size_t i = 0;
+
+  while (i < len) {
+#ifdef __SSE2__
+    while (len - i >= 16) {
+      int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)));
+      if (mask != 0) {
+        i += (size_t)xctz((uint64_t)mask);
+        break;
+      }
+      i += 16;
+    }
+#else
+    while (len - i >= 8) {
+      uint64_t w;
+      memcpy(&w, s + i, sizeof(w));
+      if (w & 0x8080808080808080ULL) {
+        break;
+      }
+      i += 8;
+    }
+#endif
+    if (i >= len) {
+      break;
+    }
+    if (s[i] < 0x80) {
+      i++;
+      continue;
+    }
+    int todo = (int)MIN(len - i, 8);
+    int l = utf_ptr2len_len((const char *)s + i, todo);
+    if (l == 1 || l > todo) {
+      break;  // illegal or incomplete byte sequence
+    }
+    i += (size_t)l;
+  }
+  return MIN(i, len);
+}
+
 // Get class of a Unicode character.
 // 0: white space
 // 1: punctuation
@@ -3007,6 +3056,8 @@ update:
   }
 
   xfree(cw_table_save);
+  linesize_cache_clear_all();
+  rowfp_clear_all();
   changed_window_setting_all();
   redraw_all_later(UPD_NOT_VALID);
 }
@@ -27,10 +27,13 @@
 /// mf_open_file()    open a swap file for an existing memfile
 /// mf_close()        close (and delete) a memfile
 /// mf_new()          create a new block in a memfile and lock it
+/// mf_new_lazy()     create a new block that is filled in when first used
 /// mf_get()          get an existing block and lock it
 /// mf_put()          unlock a block, may be marked for writing
 /// mf_free()         remove a block
 /// mf_sync()         sync changed parts of memfile to disk
+/// mf_sync_async()   idem, writing in a worker thread
+/// mf_share_start()  share the memory of blocks with a snapshot
 /// mf_release_all()  release as much memory as possible
 /// mf_trans_del()    may translate negative to positive block number
 /// mf_fullname()     make file name full path (use before first :cd)
@@ -43,19 +46,26 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <uv.h>
 
+#include "klib/kvec.h"
 #include "nvim/assert_defs.h"
 #include "nvim/buffer_defs.h"
 #include "nvim/errors.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
 #include "nvim/fileio.h"
 #include "nvim/gettext_defs.h"
 #include "nvim/globals.h"
+#include "nvim/macros_defs.h"
+#include "nvim/main.h"
 #include "nvim/map_defs.h"
 #include "nvim/memfile.h"
 #include "nvim/memfile_defs.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
 #include "nvim/message.h"
+#include "nvim/option_vars.h"
 #include "nvim/os/fs.h"
 #include "nvim/os/fs_defs.h"
 #include "nvim/os/input.h"
@@ -67,6 +77,42 @@
 
 #define MEMFILE_PAGE_SIZE 4096       /// default page size
 
+/// Number of filled in lazy blocks that are kept in memory. When there are
+/// twice as many, the oldest unused ones are emptied again.
+#define MF_LAZY_KEEP 1024
+
+/// Number of outdated entries in mf_comp_queue that are tolerated before they
+/// are removed.
+#define MF_COMP_SLACK 1024
+
+/// Compressed blocks use an LZ77 format: a sequence of a token byte, with the
+/// number of literal bytes in the high four bits and the match length minus
+/// MF_LZ_MINMATCH in the low four bits, a value of 15 being followed by bytes
+/// to add until one is not 255, the literal bytes, and a two byte offset of
+/// the match. The last sequence only has literal bytes.
+#define MF_LZ_MINMATCH 4
+#define MF_LZ_HASHBITS 12
+
+/// A copy of a block, to be written by a worker thread.
+typedef struct {
+  blocknr_T bnum;                    ///< number of the block, -1 for filler
+  off_T offset;                      ///< offset in the file
+  char *data;
+  size_t size;
+} mfwrite_T;
+
+struct mfsync {
+  uv_work_t req;
+  memfile_T *mfp;                    ///< NULL when the result was handled
+  int fd;
+  bool do_fsync;
+  kvec_t(mfwrite_T) writes;
+  uv_mutex_t mutex;
+  uv_cond_t cond;
+  bool done;                         ///< worker finished, protected by "mutex"
+  int status;                        ///< OK or FAIL, set by the worker
+};
+
 #include "memfile.c.generated.h"
 
 static const char e_block_was_not_locked[] = N_("E293: Block was not locked");
@@ -101,9 +147,19 @@ memfile_T *mf_open(char *fname, int flags)
 
   mfp->mf_free_first = NULL;         // free list is empty
   mfp->mf_dirty = MF_DIRTY_NO;
+  mfp->mf_sync_job = NULL;
+  mfp->mf_share = NULL;
   mfp->mf_hash = (PMap(int64_t)) MAP_INIT;
   mfp->mf_trans = (Map(int64_t, int64_t)) MAP_INIT;
   mfp->mf_page_size = MEMFILE_PAGE_SIZE;
+  mfp->mf_lazy_fd = -1;
+  mfp->mf_lazy_size = 0;
+  mfp->mf_lazy_changed = false;
+  kv_init(mfp->mf_lazy_loaded);
+  kv_init(mfp->mf_comp_queue);
+  mfp->mf_comp_head = 0;
+  mfp->mf_comp_pages = 0;
+  mfp->mf_comp_clock = 0;
 
   // Try to set the page size equal to device's block size. Speeds up I/O a lot.
   FileInfo file_info;
@@ -171,6 +227,7 @@ void mf_close(memfile_T *mfp, bool del_file)
   if (mfp == NULL) {                    // safety check
     return;
   }
+  mf_sync_wait(mfp);
   if (mfp->mf_fd >= 0 && close(mfp->mf_fd) < 0) {
     emsg(_(e_swapclose));
   }
@@ -181,13 +238,22 @@ void mf_close(memfile_T *mfp, bool del_file)
   // free entries in used list
   bhdr_T *hp;
   map_foreach_value(&mfp->mf_hash, hp, {
-    mf_free_bhdr(hp);
+    mf_free_bhdr(mfp, hp);
   })
+  if (mfp->mf_share != NULL) {
+    // The snapshot now owns all the shared memory.
+    mfp->mf_share->ms_mfp = NULL;
+  }
   while (mfp->mf_free_first != NULL) {  // free entries in free list
     xfree(mf_rem_free(mfp));
   }
   map_destroy(int64_t, &mfp->mf_hash);
   map_destroy(int64_t, &mfp->mf_trans);  // free hashtable and its items
+  if (mfp->mf_lazy_fd >= 0) {
+    close(mfp->mf_lazy_fd);
+  }
+  kv_destroy(mfp->mf_lazy_loaded);
+  kv_destroy(mfp->mf_comp_queue);
   mf_free_fnames(mfp);
   xfree(mfp);
 }
@@ -209,6 +275,7 @@ void mf_close_file(buf_T *buf, bool getlines)
     }
   }
 
+  mf_sync_wait(mfp);
   if (close(mfp->mf_fd) < 0) {           // close the file
     emsg(_(e_swapclose));
   }
@@ -277,6 +344,404 @@ bhdr_T *mf_new(memfile_T *mfp, bool negative, unsigned page_count)
   return hp;
 }
 
+/// Use the first "size" bytes of file "fd" for the text of lazy blocks, see
+/// mf_new_lazy(). The memfile takes over "fd" and closes it when it is
+/// closed.
+void mf_set_lazy_fd(memfile_T *mfp, int fd, size_t size)
+{
+  assert(mfp->mf_lazy_fd < 0);
+  mfp->mf_lazy_fd = fd;
+  mfp->mf_lazy_size = size;
+}
+
+/// Get a new block with a negative number, holding the "lines" lines in the
+/// "len" bytes at "off" in the lazy file. Unlike mf_new() no memory is allocated and the block is
+/// not locked. The memory is filled in by ml_lazy_fill() when the block is
+/// used with mf_get(), and emptied again when it was not changed and has not
+/// been used for a while.
+///
+/// @return  The number of the new block.
+blocknr_T mf_new_lazy(memfile_T *mfp, unsigned page_count, size_t off, unsigned len,
+                      unsigned lines)
+{
+  assert(mfp->mf_lazy_fd >= 0 && off + len <= mfp->mf_lazy_size);
+  bhdr_T *hp = xmalloc(sizeof(bhdr_T));
+  hp->bh_bnum = mfp->mf_blocknr_min--;
+  mfp->mf_neg_count++;
+  hp->bh_data = NULL;
+  hp->bh_page_count = page_count;
+  hp->bh_flags = BH_LAZY;
+  hp->bh_lazy_off = off;
+  hp->bh_lazy_len = len;
+  hp->bh_lazy_lines = lines;
+  hp->bh_comp = NULL;
+  hp->bh_used = 0;
+  pmap_put(int64_t)(&mfp->mf_hash, hp->bh_bnum, hp);
+  return hp->bh_bnum;
+}
+
+/// Fill in all lazy blocks and close the file they were read from. Used
+/// before the file is overwritten.
+void mf_lazy_load_all(memfile_T *mfp)
+{
+  if (mfp->mf_lazy_fd < 0) {
+    return;
+  }
+  bhdr_T *hp;
+  map_foreach_value(&mfp->mf_hash, hp, {
+    if (hp->bh_flags & BH_LAZY) {
+      mf_lazy_load(mfp, hp);
+      // Now it is a block like any other, not in the swap file yet.
+      hp->bh_flags = (hp->bh_flags & ~BH_LAZY) | BH_DIRTY;
+    }
+  })
+  close(mfp->mf_lazy_fd);
+  mfp->mf_lazy_fd = -1;
+  mfp->mf_lazy_size = 0;
+  kv_destroy(mfp->mf_lazy_loaded);
+  kv_init(mfp->mf_lazy_loaded);
+  mfp->mf_dirty = MF_DIRTY_YES;
+}
+
+/// Empty lazy blocks that were filled in and are not used, when there are
+/// more than MF_LAZY_KEEP of them. Must not be called while the caller still
+/// has a pointer into an unlocked block.
+void mf_lazy_trim(memfile_T *mfp)
+{
+  size_t size = kv_size(mfp->mf_lazy_loaded);
+  if (size < 2 * MF_LAZY_KEEP) {
+    return;
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < size; i++) {
+    blocknr_T nr = kv_A(mfp->mf_lazy_loaded, i);
+    bhdr_T *hp = pmap_get(int64_t)(&mfp->mf_hash, nr);
+    if (i < size - MF_LAZY_KEEP && hp != NULL && !(hp->bh_flags & BH_LOCKED)) {
+      mf_lazy_drop(mfp, hp);
+    } else if (hp != NULL && (hp->bh_flags & BH_LAZY) && hp->bh_data != NULL) {
+      kv_A(mfp->mf_lazy_loaded, kept++) = nr;
+    }
+  }
+  kv_size(mfp->mf_lazy_loaded) = kept;
+}
+
+/// Fill in the memory of lazy block "hp", if it is empty.
+static void mf_lazy_load(memfile_T *mfp, bhdr_T *hp)
+{
+  if (hp->bh_data != NULL) {
+    return;
+  }
+  hp->bh_data = xmalloc((size_t)mfp->mf_page_size * hp->bh_page_count);
+  ml_lazy_fill(mfp, hp);
+  kv_push(mfp->mf_lazy_loaded, hp->bh_bnum);
+}
+
+/// Empty the memory of lazy block "hp" when it was not changed.
+///
+/// @return  Whether memory was released.
+static bool mf_lazy_drop(memfile_T *mfp, bhdr_T *hp)
+{
+  if ((hp->bh_flags & (BH_LAZY | BH_DIRTY | BH_LOCKED)) != BH_LAZY
+      || hp->bh_data == NULL) {
+    return false;
+  }
+  mf_free_data(mfp, hp->bh_data);
+  hp->bh_data = NULL;
+  return true;
+}
+
+/// Fill in the memory of block "hp" when it is lazy or compressed.
+static void mf_fill(memfile_T *mfp, bhdr_T *hp)
+{
+  if (hp->bh_flags & BH_COMPRESSED) {
+    mf_uncompress(mfp, hp);
+  } else if (hp->bh_flags & BH_LAZY) {
+    mf_lazy_load(mfp, hp);
+  }
+}
+
+/// Add block "hp" to the end of mf_comp_queue, it was just used.
+static void mf_comp_push(memfile_T *mfp, bhdr_T *hp)
+{
+  if (hp->bh_used == 0) {
+    mfp->mf_comp_pages += hp->bh_page_count;
+  }
+  hp->bh_used = ++mfp->mf_comp_clock;
+  kv_push(mfp->mf_comp_queue, ((mfqueue_T){ .mq_bnum = hp->bh_bnum, .mq_used = hp->bh_used }));
+}
+
+/// Make the entry of block "hp" in mf_comp_queue outdated.
+static void mf_comp_forget(memfile_T *mfp, bhdr_T *hp)
+{
+  if (hp->bh_used != 0) {
+    mfp->mf_comp_pages -= hp->bh_page_count;
+    hp->bh_used = 0;
+  }
+}
+
+/// Free the compressed memory of block "hp" and its entry in mf_comp_queue.
+static void mf_comp_clear(memfile_T *mfp, bhdr_T *hp)
+{
+  mf_comp_forget(mfp, hp);
+  if (hp->bh_flags & BH_COMPRESSED) {
+    g_stats.memcompress_bytes -= (int64_t)mfp->mf_page_size * hp->bh_page_count;
+    g_stats.memcompress_size -= hp->bh_comp_len;
+    XFREE_CLEAR(hp->bh_comp);
+    hp->bh_flags &= ~BH_COMPRESSED;
+  }
+}
+
+/// Compress the blocks that were not used for the longest time, when there is
+/// no swap file and the blocks that are not compressed take more than
+/// 'memcompress' Kbyte. Must not be called while the caller still has a
+/// pointer into an unlocked block.
+void mf_comp_trim(memfile_T *mfp)
+{
+  if (mfp->mf_fd >= 0 || p_mcm <= 0) {
+    if (kv_size(mfp->mf_comp_queue) > 0) {
+      // Not used now, let all entries be outdated.
+      for (size_t i = mfp->mf_comp_head; i < kv_size(mfp->mf_comp_queue); i++) {
+        mfqueue_T mq = kv_A(mfp->mf_comp_queue, i);
+        bhdr_T *hp = pmap_get(int64_t)(&mfp->mf_hash, mq.mq_bnum);
+        if (hp != NULL && hp->bh_used == mq.mq_used) {
+          mf_comp_forget(mfp, hp);
+        }
+      }
+      kv_size(mfp->mf_comp_queue) = 0;
+      mfp->mf_comp_head = 0;
+    }
+    return;
+  }
+
+  size_t keep = MAX((size_t)p_mcm * 1024 / mfp->mf_page_size, 1);
+  // Compress a quarter more than needed, to not do this for every block.
+  if (mfp->mf_comp_pages > keep + keep / 4) {
+    while (mfp->mf_comp_pages > keep - keep / 4
+           && mfp->mf_comp_head < kv_size(mfp->mf_comp_queue)) {
+      mfqueue_T mq = kv_A(mfp->mf_comp_queue, mfp->mf_comp_head++);
+      bhdr_T *hp = pmap_get(int64_t)(&mfp->mf_hash, mq.mq_bnum);
+      if (hp == NULL || hp->bh_used != mq.mq_used) {
+        continue;  // used again later or freed
+      }
+      mf_comp_forget(mfp, hp);
+      // A locked block is added again when it is released.
+      if (!(hp->bh_flags & (BH_LOCKED | BH_LAZY))) {
+        mf_compress(mfp, hp);
+      }
+    }
+  }
+
+  // Remove outdated entries when there are many.
+  if (kv_size(mfp->mf_comp_queue) > 2 * mfp->mf_comp_pages + MF_COMP_SLACK) {
+    size_t kept = 0;
+    for (size_t i = mfp->mf_comp_head; i < kv_size(mfp->mf_comp_queue); i++) {
+      mfqueue_T mq = kv_A(mfp->mf_comp_queue, i);
+      bhdr_T *hp = pmap_get(int64_t)(&mfp->mf_hash, mq.mq_bnum);
+      if (hp != NULL && hp->bh_used == mq.mq_used) {
+        kv_A(mfp->mf_comp_queue, kept++) = mq;
+      }
+    }
+    kv_size(mfp->mf_comp_queue) = kept;
+    mfp->mf_comp_head = 0;
+  }
+}
+
+/// Compress the memory of block "hp". Nothing is done when it does not get
+/// at least an eighth smaller.
+///
+/// @return  Whether memory was released.
+static bool mf_compress(memfile_T *mfp, bhdr_T *hp)
+{
+  size_t size = (size_t)mfp->mf_page_size * hp->bh_page_count;
+  uint8_t *comp = xmalloc(size);
+  size_t len = mf_lz_encode(hp->bh_data, size, comp, size - size / 8);
+  if (len == 0) {
+    xfree(comp);
+    return false;
+  }
+  mf_free_data(mfp, hp->bh_data);
+  hp->bh_data = NULL;
+  hp->bh_comp = xrealloc(comp, len);
+  hp->bh_comp_len = (unsigned)len;
+  hp->bh_flags |= BH_COMPRESSED;
+  g_stats.memcompress_bytes += (int64_t)size;
+  g_stats.memcompress_size += (int64_t)len;
+  return true;
+}
+
+/// Uncompress the memory of block "hp".
+static void mf_uncompress(memfile_T *mfp, bhdr_T *hp)
+{
+  size_t size = (size_t)mfp->mf_page_size * hp->bh_page_count;
+  hp->bh_data = xmalloc(size);
+  if (!mf_lz_decode((uint8_t *)hp->bh_comp, hp->bh_comp_len, hp->bh_data, size)) {
+    siemsg(_(e_intern2), "mf_uncompress()");
+    memset(hp->bh_data, 0, size);
+  }
+  mf_comp_clear(mfp, hp);
+}
+
+static inline uint32_t mf_lz_read32(const uint8_t *p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/// Add the bytes for a length of "len" above 15 at "op".
+///
+/// @return  pointer after them, NULL when "oend" is reached.
+static uint8_t *mf_lz_put_len(uint8_t *op, const uint8_t *oend, size_t len)
+{
+  for (; len >= 255; len -= 255) {
+    if (op >= oend) {
+      return NULL;
+    }
+    *op++ = 255;
+  }
+  if (op >= oend) {
+    return NULL;
+  }
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+/// Add a sequence of the "lit" bytes at "anchor" and a match of "mlen" bytes
+/// at "offset" back at "op". Without a match when "offset" is zero.
+///
+/// @return  pointer after the sequence, NULL when "oend" is reached.
+static uint8_t *mf_lz_put_seq(uint8_t *op, const uint8_t *oend, const uint8_t *anchor, size_t lit,
+                              size_t offset, size_t mlen)
+{
+  if (op >= oend) {
+    return NULL;
+  }
+  uint8_t *token = op++;
+  *token = (uint8_t)(MIN(lit, 15) << 4);
+  if (lit >= 15 && (op = mf_lz_put_len(op, oend, lit - 15)) == NULL) {
+    return NULL;
+  }
+  if ((size_t)(oend - op) < lit) {
+    return NULL;
+  }
+  memcpy(op, anchor, lit);
+  op += lit;
+  if (offset == 0) {
+    return op;
+  }
+  if (oend - op < 2) {
+    return NULL;
+  }
+  *op++ = (uint8_t)(offset & 0xff);
+  *op++ = (uint8_t)(offset >> 8);
+  mlen -= MF_LZ_MINMATCH;
+  *token |= (uint8_t)MIN(mlen, 15);
+  if (mlen >= 15) {
+    op = mf_lz_put_len(op, oend, mlen - 15);
+  }
+  return op;
+}
+
+/// Compress the "len" bytes at "src" into "dst", which has room for "size"
+/// bytes. Fast rather than small: only the last position with the same four
+/// bytes is tried for a match.
+///
+/// @return  number of bytes used in "dst", zero when they don't fit.
+static size_t mf_lz_encode(const uint8_t *src, size_t len, uint8_t *dst, size_t size)
+{
+  uint32_t table[1 << MF_LZ_HASHBITS] = { 0 };
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  const uint8_t *const iend = src + len;
+  uint8_t *op = dst;
+  const uint8_t *const oend = dst + size;
+
+  while (iend - ip >= MF_LZ_MINMATCH) {
+    uint32_t seq = mf_lz_read32(ip);
+    uint32_t h = (seq * 2654435761U) >> (32 - MF_LZ_HASHBITS);
+    const uint8_t *ref = src + table[h];
+    table[h] = (uint32_t)(ip - src);
+    if (ref >= ip || ip - ref > 0xffff || mf_lz_read32(ref) != seq) {
+      ip++;
+      continue;
+    }
+    size_t offset = (size_t)(ip - ref);
+    const uint8_t *mend = ip + MF_LZ_MINMATCH;
+    for (ref += MF_LZ_MINMATCH; mend < iend && *mend == *ref; mend++, ref++) {}
+    op = mf_lz_put_seq(op, oend, anchor, (size_t)(ip - anchor), offset, (size_t)(mend - ip));
+    if (op == NULL) {
+      return 0;
+    }
+    ip = anchor = mend;
+  }
+  op = mf_lz_put_seq(op, oend, anchor, (size_t)(iend - anchor), 0, 0);
+  return op == NULL ? 0 : (size_t)(op - dst);
+}
+
+/// Uncompress the "len" bytes at "src" made by mf_lz_encode() into the
+/// "size" bytes at "dst".
+///
+/// @return  false when "src" is invalid or does not fill "dst" exactly.
+static bool mf_lz_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t size)
+{
+  const uint8_t *ip = src;
+  const uint8_t *const iend = src + len;
+  uint8_t *op = dst;
+  const uint8_t *const oend = dst + size;
+
+  while (ip < iend) {
+    unsigned token = *ip++;
+    size_t lit = token >> 4;
+    if (lit == 15) {
+      uint8_t b;
+      do {
+        if (ip >= iend) {
+          return false;
+        }
+        b = *ip++;
+        lit += b;
+      } while (b == 255);
+    }
+    if ((size_t)(iend - ip) < lit || (size_t)(oend - op) < lit) {
+      return false;
+    }
+    memcpy(op, ip, lit);
+    op += lit;
+    ip += lit;
+    if (ip == iend) {
+      break;  // the last sequence has no match
+    }
+
+    if (iend - ip < 2) {
+      return false;
+    }
+    size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    size_t mlen = token & 15;
+    if (mlen == 15) {
+      uint8_t b;
+      do {
+        if (ip >= iend) {
+          return false;
+        }
+        b = *ip++;
+        mlen += b;
+      } while (b == 255);
+    }
+    mlen += MF_LZ_MINMATCH;
+    if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(oend - op) < mlen) {
+      return false;
+    }
+    // The match may overlap with what it adds, copy byte by byte.
+    const uint8_t *ref = op - offset;
+    for (size_t i = 0; i < mlen; i++) {
+      op[i] = ref[i];
+    }
+    op += mlen;
+  }
+  return op == oend;
+}
+
 // Get existing block "nr" with "page_count" pages.
 //
 // Caller should first check a negative nr with mf_trans_del().
@@ -309,11 +774,23 @@ bhdr_T *mf_get(memfile_T *mfp, blocknr_T nr, unsigned page_count)
     hp->bh_flags = 0;
     hp->bh_page_count = page_count;
     if (mf_read(mfp, hp) == FAIL) {             // cannot read the block
-      mf_free_bhdr(hp);
+      mf_free_bhdr(mfp, hp);
       return NULL;
     }
   } else {
     pmap_del(int64_t)(&mfp->mf_hash, hp->bh_bnum, NULL);
+    if (hp->bh_flags & BH_COMPRESSED) {
+      g_stats.memcompress_miss++;
+    } else if (mfp->mf_fd < 0 && p_mcm > 0) {
+      g_stats.memcompress_hit++;
+    }
+    mf_fill(mfp, hp);
+    if (mfp->mf_share != NULL && set_has(ptr_t, &mfp->mf_share->ms_data, hp->bh_data)) {
+      // A snapshot uses this memory, the block may be changed: leave it to
+      // the snapshot and use a copy.
+      set_del(ptr_t, &mfp->mf_share->ms_data, hp->bh_data);
+      hp->bh_data = xmemdup(hp->bh_data, (size_t)mfp->mf_page_size * hp->bh_page_count);
+    }
   }
 
   hp->bh_flags |= BH_LOCKED;
@@ -335,7 +812,8 @@ void mf_put(memfile_T *mfp, bhdr_T *hp, bool dirty, bool infile)
   }
   flags &= ~BH_LOCKED;
   if (dirty) {
-    flags |= BH_DIRTY;
+    // The text no longer matches the mapped file.
+    flags = (flags & ~BH_LAZY) | BH_DIRTY;
     if (mfp->mf_dirty != MF_DIRTY_YES_NOSYNC) {
       mfp->mf_dirty = MF_DIRTY_YES;
     }
@@ -344,12 +822,16 @@ void mf_put(memfile_T *mfp, bhdr_T *hp, bool dirty, bool infile)
   if (infile) {
     mf_trans_add(mfp, hp);      // may translate negative in positive nr
   }
+  if (mfp->mf_fd < 0 && p_mcm > 0 && !(flags & BH_LAZY)) {
+    mf_comp_push(mfp, hp);
+  }
 }
 
 /// Signal block as no longer used (may put it in the free list).
 void mf_free(memfile_T *mfp, bhdr_T *hp)
 {
-  xfree(hp->bh_data);           // free data
+  mf_free_data(mfp, hp->bh_data);  // free data
+  mf_comp_clear(mfp, hp);
   pmap_del(int64_t)(&mfp->mf_hash, hp->bh_bnum, NULL);  // get *hp out of the hash table
   if (hp->bh_bnum < 0) {
     xfree(hp);                  // don't want negative numbers in free list
@@ -383,6 +865,8 @@ int mf_sync(memfile_T *mfp, int flags)
     return FAIL;
   }
 
+  mf_sync_wait(mfp);
+
   // Only a CTRL-C while writing will break us here, not one typed previously.
   got_int = false;
 
@@ -395,7 +879,8 @@ int mf_sync(memfile_T *mfp, int flags)
   // note, "last" block is typically earlier in the hash list
   map_foreach_value(&mfp->mf_hash, hp, {
     if (((flags & MFS_ALL) || hp->bh_bnum >= 0)
-        && (hp->bh_flags & BH_DIRTY)
+        && ((hp->bh_flags & BH_DIRTY)
+            || ((flags & MFS_ALL) && (hp->bh_flags & BH_LAZY) && hp->bh_bnum < 0))
         && (status == OK || (hp->bh_bnum >= 0
                              && hp->bh_bnum < mfp->mf_infile_count))) {
       if ((flags & MFS_ZERO) && hp->bh_bnum != 0) {
@@ -437,6 +922,192 @@ int mf_sync(memfile_T *mfp, int flags)
   return status;
 }
 
+/// Like mf_sync() with no flags, but the dirty blocks are copied and then
+/// written, and fsync'ed when "do_fsync" is true, by a worker thread. Waiting
+/// for the disk does not block typing. Other ways of using the swap file
+/// first wait for the worker to finish, see mf_sync_wait().
+///
+/// @return  FAIL when there is no file, OK otherwise.
+int mf_sync_async(memfile_T *mfp, bool do_fsync)
+{
+  if (mfp->mf_fd < 0) {
+    // there is no file, nothing to do
+    mfp->mf_dirty = MF_DIRTY_NO;
+    return FAIL;
+  }
+  if (mfp->mf_sync_job != NULL) {
+    // Still busy, the remaining dirty blocks are synced next time.
+    return OK;
+  }
+
+  mfsync_T *job = xcalloc(1, sizeof(mfsync_T));
+  bhdr_T *hp;
+  map_foreach_value(&mfp->mf_hash, hp, {
+    if (hp->bh_bnum >= 0 && (hp->bh_flags & BH_DIRTY)) {
+      mf_sync_add(mfp, job, hp);
+    }
+  })
+  mfp->mf_dirty = MF_DIRTY_NO;
+  if (kv_size(job->writes) == 0 && !do_fsync) {
+    xfree(job);
+    return OK;
+  }
+
+  job->mfp = mfp;
+  job->fd = mfp->mf_fd;
+  job->do_fsync = do_fsync;
+  uv_mutex_init(&job->mutex);
+  uv_cond_init(&job->cond);
+  job->req.data = job;
+  mfp->mf_sync_job = job;
+  uv_queue_work(&main_loop.uv, &job->req, mf_sync_work, mf_sync_done);
+  return OK;
+}
+
+/// Copy block "hp" into "job". Like mf_write(), blocks in front of it are
+/// added first when it is beyond the end of the file, to avoid gaps.
+static void mf_sync_add(memfile_T *mfp, mfsync_T *job, bhdr_T *hp)
+{
+  unsigned page_size = mfp->mf_page_size;
+
+  mf_fill(mfp, hp);
+  while (true) {
+    blocknr_T nr = hp->bh_bnum;  // block nr which is being written
+    bhdr_T *hp2 = hp;
+    if (nr > mfp->mf_infile_count) {            // beyond end of file
+      nr = mfp->mf_infile_count;
+      hp2 = pmap_get(int64_t)(&mfp->mf_hash, nr);  // NULL is a freed block
+    }
+    if (hp2 != NULL) {
+      mf_fill(mfp, hp2);
+    }
+    unsigned page_count = hp2 == NULL ? 1 : hp2->bh_page_count;
+    size_t size = (size_t)page_size * page_count;
+    mfwrite_T w = {
+      .bnum = hp2 == NULL ? -1 : nr,
+      .offset = (off_T)page_size * nr,
+      .data = xmemdup(hp2 == NULL ? hp->bh_data : hp2->bh_data, size),
+      .size = size,
+    };
+    kv_push(job->writes, w);
+
+    if (hp2 != NULL) {
+      hp2->bh_flags &= ~BH_DIRTY;
+    }
+    if (nr + (blocknr_T)page_count > mfp->mf_infile_count) {  // appended to file
+      mfp->mf_infile_count = nr + page_count;
+    }
+    if (nr == hp->bh_bnum) {                       // added the desired block
+      break;
+    }
+  }
+}
+
+/// Write the blocks of a sync job. Runs in a worker thread: must not use
+/// anything but the job.
+static void mf_sync_work(uv_work_t *req)
+{
+  mfsync_T *job = req->data;
+  int status = OK;
+
+  for (size_t i = 0; i < kv_size(job->writes) && status == OK; i++) {
+    mfwrite_T *w = &kv_A(job->writes, i);
+    size_t done = 0;
+    while (done < w->size) {
+      uv_fs_t fs_req;
+      uv_buf_t buf = uv_buf_init(w->data + done, (unsigned)(w->size - done));
+      int r = uv_fs_write(NULL, &fs_req, job->fd, &buf, 1, w->offset + (off_T)done, NULL);
+      uv_fs_req_cleanup(&fs_req);
+      if (r == UV_EINTR) {
+        continue;
+      }
+      if (r <= 0) {
+        status = FAIL;
+        break;
+      }
+      done += (size_t)r;
+    }
+  }
+  if (status == OK && job->do_fsync) {
+    uv_fs_t fs_req;
+    if (uv_fs_fsync(NULL, &fs_req, job->fd, NULL) < 0) {
+      status = FAIL;
+    }
+    uv_fs_req_cleanup(&fs_req);
+  }
+
+  uv_mutex_lock(&job->mutex);
+  job->status = status;
+  job->done = true;
+  uv_cond_signal(&job->cond);
+  uv_mutex_unlock(&job->mutex);
+}
+
+/// Called in the main thread when the worker finished a sync job.
+static void mf_sync_done(uv_work_t *req, int status)
+{
+  mfsync_T *job = req->data;
+  if (job->mfp != NULL) {
+    mf_sync_finish(job);
+  }
+  uv_cond_destroy(&job->cond);
+  uv_mutex_destroy(&job->mutex);
+  xfree(job);
+}
+
+/// Wait for the worker thread to finish syncing "mfp", if it is busy.
+/// Must be done before anything else reads, writes or closes the swap file.
+void mf_sync_wait(memfile_T *mfp)
+{
+  mfsync_T *job = mfp->mf_sync_job;
+  if (job == NULL) {
+    return;
+  }
+  uv_mutex_lock(&job->mutex);
+  while (!job->done) {
+    uv_cond_wait(&job->cond, &job->mutex);
+  }
+  uv_mutex_unlock(&job->mutex);
+  mf_sync_finish(job);
+}
+
+/// Handle the result of sync job "job". The job itself is freed by
+/// mf_sync_done().
+static void mf_sync_finish(mfsync_T *job)
+{
+  memfile_T *mfp = job->mfp;
+  job->mfp = NULL;
+  mfp->mf_sync_job = NULL;
+
+  if (job->status == OK) {
+    if (job->do_fsync) {
+      g_stats.fsync++;
+    }
+  } else {
+    // Not written, the blocks are dirty again. Like mf_sync() this does
+    // not set mf_dirty, to avoid trying all the time.
+    for (size_t i = 0; i < kv_size(job->writes); i++) {
+      bhdr_T *hp = pmap_get(int64_t)(&mfp->mf_hash, kv_A(job->writes, i).bnum);
+      if (hp != NULL) {
+        hp->bh_flags |= BH_DIRTY;
+      }
+    }
+    multiqueue_put(main_loop.events, mf_sync_error_event, NULL);
+  }
+  for (size_t i = 0; i < kv_size(job->writes); i++) {
+    xfree(kv_A(job->writes, i).data);
+  }
+  kv_destroy(job->writes);
+}
+
+static void mf_sync_error_event(void **argv)
+{
+  if (!did_swapwrite_msg) {
+    emsg(_("E297: Write error in swap file"));
+  }
+  did_swapwrite_msg = true;
+}
+
 /// Set dirty flag for all blocks in memory file with a positive block number.
 /// These are blocks that need to be written to a newly created swapfile.
 void mf_set_dirty(memfile_T *mfp)
@@ -461,20 +1132,37 @@ bool mf_release_all(void)
   FOR_ALL_BUFFERS(buf) {
     memfile_T *mfp = buf->b_ml.ml_mfp;
     if (mfp != NULL) {
+      // Lazy blocks can be filled in again from the mapped file.
+      bhdr_T *lazy_hp;
+      map_foreach_value(&mfp->mf_hash, lazy_hp, {
+        retval |= mf_lazy_drop(mfp, lazy_hp);
+      })
+
       // If no swap file yet, try to open one.
       if (mfp->mf_fd < 0 && buf->b_may_swap) {
         ml_open_file(buf);
       }
 
+      // Without a swap file blocks can still be compressed.
+      if (mfp->mf_fd < 0 && p_mcm > 0) {
+        bhdr_T *comp_hp;
+        map_foreach_value(&mfp->mf_hash, comp_hp, {
+          if (!(comp_hp->bh_flags & (BH_LOCKED | BH_LAZY | BH_COMPRESSED))) {
+            mf_comp_forget(mfp, comp_hp);
+            retval |= mf_compress(mfp, comp_hp);
+          }
+        })
+      }
+
       // Flush as many blocks as possible, only if there is a swapfile.
       if (mfp->mf_fd >= 0) {
         for (int i = 0; i < (int)map_size(&mfp->mf_hash);) {
           bhdr_T *hp = mfp->mf_hash.values[i];
-          if (!(hp->bh_flags & BH_LOCKED)
+          if (!(hp->bh_flags & (BH_LOCKED | BH_LAZY))
               && (!(hp->bh_flags & BH_DIRTY)
                   || mf_write(mfp, hp) != FAIL)) {
             pmap_del(int64_t)(&mfp->mf_hash, hp->bh_bnum, NULL);
-            mf_free_bhdr(hp);
+            mf_free_bhdr(mfp, hp);
             retval = true;
             // Rerun with the same value of i. another item will have taken
             // its place (or it was the last)
@@ -494,16 +1182,75 @@ static bhdr_T *mf_alloc_bhdr(memfile_T *mfp, unsigned page_count)
   bhdr_T *hp = xmalloc(sizeof(bhdr_T));
   hp->bh_data = xmalloc((size_t)mfp->mf_page_size * page_count);
   hp->bh_page_count = page_count;
+  hp->bh_comp = NULL;
+  hp->bh_used = 0;
   return hp;
 }
 
 /// Free a block header and its block memory.
-static void mf_free_bhdr(bhdr_T *hp)
+static void mf_free_bhdr(memfile_T *mfp, bhdr_T *hp)
 {
-  xfree(hp->bh_data);
+  mf_free_data(mfp, hp->bh_data);
+  mf_comp_clear(mfp, hp);
   xfree(hp);
 }
 
+/// Free block memory "data", unless a snapshot uses it, see mf_share_start().
+static void mf_free_data(memfile_T *mfp, void *data)
+{
+  if (mfp->mf_share != NULL && set_has(ptr_t, &mfp->mf_share->ms_data, data)) {
+    set_del(ptr_t, &mfp->mf_share->ms_data, data);  // the snapshot frees it
+  } else {
+    xfree(data);
+  }
+}
+
+/// Start sharing block memory with a snapshot. Only one snapshot can share
+/// memory with a memfile at a time.
+///
+/// @return  NULL when another snapshot still shares memory.
+mfshare_T *mf_share_start(memfile_T *mfp)
+{
+  if (mfp->mf_share != NULL) {
+    return NULL;
+  }
+  mfshare_T *share = xcalloc(1, sizeof(mfshare_T));
+  share->ms_data = (Set(ptr_t)) SET_INIT;
+  share->ms_mfp = mfp;
+  mfp->mf_share = share;
+  return share;
+}
+
+/// Let the snapshot of "share" also use the memory of block "hp". The block
+/// must have been filled in. As long as it is shared mf_get() makes a copy
+/// before giving the block to a caller, the memory itself does not change.
+void mf_share_block(mfshare_T *share, bhdr_T *hp)
+{
+  set_put(ptr_t, &share->ms_data, hp->bh_data);
+}
+
+/// The snapshot of "share" no longer uses memory "data": free it when the
+/// memfile does not use it either.
+void mf_share_drop(mfshare_T *share, void *data)
+{
+  if (share->ms_mfp != NULL && set_has(ptr_t, &share->ms_data, data)) {
+    set_del(ptr_t, &share->ms_data, data);  // still used by the memfile
+  } else {
+    xfree(data);
+  }
+}
+
+/// Stop sharing memory, after mf_share_drop() was used for all the memory
+/// given to mf_share_block().
+void mf_share_end(mfshare_T *share)
+{
+  if (share->ms_mfp != NULL) {
+    share->ms_mfp->mf_share = NULL;
+  }
+  set_destroy(ptr_t, &share->ms_data);
+  xfree(share);
+}
+
 /// Insert a block in the free list.
 static void mf_ins_free(memfile_T *mfp, bhdr_T *hp)
 {
@@ -532,6 +1279,7 @@ static int mf_read(memfile_T *mfp, bhdr_T *hp)
   if (mfp->mf_fd < 0) {     // there is no file, can't read
     return FAIL;
   }
+  mf_sync_wait(mfp);  // the block may not have been written yet
 
   unsigned page_size = mfp->mf_page_size;
   // TODO(elmart): Check (page_size * hp->bh_bnum) within off_T bounds.
@@ -568,7 +1316,9 @@ static int mf_write(memfile_T *mfp, bhdr_T *hp)
     // there is no file and there was no file, can't write
     return FAIL;
   }
+  mf_sync_wait(mfp);
 
+  mf_fill(mfp, hp);
   if (hp->bh_bnum < 0) {    // must assign file block number
     if (mf_trans_add(mfp, hp) == FAIL) {
       return FAIL;
@@ -595,6 +1345,7 @@ static int mf_write(memfile_T *mfp, bhdr_T *hp)
     if (hp2 == NULL) {              // freed block, fill with dummy data
       page_count = 1;
     } else {
+      mf_fill(mfp, hp2);
       page_count = hp2->bh_page_count;
     }
     unsigned size = page_size * page_count;  // number of bytes written
@@ -681,6 +1432,7 @@ static int mf_trans_add(memfile_T *mfp, bhdr_T *hp)
   }
 
   blocknr_T old_bnum = hp->bh_bnum;            // adjust number
+  mf_comp_forget(mfp, hp);  // its entry in mf_comp_queue no longer matches
   pmap_del(int64_t)(&mfp->mf_hash, hp->bh_bnum, NULL);
   hp->bh_bnum = new_bnum;
   pmap_put(int64_t)(&mfp->mf_hash, new_bnum, hp);
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "klib/kvec.h"
 #include "nvim/map_defs.h"
 
 /// A block number.
@@ -32,15 +33,44 @@ typedef struct {
 
 #define BH_DIRTY    1U
 #define BH_LOCKED   2U
-  unsigned bh_flags;                 ///< BH_DIRTY or BH_LOCKED
+#define BH_LAZY     4U
+#define BH_COMPRESSED 8U
+  unsigned bh_flags;                 ///< BH_DIRTY, BH_LOCKED, BH_LAZY or BH_COMPRESSED
+
+  /// A block with BH_LAZY was not changed since it was created from the text
+  /// at bh_lazy_off in mf_lazy_fd. Its bh_data may be NULL, it is then
+  /// filled in when the block is used.
+  size_t bh_lazy_off;
+  unsigned bh_lazy_len;              ///< number of bytes of text for BH_LAZY
+  unsigned bh_lazy_lines;            ///< number of lines for BH_LAZY
+
+  /// A block with BH_COMPRESSED has bh_data NULL, its text is compressed in
+  /// bh_comp. It is uncompressed when the block is used.
+  char *bh_comp;
+  unsigned bh_comp_len;              ///< number of bytes in bh_comp
+  uint64_t bh_used;                  ///< when last put in mf_comp_queue, 0 if not
 } bhdr_T;
 
+/// An entry in mf_comp_queue.
+typedef struct {
+  blocknr_T mq_bnum;
+  uint64_t mq_used;                  ///< bh_used of the block when it was added
+} mfqueue_T;
+
 typedef enum {
   MF_DIRTY_NO = 0,      ///< no dirty blocks
   MF_DIRTY_YES,         ///< there are dirty blocks
   MF_DIRTY_YES_NOSYNC,  ///< there are dirty blocks, do not sync yet
 } mfdirty_T;
 
+/// A sync of a memory file done by a worker thread, see mf_sync_async().
+typedef struct mfsync mfsync_T;
+
+/// Memory of blocks that is also used by a snapshot of the text, see
+/// mf_share_start(). When the memfile is going to change or free such memory
+/// it only removes it from ms_data, the snapshot then frees it.
+typedef struct mfshare mfshare_T;
+
 /// A memory file.
 typedef struct {
   char *mf_fname;                    ///< name of the file
@@ -65,4 +95,26 @@ typedef struct {
   blocknr_T mf_infile_count;         ///< number of pages in the file
   unsigned mf_page_size;             ///< number of bytes in a page
   mfdirty_T mf_dirty;
+  mfsync_T *mf_sync_job;             ///< pending sync by a worker thread or NULL
+  mfshare_T *mf_share;               ///< memory shared with a snapshot or NULL
+
+  /// The file holding the text of blocks with BH_LAZY, -1 if there is none.
+  int mf_lazy_fd;
+  size_t mf_lazy_size;
+  bool mf_lazy_changed;              ///< the file was found to be changed
+  /// Numbers of BH_LAZY blocks that were filled in, oldest first.
+  kvec_t(blocknr_T) mf_lazy_loaded;
+
+  /// Blocks that may be compressed when 'memcompress' is set and there is no
+  /// swap file, least recently used first. An entry is outdated when its
+  /// mq_used does not match the bh_used of the block.
+  kvec_t(mfqueue_T) mf_comp_queue;
+  size_t mf_comp_head;               ///< first entry in mf_comp_queue to look at
+  size_t mf_comp_pages;              ///< number of pages in entries not outdated
+  uint64_t mf_comp_clock;            ///< last value used for bh_used
 } memfile_T;
+
+struct mfshare {
+  Set(ptr_t) ms_data;                ///< bh_data still used by the memfile
+  memfile_T *ms_mfp;                 ///< NULL when the memfile was closed
+};
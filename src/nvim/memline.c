@@ -53,6 +53,7 @@
 #include "nvim/autocmd_defs.h"
 #include "nvim/buffer.h"
 #include "nvim/buffer_defs.h"
+#include "nvim/bufwrite.h"
 #include "nvim/change.h"
 #include "nvim/cursor.h"
 #include "nvim/drawscreen.h"
@@ -224,6 +225,12 @@ typedef struct {
 
 #define STACK_INCR      5       // nr of entries added to ml_stack at a time
 
+// Appending fewer lines than this with ml_append_bulk() is done line by line.
+#define ML_BULK_MIN     100
+
+// Number of bytes of a file read at a time by ml_open_lazy().
+#define ML_LAZY_READ    (1024 * 1024)
+
 // The line number where the first mark may be is remembered.
 // If it is 0 there are no marks at all.
 // (always used for the current buffer only, no buffer change possible while
@@ -255,6 +262,15 @@ typedef enum {
   SEA_CHOICE_ABORT = 6,
 } sea_choice_T;
 
+/// Blocks of a file being loaded by ml_open_lazy().
+typedef struct {
+  mlbulk_T mb;
+  size_t blk_start;     ///< offset of the text of the block being collected
+  unsigned blk_used;    ///< bytes of room used by the lines of the block
+  linenr_T blk_lines;   ///< number of lines of the block
+  linenr_T lnum;        ///< number of lines so far
+} mllazy_T;
+
 #include "memline.c.generated.h"
 
 static const char e_ml_get_invalid_lnum_nr[]
@@ -275,6 +291,9 @@ static const char e_line_count_wrong_in_block_nr[]
   = N_("E323: Line count wrong in block %" PRId64);
 static const char e_warning_pointer_block_corrupted[]
   = N_("E1364: Warning: Pointer block corrupted");
+static const char e_lazy_file_changed[]
+  = N_("Warning: The file was changed on disk since it was loaded lazily, "
+       "lines that are no longer there are empty");
 
 #if __has_feature(address_sanitizer)
 # define ML_GET_ALLOC_LINES
@@ -294,6 +313,8 @@ int ml_open(buf_T *buf)
   buf->b_ml.ml_line_offset = 0;
   buf->b_ml.ml_chunksize = NULL;
   buf->b_ml.ml_usedchunks = 0;
+  buf->b_ml.ml_chunktree = NULL;
+  buf->b_ml.ml_chunktree_len = 0;
 
   if (cmdmod.cmod_flags & CMOD_NOSWAPFILE) {
     buf->b_p_swf = false;
@@ -435,6 +456,7 @@ void ml_setname(buf_T *buf)
     }
     // need to close the swapfile before renaming
     if (mfp->mf_fd >= 0) {
+      mf_sync_wait(mfp);
       close(mfp->mf_fd);
       mfp->mf_fd = -1;
     }
@@ -566,6 +588,8 @@ void check_need_swap(bool newfile)
 /// @param del_file  if true, delete the swapfile
 void ml_close(buf_T *buf, int del_file)
 {
+  // The file must be complete before it may be read again.
+  buf_write_wait(buf, true);
   if (buf->b_ml.ml_mfp == NULL) {               // not open
     return;
   }
@@ -576,6 +600,8 @@ void ml_close(buf_T *buf, int del_file)
   }
   xfree(buf->b_ml.ml_stack);
   XFREE_CLEAR(buf->b_ml.ml_chunksize);
+  XFREE_CLEAR(buf->b_ml.ml_chunktree);
+  buf->b_ml.ml_chunktree_len = 0;
   buf->b_ml.ml_mfp = NULL;
 
   // Reset the "recovered" flag, give the ATTENTION prompt the next time
@@ -1686,9 +1712,8 @@ static int recov_file_names(char **names, char *path, bool prepend_dot)
 /// sync all memlines
 ///
 /// @param check_file  if true, check if original file exists and was not changed.
-/// @param check_char  if true, stop syncing when character becomes available, but
-///
-/// always sync at least one block.
+/// @param check_char  if true, write in a worker thread, see mf_sync_async(), and
+///                    stop when a character becomes available.
 void ml_sync_all(int check_file, int check_char, bool do_fsync)
 {
   FOR_ALL_BUFFERS(buf) {
@@ -1713,8 +1738,12 @@ void ml_sync_all(int check_file, int check_char, bool do_fsync)
       }
     }
     if (buf->b_ml.ml_mfp->mf_dirty == MF_DIRTY_YES) {
-      mf_sync(buf->b_ml.ml_mfp, (check_char ? MFS_STOP : 0)
-              | (do_fsync && bufIsChanged(buf) ? MFS_FLUSH : 0));
+      if (check_char) {
+        // Waiting for the disk must not delay typed characters.
+        mf_sync_async(buf->b_ml.ml_mfp, do_fsync && bufIsChanged(buf));
+      } else {
+        mf_sync(buf->b_ml.ml_mfp, do_fsync && bufIsChanged(buf) ? MFS_FLUSH : 0);
+      }
       if (check_char && os_char_avail()) {      // character available now
         break;
       }
@@ -1857,6 +1886,133 @@ colnr_T ml_get_buf_len(buf_T *buf, linenr_T lnum)
   return buf->b_ml.ml_line_len - 1;
 }
 
+/// Get the text of up to "max" lines from "lnum" on that are in the same data
+/// block, without copying it. The text is valid until the next call of a
+/// memline function for "buf". Each line is followed by a NUL.
+///
+/// @param[out] lines  pointers to the text of the lines.
+/// @param[out] lens   lengths of the lines, without the NUL.
+///
+/// @return  The number of lines, zero when the block can't be found.
+int ml_get_block_lines(buf_T *buf, linenr_T lnum, int max, char **lines, colnr_T *lens)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (buf->b_ml.ml_mfp == NULL || lnum < 1 || lnum > buf->b_ml.ml_line_count) {
+    return 0;
+  }
+  // A changed line must be in the block.
+  ml_flush_line(buf, false);
+  bhdr_T *hp = ml_find_line(buf, lnum, ML_FIND);
+  if (hp == NULL) {
+    return 0;
+  }
+
+  int count = MIN(max, buf->b_ml.ml_locked_high - lnum + 1);
+  ml_block_lines(hp->bh_data, lnum - buf->b_ml.ml_locked_low, count, lines, lens);
+  return count;
+}
+
+/// Store pointers to "count" lines of data block "dp", starting at index
+/// "idx", in "lines" and their lengths in "lens".
+static void ml_block_lines(DataBlock *dp, int idx, int count, char **lines, colnr_T *lens)
+{
+  for (int i = 0; i < count; i++, idx++) {
+    unsigned start = (dp->db_index[idx] & DB_INDEX_MASK);
+    unsigned end = idx == 0 ? dp->db_txt_end : (dp->db_index[idx - 1] & DB_INDEX_MASK);
+    lines[i] = (char *)dp + start;
+    lens[i] = (colnr_T)(end - start - 1);
+  }
+}
+
+/// Take a snapshot of the text of "buf". This does not copy the text: the data
+/// blocks are shared, a block is only copied when the buffer is going to use
+/// it again. Free the snapshot with ml_snapshot_free().
+///
+/// @return  NULL when the buffer is empty or a snapshot of it is in use.
+mlsnap_T *ml_snapshot(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+  if (mfp == NULL || (buf->b_ml.ml_flags & ML_EMPTY)) {
+    return NULL;
+  }
+  mfshare_T *share = mf_share_start(mfp);
+  if (share == NULL) {
+    return NULL;
+  }
+  mlsnap_T *snap = xcalloc(1, sizeof(mlsnap_T));
+  snap->ms_share = share;
+  snap->ms_line_count = buf->b_ml.ml_line_count;
+
+  // A changed line must be in its block.
+  ml_flush_line(buf, false);
+  for (linenr_T lnum = 1; lnum <= buf->b_ml.ml_line_count;) {
+    bhdr_T *hp = ml_find_line(buf, lnum, ML_FIND);
+    if (hp == NULL) {
+      ml_find_line(buf, 0, ML_FLUSH);
+      ml_snapshot_free(snap);
+      return NULL;
+    }
+    DataBlock *dp = hp->bh_data;
+    mf_share_block(share, hp);
+    kv_push(snap->ms_blocks, dp);
+    snap->ms_size += dp->db_txt_end - dp->db_txt_start;
+    lnum = buf->b_ml.ml_locked_high + 1;
+  }
+  // Release the last block, before it is changed it must be obtained with
+  // mf_get() again.
+  ml_find_line(buf, 0, ML_FLUSH);
+  return snap;
+}
+
+/// Get pointers to at most "max" lines of data block "blk" of snapshot "snap",
+/// starting at index "idx". Can be used by any thread.
+///
+/// @return  the number of lines, zero when "idx" is past the end of the block.
+int ml_snapshot_lines(const mlsnap_T *snap, size_t blk, int idx, int max, char **lines,
+                      colnr_T *lens)
+  FUNC_ATTR_NONNULL_ALL
+{
+  DataBlock *dp = kv_A(snap->ms_blocks, blk);
+  int count = MIN(max, (int)dp->db_line_count - idx);
+  if (count <= 0) {
+    return 0;
+  }
+  ml_block_lines(dp, idx, count, lines, lens);
+  return count;
+}
+
+/// Find line "lnum" of snapshot "snap": store the data block in "blk" and the
+/// index in that block in "idx", for ml_snapshot_lines().
+void ml_snapshot_find(const mlsnap_T *snap, linenr_T lnum, size_t *blk, int *idx)
+  FUNC_ATTR_NONNULL_ALL
+{
+  linenr_T first = 1;
+  size_t i = 0;
+  while (i + 1 < kv_size(snap->ms_blocks)) {
+    linenr_T count = (linenr_T)((DataBlock *)kv_A(snap->ms_blocks, i))->db_line_count;
+    if (lnum < first + count) {
+      break;
+    }
+    first += count;
+    i++;
+  }
+  *blk = i;
+  *idx = lnum - first;
+}
+
+/// Free snapshot "snap", giving the blocks it still shares back to the memfile.
+void ml_snapshot_free(mlsnap_T *snap)
+  FUNC_ATTR_NONNULL_ALL
+{
+  for (size_t i = 0; i < kv_size(snap->ms_blocks); i++) {
+    mf_share_drop(snap->ms_share, kv_A(snap->ms_blocks, i));
+  }
+  kv_destroy(snap->ms_blocks);
+  mf_share_end(snap->ms_share);
+  xfree(snap);
+}
+
 /// @return  codepoint at pos. pos must be either valid or have col set to MAXCOL!
 int gchar_pos(pos_T *pos)
   FUNC_ATTR_NONNULL_ARG(1)
@@ -1905,6 +2061,10 @@ errorret:
   // blocks.
   if (buf->b_ml.ml_line_lnum != lnum) {
     ml_flush_line(buf, false);
+    // No pointer into a block is in use now, unused lazy blocks can go and
+    // blocks not used for a while can be compressed.
+    mf_lazy_trim(buf->b_ml.ml_mfp);
+    mf_comp_trim(buf->b_ml.ml_mfp);
 
     // Find the data block containing the line.
     // This also fills the stack with the blocks from the root to the data
@@ -2464,6 +2624,110 @@ int ml_append_buf(buf_T *buf, linenr_T lnum, char *line, colnr_T len, bool newfi
   return ml_append_flush(buf, lnum, line, len, newfile ? ML_APPEND_NEW : 0);
 }
 
+/// Start appending lines after line "lnum" of "buf" with ml_append_bulk().
+/// The buffer must already have a memline.
+///
+/// @param flags  ML_APPEND_ values
+void ml_append_bulk_start(mlbulk_T *mb, buf_T *buf, linenr_T lnum, int flags)
+  FUNC_ATTR_NONNULL_ALL
+{
+  CLEAR_POINTER(mb);
+  mb->mb_buf = buf;
+  mb->mb_lnum = lnum;
+  mb->mb_flags = flags;
+}
+
+/// Append a line after the lines added with ml_append_bulk() since
+/// ml_append_bulk_start(). Like ml_append_flags(), but when there are many
+/// lines they are packed into full data blocks, which are only added to the
+/// buffer by ml_append_bulk_end(). Until then the buffer must not be changed.
+///
+/// @param line  text of the new line
+/// @param len  length of new line, including NUL, or 0
+///
+/// @return  FAIL for failure, OK otherwise
+int ml_append_bulk(mlbulk_T *mb, char *line, colnr_T len)
+  FUNC_ATTR_NONNULL_ALL
+{
+  buf_T *buf = mb->mb_buf;
+  if (mb->mb_direct < ML_BULK_MIN) {
+    if (buf->b_ml.ml_mfp == NULL
+        || ml_append_flush(buf, mb->mb_lnum + mb->mb_direct, line, len, mb->mb_flags) == FAIL) {
+      return FAIL;
+    }
+    mb->mb_direct++;
+    return OK;
+  }
+
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+  if (len == 0) {
+    len = (colnr_T)strlen(line) + 1;
+  }
+  unsigned space_needed = (unsigned)len + (unsigned)INDEX_SIZE;
+  if (mb->mb_data != NULL
+      && ((DataBlock *)mb->mb_data->bh_data)->db_free < space_needed) {
+    ml_bulk_add_data(buf, mb);
+  }
+  if (mb->mb_data == NULL) {
+    unsigned page_count = (space_needed + (unsigned)HEADER_SIZE + mfp->mf_page_size - 1)
+                          / mfp->mf_page_size;
+    mb->mb_data = ml_new_data(mfp, mb->mb_flags & ML_APPEND_NEW, (int)page_count);
+    mb->mb_data_first = mb->mb_lnum + mb->mb_direct + mb->mb_count + 1;
+  }
+
+  DataBlock *dp = mb->mb_data->bh_data;
+  dp->db_txt_start -= (unsigned)len;
+  dp->db_free -= space_needed;
+  dp->db_index[dp->db_line_count] = dp->db_txt_start;
+  if (mb->mb_flags & ML_APPEND_MARK) {
+    dp->db_index[dp->db_line_count] |= DB_MARKED;
+  }
+  dp->db_line_count++;
+  memmove((char *)dp + dp->db_txt_start, line, (size_t)len);
+  mb->mb_count++;
+  return OK;
+}
+
+/// Add the lines collected with ml_append_bulk() to the buffer. The tree of
+/// blocks built for them is inserted at once, instead of walking the tree
+/// for every line. Does nothing when "mb" was not started.
+///
+/// @return  FAIL for failure, OK otherwise
+int ml_append_bulk_end(mlbulk_T *mb)
+  FUNC_ATTR_NONNULL_ALL
+{
+  buf_T *buf = mb->mb_buf;
+  if (buf == NULL || mb->mb_count == 0) {
+    mb->mb_buf = NULL;
+    return OK;
+  }
+  mb->mb_buf = NULL;
+
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+  if (mb->mb_data != NULL) {
+    ml_bulk_add_data(buf, mb);
+  }
+  bhdr_T *top_hp = ml_bulk_top(buf, mb);
+  const linenr_T lnum = mb->mb_lnum + mb->mb_direct;
+  int ret = ml_bulk_splice(buf, lnum, top_hp->bh_data, mb->mb_count, mb->mb_flags);
+  mf_free(mfp, top_hp);
+  if (ret == FAIL) {
+    return FAIL;
+  }
+
+  if (lowest_marked && lowest_marked > lnum) {
+    lowest_marked = lnum + 1;
+  }
+  if (buf->b_prev_line_count == 0) {
+    buf->b_prev_line_count = buf->b_ml.ml_line_count;
+  }
+  buf->b_ml.ml_line_count += mb->mb_count;
+  buf->b_ml.ml_flags &= ~ML_EMPTY;
+
+  ml_bulk_updatechunks(buf, lnum + 1, lnum + mb->mb_count);
+  return OK;
+}
+
 void ml_add_deleted_len(char *ptr, ssize_t len)
 {
   ml_add_deleted_len_buf(curbuf, ptr, len);
@@ -2959,6 +3223,485 @@ static bhdr_T *ml_new_ptr(memfile_T *mfp)
   return hp;
 }
 
+/// Fill in lazy data block "hp", created by ml_open_lazy(), from the text in
+/// the lazy file. Called by the memfile when the block is used.
+///
+/// The file is read again, it may have been changed or truncated meanwhile.
+/// Then the block must still get the same number of lines: they are left
+/// empty and a warning is given once.
+void ml_lazy_fill(memfile_T *mfp, bhdr_T *hp)
+  FUNC_ATTR_NONNULL_ALL
+{
+  DataBlock *dp = hp->bh_data;
+  const unsigned len = hp->bh_lazy_len;
+  const unsigned lines = hp->bh_lazy_lines;
+  dp->db_id = DATA_ID;
+  dp->db_txt_end = hp->bh_page_count * mfp->mf_page_size;
+
+  char *text = xmalloc(len);
+  bool same = os_pread(mfp->mf_lazy_fd, text, len, hp->bh_lazy_off) == (ptrdiff_t)len;
+  if (same) {
+    // Only the last line of the file may have no line break. The lines must
+    // also still fit in the block.
+    size_t nl_count = memcnt(text, NL, len);
+    same = (nl_count == lines || (nl_count == lines - 1 && text[len - 1] != NL))
+           && HEADER_SIZE + len - nl_count + (size_t)lines * (1 + INDEX_SIZE) <= dp->db_txt_end;
+  }
+  if (!same && !mfp->mf_lazy_changed) {
+    mfp->mf_lazy_changed = true;
+    emsg(_(e_lazy_file_changed));
+  }
+
+  unsigned start = dp->db_txt_end;
+  const char *p = text;
+  for (unsigned count = 0; count < lines; count++) {
+    unsigned line_len = 0;
+    if (same) {
+      const char *nl = memchr(p, NL, (size_t)(text + len - p));
+      line_len = (unsigned)((nl == NULL ? text + len : nl) - p);
+    }
+    start -= line_len + 1;
+    dp->db_index[count] = start;
+    char *line = (char *)dp + start;
+    if (same) {
+      memcpy(line, p, line_len);
+      memchrsub(line, NUL, NL, line_len);  // NULs are replaced by newlines!
+      p += line_len + 1;
+    }
+    line[line_len] = NUL;
+  }
+  xfree(text);
+  dp->db_txt_start = start;
+  dp->db_line_count = lines;
+  dp->db_free = start - (unsigned)(HEADER_SIZE + (size_t)lines * INDEX_SIZE);
+  // Avoid writing uninitialized memory to the swap file.
+  memset((char *)dp + start - dp->db_free, 0, dp->db_free);
+}
+
+/// Fill the empty buffer "buf" with the lines of the first "size" bytes of
+/// file "fd", without keeping the text. Only the pointer blocks are created,
+/// the data blocks are filled in by ml_lazy_fill() when they are used. The
+/// memfile takes over "fd". When no line could be read the buffer is left
+/// empty.
+///
+/// The caller must have checked that there are less than MAXLNUM lines and
+/// that no line is MAXCOL bytes or longer. When the file turns out to be
+/// changed meanwhile, it is loaded as far as it can be.
+///
+/// @return  The number of lines.
+linenr_T ml_open_lazy(buf_T *buf, int fd, size_t size)
+  FUNC_ATTR_NONNULL_ALL
+{
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+  mf_set_lazy_fd(mfp, fd, size);
+
+  mllazy_T ml = { 0 };
+  ml_bulk_start(buf, &ml.mb);
+
+  char *chunk = xmalloc(MIN(size, ML_LAZY_READ));
+  size_t line_start = 0;  // offset of the line being found
+  size_t off = 0;         // offset of "chunk"
+  bool changed = false;
+  while (off < size && !changed) {
+    ptrdiff_t n = os_pread(fd, chunk, MIN(size - off, ML_LAZY_READ), off);
+    if (n <= 0) {
+      break;  // truncated meanwhile
+    }
+    const char *p = chunk;
+    const char *const end = chunk + n;
+    const char *nl;
+    while ((nl = memchr(p, NL, (size_t)(end - p))) != NULL) {
+      size_t line_end = off + (size_t)(nl - chunk);
+      if (line_end - line_start >= MAXCOL || ml.lnum >= MAXLNUM - 1) {
+        changed = true;
+        break;
+      }
+      ml_lazy_add_line(buf, &ml, line_start, (unsigned)(line_end - line_start), line_end + 1);
+      line_start = line_end + 1;
+      p = nl + 1;
+    }
+    off += (size_t)n;
+  }
+  xfree(chunk);
+  // The last line may have no line break.
+  if (!changed && line_start < off && off - line_start < MAXCOL && ml.lnum < MAXLNUM - 1) {
+    ml_lazy_add_line(buf, &ml, line_start, (unsigned)(off - line_start), off);
+    line_start = off;
+  }
+  if (ml.blk_lines > 0) {
+    ml_bulk_add_lazy(buf, &ml.mb, ml.blk_start, line_start - ml.blk_start, 1,
+                     ml.lnum - ml.blk_lines + 1, ml.blk_lines);
+  }
+
+  ml_bulk_finish(buf, &ml.mb);
+  if (ml.lnum == 0) {
+    mf_lazy_load_all(mfp);  // closes "fd"
+  }
+  return ml.lnum;
+}
+
+/// Add line "lnum + 1" of "len" bytes at "start" in the lazy file to the
+/// blocks of "ml", the next line starts at "next".
+static void ml_lazy_add_line(buf_T *buf, mllazy_T *ml, size_t start, unsigned len, size_t next)
+{
+  const unsigned page_size = buf->b_ml.ml_mfp->mf_page_size;
+  const unsigned room = page_size - (unsigned)HEADER_SIZE;  // room in one page
+  unsigned need = len + 1 + (unsigned)INDEX_SIZE;
+
+  if (ml->blk_lines > 0 && ml->blk_used + need > room) {
+    ml_bulk_add_lazy(buf, &ml->mb, ml->blk_start, start - ml->blk_start, 1,
+                     ml->lnum - ml->blk_lines + 1, ml->blk_lines);
+    ml->blk_start = start;
+    ml->blk_used = 0;
+    ml->blk_lines = 0;
+  }
+  ml->blk_used += need;
+  ml->blk_lines++;
+  if (ml->lnum++ == 0) {
+    ml_chunks_start(buf);
+  }
+  ml_chunks_add_line(buf, (int)len + 1);
+
+  if (ml->blk_used > room) {
+    // A long line gets a block of its own with as many pages as needed.
+    ml_bulk_add_lazy(buf, &ml->mb, ml->blk_start, next - ml->blk_start,
+                     (ml->blk_used + (unsigned)HEADER_SIZE + page_size - 1) / page_size,
+                     ml->lnum, 1);
+    ml->blk_start = next;
+    ml->blk_used = 0;
+    ml->blk_lines = 0;
+  }
+}
+
+/// Add a lazy data block for the "len" bytes of text at "off" in the lazy
+/// file, holding lines "first" to "first + lines - 1".
+static void ml_bulk_add_lazy(buf_T *buf, mlbulk_T *mb, size_t off, size_t len,
+                             unsigned page_count, linenr_T first, linenr_T lines)
+{
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+  PointerEntry pe = {
+    .pe_bnum = mf_new_lazy(mfp, page_count, off, (unsigned)len, (unsigned)lines),
+    .pe_line_count = lines,
+    .pe_old_lnum = first,
+    .pe_page_count = (int)page_count,
+  };
+  ml_bulk_add(buf, mb, 0, pe);
+}
+
+/// Start building the tree of blocks of the empty buffer "buf" bottom-up.
+/// Data blocks are added in order with ml_bulk_add(), ml_bulk_finish() then
+/// makes the tree the contents of the buffer.
+static void ml_bulk_start(buf_T *buf, mlbulk_T *mb)
+{
+  assert(buf->b_ml.ml_flags & ML_EMPTY);
+  ml_flush_line(buf, false);
+  ml_find_line(buf, 0, ML_FLUSH);  // release ml_locked
+  CLEAR_POINTER(mb);
+}
+
+/// Add the block "pe" at "level" of the tree, level 0 being the data blocks.
+/// Creates a new pointer block when the current one for "level" is full.
+static void ml_bulk_add(buf_T *buf, mlbulk_T *mb, int level, PointerEntry pe)
+{
+  assert(level < ML_BULK_MAXDEPTH);
+  if (mb->mb_ptr[level] != NULL) {
+    PointerBlock *pp = mb->mb_ptr[level]->bh_data;
+    if (pp->pb_count == pp->pb_count_max) {
+      ml_bulk_close(buf, mb, level);
+    }
+  }
+  if (mb->mb_ptr[level] == NULL) {
+    mb->mb_ptr[level] = ml_new_ptr(buf->b_ml.ml_mfp);
+    mb->mb_lines[level] = 0;
+    mb->mb_first[level] = pe.pe_old_lnum;
+    mb->mb_depth = MAX(mb->mb_depth, level + 1);
+  }
+  PointerBlock *pp = mb->mb_ptr[level]->bh_data;
+  pp->pb_pointer[pp->pb_count++] = pe;
+  mb->mb_lines[level] += pe.pe_line_count;
+}
+
+/// Finish the pointer block at "level" and add it to the level above.
+static void ml_bulk_close(buf_T *buf, mlbulk_T *mb, int level)
+{
+  bhdr_T *hp = mb->mb_ptr[level];
+  PointerEntry pe = {
+    .pe_bnum = hp->bh_bnum,
+    .pe_line_count = mb->mb_lines[level],
+    .pe_old_lnum = mb->mb_first[level],
+    .pe_page_count = 1,
+  };
+  mf_put(buf->b_ml.ml_mfp, hp, true, false);
+  mb->mb_ptr[level] = NULL;
+  ml_bulk_add(buf, mb, level + 1, pe);
+}
+
+/// Finish the data block being filled by ml_append_bulk() and add it to the
+/// tree being built.
+static void ml_bulk_add_data(buf_T *buf, mlbulk_T *mb)
+{
+  bhdr_T *hp = mb->mb_data;
+  PointerEntry pe = {
+    .pe_bnum = hp->bh_bnum,
+    .pe_line_count = (linenr_T)((DataBlock *)hp->bh_data)->db_line_count,
+    .pe_old_lnum = mb->mb_data_first,
+    .pe_page_count = (int)hp->bh_page_count,
+  };
+  mf_put(buf->b_ml.ml_mfp, hp, true, false);
+  mb->mb_data = NULL;
+  ml_bulk_add(buf, mb, 0, pe);
+}
+
+/// Finish all levels of the tree being built but the top one.
+///
+/// @return  the top pointer block, still locked.
+static bhdr_T *ml_bulk_top(buf_T *buf, mlbulk_T *mb)
+{
+  // This may add a level.
+  for (int level = 0; level < mb->mb_depth - 1; level++) {
+    if (mb->mb_ptr[level] != NULL) {
+      ml_bulk_close(buf, mb, level);
+    }
+  }
+  return mb->mb_ptr[mb->mb_depth - 1];
+}
+
+/// Insert the "count" lines below pointer block "top" after line "lnum".
+/// The data block with "lnum" is split and the entries of "top" are put in
+/// between the two halves, in the pointer block above it. Does not update
+/// ml_line_count.
+///
+/// @return  FAIL for failure, OK otherwise
+static int ml_bulk_splice(buf_T *buf, linenr_T lnum, PointerBlock *top, linenr_T count, int flags)
+{
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+
+  ml_flush_line(buf, false);
+  bhdr_T *hp = ml_find_line(buf, lnum == 0 ? 1 : lnum, ML_FIND);
+  if (hp == NULL) {
+    return FAIL;
+  }
+  DataBlock *dp = hp->bh_data;
+  int line_count = buf->b_ml.ml_locked_high - buf->b_ml.ml_locked_low + 1;
+  int db_idx = lnum == 0 ? -1 : lnum - buf->b_ml.ml_locked_low;
+
+  infoptr_T *ip = &buf->b_ml.ml_stack[buf->b_ml.ml_stack_top - 1];
+  bhdr_T *hp_parent = mf_get(mfp, ip->ip_bnum, 1);
+  if (hp_parent == NULL) {
+    return FAIL;
+  }
+  PointerEntry pe_old = ((PointerBlock *)hp_parent->bh_data)->pb_pointer[ip->ip_index];
+  mf_put(mfp, hp_parent, false, false);
+
+  PointerEntry *pe = xmalloc(((size_t)top->pb_count + 2) * sizeof(PointerEntry));
+  int pe_count = 0;
+  if (db_idx >= 0) {
+    pe[pe_count] = pe_old;
+    pe[pe_count++].pe_line_count = db_idx + 1;
+  }
+  memmove(pe + pe_count, top->pb_pointer, (size_t)top->pb_count * sizeof(PointerEntry));
+  pe_count += top->pb_count;
+  if (db_idx < 0) {
+    pe[pe_count++] = pe_old;
+  } else if (db_idx < line_count - 1) {
+    // Move the lines after "lnum" to a new data block.
+    int lines_moved = line_count - db_idx - 1;
+    unsigned data_moved = (dp->db_index[db_idx] & DB_INDEX_MASK) - dp->db_txt_start;
+    unsigned total_moved = data_moved + (unsigned)lines_moved * (unsigned)INDEX_SIZE;
+    unsigned page_count = (total_moved + (unsigned)HEADER_SIZE + mfp->mf_page_size - 1)
+                          / mfp->mf_page_size;
+    bhdr_T *hp_right = ml_new_data(mfp, flags & ML_APPEND_NEW, (int)page_count);
+    DataBlock *dp_right = hp_right->bh_data;
+    dp_right->db_txt_start -= data_moved;
+    dp_right->db_free -= total_moved;
+    memmove((char *)dp_right + dp_right->db_txt_start,
+            (char *)dp + dp->db_txt_start, (size_t)data_moved);
+    int offset = (int)(dp_right->db_txt_start - dp->db_txt_start);
+    for (int to = 0, from = db_idx + 1; from < line_count; from++, to++) {
+      dp_right->db_index[to] = dp->db_index[from] + (unsigned)offset;
+    }
+    dp_right->db_line_count = lines_moved;
+    dp->db_txt_start += data_moved;
+    dp->db_free += total_moved;
+    dp->db_line_count = db_idx + 1;
+
+    buf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
+    if (!(flags & ML_APPEND_NEW)) {
+      buf->b_ml.ml_flags |= ML_LOCKED_POS;
+    }
+    pe[pe_count++] = (PointerEntry){
+      .pe_bnum = hp_right->bh_bnum,
+      .pe_line_count = lines_moved,
+      .pe_old_lnum = lnum + count + 1,
+      .pe_page_count = (int)page_count,
+    };
+    mf_put(mfp, hp_right, true, false);
+  }
+  ml_find_line(buf, 0, ML_FLUSH);  // release the data block
+
+  int ret = ml_bulk_insert(buf, buf->b_ml.ml_stack_top - 1, pe, pe_count, count);
+  xfree(pe);
+  buf->b_ml.ml_stack_top = 0;  // the stack is invalid now
+  return ret;
+}
+
+/// Replace the entry at "ml_stack[stack_idx]" with the "pe_count" entries
+/// in "pe", which have "lineadd" lines more. When the pointer block gets too
+/// full it is split and the entry for it in the block above is replaced in
+/// the same way. The root, block 1, is given an extra level instead.
+///
+/// @return  FAIL for failure, OK otherwise
+static int ml_bulk_insert(buf_T *buf, int stack_idx, PointerEntry *pe, int pe_count,
+                          linenr_T lineadd)
+{
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+  infoptr_T *ip = &buf->b_ml.ml_stack[stack_idx];
+  bhdr_T *hp = mf_get(mfp, ip->ip_bnum, 1);
+  if (hp == NULL) {
+    return FAIL;
+  }
+  PointerBlock *pp = hp->bh_data;
+  if (pp->pb_id != PTR_ID) {
+    iemsg(_(e_pointer_block_id_wrong_three));
+    mf_put(mfp, hp, false, false);
+    return FAIL;
+  }
+  const int idx = ip->ip_index;
+  const int tail = pp->pb_count - idx - 1;
+  const int total = pp->pb_count - 1 + pe_count;
+
+  if (total <= pp->pb_count_max) {
+    memmove(&pp->pb_pointer[idx + pe_count], &pp->pb_pointer[idx + 1],
+            (size_t)tail * sizeof(PointerEntry));
+    memmove(&pp->pb_pointer[idx], pe, (size_t)pe_count * sizeof(PointerEntry));
+    pp->pb_count = (uint16_t)total;
+    mf_put(mfp, hp, true, false);
+    // The blocks above only need their line count adjusted.
+    buf->b_ml.ml_stack_top = stack_idx;
+    ml_lineadd(buf, lineadd);
+    return OK;
+  }
+
+  // Spread the entries over new pointer blocks. At most pb_count_max + 2
+  // entries are inserted at the bottom and one more than that is at most
+  // three blocks, thus at most three entries are inserted above.
+  PointerEntry *all = xmalloc((size_t)total * sizeof(PointerEntry));
+  memmove(all, pp->pb_pointer, (size_t)idx * sizeof(PointerEntry));
+  memmove(all + idx, pe, (size_t)pe_count * sizeof(PointerEntry));
+  memmove(all + idx + pe_count, &pp->pb_pointer[idx + 1], (size_t)tail * sizeof(PointerEntry));
+
+  const bool is_root = hp->bh_bnum == 1;
+  const int nblocks = (total + pp->pb_count_max - 1) / pp->pb_count_max;
+  const int per_block = (total + nblocks - 1) / nblocks;
+  PointerEntry up[3];
+  assert(nblocks <= 3);
+  for (int b = 0, i = 0; b < nblocks; b++) {
+    bhdr_T *hp_new = b == 0 && !is_root ? hp : ml_new_ptr(mfp);
+    PointerBlock *pp_new = hp_new->bh_data;
+    int n = MIN(per_block, total - i);
+    memmove(pp_new->pb_pointer, all + i, (size_t)n * sizeof(PointerEntry));
+    pp_new->pb_count = (uint16_t)n;
+    up[b] = (PointerEntry){
+      .pe_bnum = hp_new->bh_bnum,
+      .pe_line_count = 0,
+      .pe_old_lnum = all[i].pe_old_lnum,
+      .pe_page_count = 1,
+    };
+    for (int j = 0; j < n; j++) {
+      up[b].pe_line_count += all[i + j].pe_line_count;
+    }
+    i += n;
+    if (hp_new != hp) {
+      mf_put(mfp, hp_new, true, false);
+    }
+  }
+  xfree(all);
+
+  if (is_root) {
+    memmove(pp->pb_pointer, up, (size_t)nblocks * sizeof(PointerEntry));
+    pp->pb_count = (uint16_t)nblocks;
+    mf_put(mfp, hp, true, false);
+    return OK;
+  }
+  mf_put(mfp, hp, true, false);
+  return ml_bulk_insert(buf, stack_idx - 1, up, nblocks, lineadd);
+}
+
+/// Update the chunks for lines "first" to "last", which were inserted with
+/// ml_bulk_splice().
+static void ml_bulk_updatechunks(buf_T *buf, linenr_T first, linenr_T last)
+{
+  kvec_t(int) lens = KV_INITIAL_VALUE;
+
+  for (linenr_T lnum = first; lnum <= last && buf->b_ml.ml_usedchunks != -1;) {
+    bhdr_T *hp = ml_find_line(buf, lnum, ML_FIND);
+    if (hp == NULL) {
+      break;
+    }
+    // Get the lengths first, ml_updatechunk() may lock another block.
+    DataBlock *dp = hp->bh_data;
+    int idx = lnum - buf->b_ml.ml_locked_low;
+    int end_idx = MIN(buf->b_ml.ml_locked_high, last) - buf->b_ml.ml_locked_low;
+    kv_size(lens) = 0;
+    for (int i = idx; i <= end_idx; i++) {
+      unsigned start = dp->db_index[i] & DB_INDEX_MASK;
+      unsigned end = i == 0 ? dp->db_txt_end : dp->db_index[i - 1] & DB_INDEX_MASK;
+      kv_push(lens, (int)(end - start));
+    }
+    for (size_t i = 0; i < kv_size(lens); i++) {
+      ml_updatechunk(buf, lnum++, kv_A(lens, i), ML_CHNK_ADDLINE);
+    }
+  }
+  kv_destroy(lens);
+}
+
+/// Make the tree built with ml_bulk_add() the contents of the buffer: the
+/// top pointer block is copied into the root block, the empty line the
+/// buffer had is freed.
+static void ml_bulk_finish(buf_T *buf, mlbulk_T *mb)
+{
+  if (mb->mb_depth == 0) {
+    return;
+  }
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+  bhdr_T *top_hp = ml_bulk_top(buf, mb);
+  PointerBlock *top = top_hp->bh_data;
+
+  bhdr_T *hp = mf_get(mfp, 1, 1);
+  PointerBlock *root = hp->bh_data;
+  for (int i = 0; i < root->pb_count; i++) {
+    ml_free_tree(mfp, root->pb_pointer[i].pe_bnum, root->pb_pointer[i].pe_page_count);
+  }
+  root->pb_count = top->pb_count;
+  memmove(root->pb_pointer, top->pb_pointer, (size_t)top->pb_count * sizeof(PointerEntry));
+  mf_put(mfp, hp, true, false);
+  mf_free(mfp, top_hp);
+
+  if (buf->b_prev_line_count == 0) {
+    buf->b_prev_line_count = buf->b_ml.ml_line_count;
+  }
+  buf->b_ml.ml_line_count = mb->mb_lines[mb->mb_depth - 1];
+  buf->b_ml.ml_flags &= ~ML_EMPTY;
+  buf->b_ml.ml_stack_top = 0;  // the stack is invalid now
+}
+
+/// Free block "bnum" and, if it is a pointer block, all blocks below it.
+static void ml_free_tree(memfile_T *mfp, blocknr_T bnum, int page_count)
+{
+  bnum = mf_trans_del(mfp, bnum);
+  bhdr_T *hp = mf_get(mfp, bnum, (unsigned)page_count);
+  if (hp == NULL) {
+    return;
+  }
+  PointerBlock *pp = hp->bh_data;
+  if (pp->pb_id == PTR_ID) {
+    for (int i = 0; i < pp->pb_count; i++) {
+      ml_free_tree(mfp, pp->pb_pointer[i].pe_bnum, pp->pb_pointer[i].pe_page_count);
+    }
+  }
+  mf_free(mfp, hp);
+}
+
 /// Lookup line 'lnum' in a memline.
 ///
 /// @param action: if ML_DELETE or ML_INSERT the line count is updated while searching
@@ -3800,6 +4543,9 @@ enum {
   MLCS_MINL = 400,  // should be half of MLCS_MAXL
 };
 
+// Buffer for which ml_updatechunk() remembers the chunk of the last line.
+static buf_T *ml_upd_lastbuf = NULL;
+
 /// Keep information for finding byte offset of a line
 ///
 /// @param updtype  may be one of:
@@ -3809,7 +4555,6 @@ enum {
 ///                 ML_CHNK_UPDLINE: Add len to parent chunk, as a signed entity.
 static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
 {
-  static buf_T *ml_upd_lastbuf = NULL;
   static linenr_T ml_upd_lastline;
   static linenr_T ml_upd_lastcurline;
   static int ml_upd_lastcurix;
@@ -3827,6 +4572,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
     buf->b_ml.ml_usedchunks = 1;
     buf->b_ml.ml_chunksize[0].mlcs_numlines = 1;
     buf->b_ml.ml_chunksize[0].mlcs_totalsize = 1;
+    ml_chunktree_invalidate(buf);
   }
 
   if (updtype == ML_CHNK_UPDLINE && buf->b_ml.ml_line_count == 1) {
@@ -3834,6 +4580,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
     buf->b_ml.ml_usedchunks = 1;
     buf->b_ml.ml_chunksize[0].mlcs_numlines = 1;
     buf->b_ml.ml_chunksize[0].mlcs_totalsize = buf->b_ml.ml_line_len;
+    ml_chunktree_invalidate(buf);
     return;
   }
 
@@ -3841,13 +4588,8 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
   // chunk.
   if (buf != ml_upd_lastbuf || line != ml_upd_lastline + 1
       || updtype != ML_CHNK_ADDLINE) {
-    for (curline = 1, curix = 0;
-         curix < buf->b_ml.ml_usedchunks - 1
-         && line >= curline +
-         buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-         curix++) {
-      curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    }
+    int size;
+    curix = ml_chunk_find(buf, line, 0, 0, &curline, &size);
   } else if (curix < buf->b_ml.ml_usedchunks - 1
              && line >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines) {
     // Adjust cached curix & curline
@@ -3860,6 +4602,9 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
     len = -len;
   }
   curchnk->mlcs_totalsize += len;
+  // Also for the line added or deleted below, before the chunks change.
+  ml_chunktree_add(buf, curix,
+                   updtype == ML_CHNK_ADDLINE ? 1 : updtype == ML_CHNK_DELLINE ? -1 : 0, len);
   if (updtype == ML_CHNK_ADDLINE) {
     int rest;
     DataBlock *dp;
@@ -3914,6 +4659,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
       buf->b_ml.ml_chunksize[curix].mlcs_totalsize = size;
       buf->b_ml.ml_chunksize[curix + 1].mlcs_totalsize -= size;
       buf->b_ml.ml_usedchunks++;
+      ml_chunktree_invalidate(buf);
       ml_upd_lastbuf = NULL;         // Force recalc of curix & curline
       return;
     } else if (buf->b_ml.ml_chunksize[curix].mlcs_numlines >= MLCS_MINL
@@ -3923,6 +4669,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
       // after this. Do it now to avoid the loop above later on
       curchnk = buf->b_ml.ml_chunksize + curix + 1;
       buf->b_ml.ml_usedchunks++;
+      ml_chunktree_invalidate(buf);
       if (line == buf->b_ml.ml_line_count) {
         curchnk->mlcs_numlines = 0;
         curchnk->mlcs_totalsize = 0;
@@ -3957,6 +4704,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
       curchnk = buf->b_ml.ml_chunksize + curix;
     } else if (curix == 0 && curchnk->mlcs_numlines <= 0) {
       buf->b_ml.ml_usedchunks--;
+      ml_chunktree_invalidate(buf);
       memmove(buf->b_ml.ml_chunksize, buf->b_ml.ml_chunksize + 1,
               (size_t)buf->b_ml.ml_usedchunks * sizeof(chunksize_T));
       return;
@@ -3971,6 +4719,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
     curchnk[-1].mlcs_numlines += curchnk->mlcs_numlines;
     curchnk[-1].mlcs_totalsize += curchnk->mlcs_totalsize;
     buf->b_ml.ml_usedchunks--;
+    ml_chunktree_invalidate(buf);
     if (curix < buf->b_ml.ml_usedchunks) {
       memmove(buf->b_ml.ml_chunksize + curix,
               buf->b_ml.ml_chunksize + curix + 1,
@@ -3984,6 +4733,126 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
   ml_upd_lastcurix = curix;
 }
 
+/// Start over with the chunks of "buf", for lines that are added in order
+/// with ml_chunks_add_line(). Used when the buffer is filled in one go.
+static void ml_chunks_start(buf_T *buf)
+{
+  xfree(buf->b_ml.ml_chunksize);
+  buf->b_ml.ml_numchunks = 100;
+  buf->b_ml.ml_chunksize = xmalloc(sizeof(chunksize_T) * 100);
+  buf->b_ml.ml_usedchunks = 1;
+  buf->b_ml.ml_chunksize[0].mlcs_numlines = 0;
+  buf->b_ml.ml_chunksize[0].mlcs_totalsize = 0;
+  ml_chunktree_invalidate(buf);
+  if (ml_upd_lastbuf == buf) {
+    ml_upd_lastbuf = NULL;
+  }
+}
+
+/// Add a line of "len" bytes, including the NUL, after the last chunk.
+static void ml_chunks_add_line(buf_T *buf, int len)
+{
+  chunksize_T *curchnk = buf->b_ml.ml_chunksize + buf->b_ml.ml_usedchunks - 1;
+  if (curchnk->mlcs_numlines >= MLCS_MINL || curchnk->mlcs_totalsize > INT_MAX - len) {
+    if (buf->b_ml.ml_usedchunks + 1 >= buf->b_ml.ml_numchunks) {
+      buf->b_ml.ml_numchunks = buf->b_ml.ml_numchunks * 3 / 2;
+      buf->b_ml.ml_chunksize = xrealloc(buf->b_ml.ml_chunksize,
+                                        sizeof(chunksize_T) * (size_t)buf->b_ml.ml_numchunks);
+    }
+    curchnk = buf->b_ml.ml_chunksize + buf->b_ml.ml_usedchunks++;
+    curchnk->mlcs_numlines = 0;
+    curchnk->mlcs_totalsize = 0;
+    ml_chunktree_invalidate(buf);
+  }
+  curchnk->mlcs_numlines++;
+  curchnk->mlcs_totalsize += len;
+  ml_chunktree_add(buf, buf->b_ml.ml_usedchunks - 1, 1, len);
+}
+
+/// Mark the chunk tree of "buf" outdated, after chunks were added or removed.
+/// It is rebuilt when it is used next.
+static void ml_chunktree_invalidate(buf_T *buf)
+{
+  buf->b_ml.ml_chunktree_len = 0;
+}
+
+/// Build the chunk tree of "buf" from the chunks, in O(n).
+static void ml_chunktree_build(buf_T *buf)
+{
+  const int n = buf->b_ml.ml_usedchunks;
+  chunktree_T *tree = xrealloc(buf->b_ml.ml_chunktree, sizeof(chunktree_T) * (size_t)(n + 1));
+  for (int i = 1; i <= n; i++) {
+    tree[i].mlct_numlines = buf->b_ml.ml_chunksize[i - 1].mlcs_numlines;
+    tree[i].mlct_totalsize = buf->b_ml.ml_chunksize[i - 1].mlcs_totalsize;
+  }
+  for (int i = 1; i <= n; i++) {
+    int parent = i + (i & -i);
+    if (parent <= n) {
+      tree[parent].mlct_numlines += tree[i].mlct_numlines;
+      tree[parent].mlct_totalsize += tree[i].mlct_totalsize;
+    }
+  }
+  buf->b_ml.ml_chunktree = tree;
+  buf->b_ml.ml_chunktree_len = n;
+}
+
+/// Add "lines" and "size" to chunk "curix" in the chunk tree of "buf".
+/// Nothing to do when it is outdated.
+static void ml_chunktree_add(buf_T *buf, int curix, int lines, int size)
+{
+  if (buf->b_ml.ml_chunktree_len != buf->b_ml.ml_usedchunks) {
+    return;
+  }
+  chunktree_T *tree = buf->b_ml.ml_chunktree;
+  for (int i = curix + 1; i <= buf->b_ml.ml_chunktree_len; i += i & -i) {
+    tree[i].mlct_numlines += lines;
+    tree[i].mlct_totalsize += size;
+  }
+}
+
+/// Find the chunk with line "lnum", or with byte "offset" when "lnum" is 0.
+/// The last chunk is used when beyond the end.
+///
+/// @param ffdos  when finding "offset": count one more byte for every line
+/// @param[out] curline  first line of the chunk
+/// @param[out] size  bytes before the chunk, including the ones for "ffdos"
+///
+/// @return  index of the chunk
+static int ml_chunk_find(buf_T *buf, linenr_T lnum, int offset, int ffdos, linenr_T *curline,
+                         int *size)
+{
+  if (buf->b_ml.ml_chunktree_len != buf->b_ml.ml_usedchunks) {
+    ml_chunktree_build(buf);
+  }
+  const chunktree_T *tree = buf->b_ml.ml_chunktree;
+  const int last = buf->b_ml.ml_usedchunks - 1;  // last chunk never qualifies
+  int curix = 0;
+  linenr_T lines = 0;
+  int64_t bytes = 0;
+
+  int step = 1;
+  while (step * 2 <= last) {
+    step *= 2;
+  }
+  // Skip the largest ranges of chunks that are before the wanted one.
+  for (; step > 0; step /= 2) {
+    int next = curix + step;
+    if (next > last) {
+      continue;
+    }
+    const chunktree_T *t = &tree[next];
+    int64_t t_bytes = t->mlct_totalsize + (lnum == 0 ? ffdos * t->mlct_numlines : 0);
+    if (lnum != 0 ? lnum >= lines + 1 + t->mlct_numlines : offset > bytes + t_bytes) {
+      curix = next;
+      lines += t->mlct_numlines;
+      bytes += t_bytes;
+    }
+  }
+  *curline = lines + 1;
+  *size = (int)bytes;
+  return curix;
+}
+
 /// Find offset for line or line with offset.
 ///
 /// @param buf buffer to use
@@ -4038,25 +4907,10 @@ int ml_find_line_or_offset(buf_T *buf, linenr_T lnum, int *offp, bool no_ff)
   if (lnum == 0 && offset <= 0) {
     return 1;       // Not a "find offset" and offset 0 _must_ be in line 1
   }
-  // Find the last chunk before the one containing our line. Last chunk is
-  // special because it will never qualify.
-  linenr_T curline = 1;
-  int curix = 0;
-  int size = 0;
-  while (curix < buf->b_ml.ml_usedchunks - 1
-         && ((lnum != 0
-              && lnum >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines)
-             || (offset != 0
-                 && offset > size +
-                 buf->b_ml.ml_chunksize[curix].mlcs_totalsize
-                 + ffdos * buf->b_ml.ml_chunksize[curix].mlcs_numlines))) {
-    curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    size += buf->b_ml.ml_chunksize[curix].mlcs_totalsize;
-    if (offset && ffdos) {
-      size += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    }
-    curix++;
-  }
+  // Find the chunk containing our line or offset.
+  linenr_T curline;
+  int size;
+  ml_chunk_find(buf, lnum, offset, ffdos, &curline, &size);
 
   while ((lnum != 0 && curline < lnum) || (offset != 0 && size < offset)) {
     if (curline > buf->b_ml.ml_line_count
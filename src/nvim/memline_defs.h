@@ -1,7 +1,11 @@
 #pragma once
 
+#include <stdint.h>
+
+#include "klib/kvec.h"
 #include "nvim/memfile_defs.h"
 #include "nvim/pos_defs.h"
+#include "nvim/types_defs.h"
 
 ///
 /// When searching for a specific line, we remember what blocks in the tree
@@ -20,6 +24,43 @@ typedef struct {
   int mlcs_totalsize;
 } chunksize_T;
 
+/// Node of the Fenwick tree over the chunks: the sums for a range of chunks.
+typedef struct {
+  linenr_T mlct_numlines;
+  int64_t mlct_totalsize;
+} chunktree_T;
+
+/// Maximum depth of the tree built by ml_bulk_add(). With at least 100
+/// entries per pointer block this is more than enough for MAXLNUM lines.
+#define ML_BULK_MAXDEPTH 10
+
+/// State for adding many lines at once, see ml_append_bulk_start().
+/// The lines are packed into new data blocks and a tree of pointer blocks is
+/// built bottom-up, it is added to the memline by ml_append_bulk_end().
+typedef struct {
+  buf_T *mb_buf;                         ///< buffer, NULL when not started
+  linenr_T mb_lnum;                      ///< lines are appended after this line
+  int mb_flags;                          ///< ML_APPEND_ flags
+  linenr_T mb_direct;                    ///< number of lines appended one by one
+  linenr_T mb_count;                     ///< number of lines packed
+  bhdr_T *mb_data;                       ///< data block being filled
+  linenr_T mb_data_first;                ///< first line in mb_data
+  bhdr_T *mb_ptr[ML_BULK_MAXDEPTH];      ///< pointer block being filled per level
+  linenr_T mb_lines[ML_BULK_MAXDEPTH];   ///< number of lines below mb_ptr[]
+  linenr_T mb_first[ML_BULK_MAXDEPTH];   ///< first line below mb_ptr[]
+  int mb_depth;                          ///< number of levels in use
+} mlbulk_T;
+
+/// The text of a buffer at one moment, see ml_snapshot(). The data blocks are
+/// shared with the memfile, which copies a block before changing it. The
+/// lines can be read by any thread with ml_snapshot_lines().
+typedef struct {
+  mfshare_T *ms_share;
+  kvec_t(void *) ms_blocks;              ///< data blocks, in line order
+  linenr_T ms_line_count;
+  int64_t ms_size;                       ///< bytes of text, with a NUL per line
+} mlsnap_T;
+
 // Flags when calling ml_updatechunk()
 #define ML_CHNK_ADDLINE 1
 #define ML_CHNK_DELLINE 2
@@ -34,6 +75,8 @@ typedef struct {
 ///
 /// Memline also has "chunks" of 800 lines that are separate from the 128-tree
 /// structure, primarily used to speed up line2byte() and byte2line().
+/// A Fenwick tree over the chunks finds the chunk with a line or byte offset,
+/// and updates the sums after a change, in O(log n).
 ///
 /// Motivation: If you have a file that is 10000 lines long, and you insert
 ///             a line at linenr 1000, you don't want to move 9000 lines in
@@ -69,4 +112,6 @@ typedef struct {
   chunksize_T *ml_chunksize;
   int ml_numchunks;
   int ml_usedchunks;
+  chunktree_T *ml_chunktree;    // Fenwick tree over ml_chunksize, 1-based
+  int ml_chunktree_len;         // chunks in ml_chunktree, 0 when outdated
 } memline_T;
@@ -7,6 +7,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <uv.h>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 
 #include "nvim/api/extmark.h"
 #include "nvim/api/private/helpers.h"
@@ -27,9 +32,11 @@
 #include "nvim/highlight_group.h"
 #include "nvim/insexpand.h"
 #include "nvim/lua/executor.h"
+#include "nvim/macros_defs.h"
 #include "nvim/main.h"
 #include "nvim/map_defs.h"
 #include "nvim/mapping.h"
+#include "nvim/math.h"
 #include "nvim/memfile.h"
 #include "nvim/memory.h"
 #include "nvim/message.h"
@@ -60,6 +67,28 @@ MemRealloc mem_realloc = &realloc;
 bool entered_free_all_mem = false;
 #endif
 
+/// Thread whose allocations are counted in "mem_alloc_count", other threads
+/// would race on it.
+static uv_thread_t mem_count_thread;
+static bool mem_count_thread_set = false;
+
+/// Count the allocations of the current thread from now on.
+void mem_count_init(void)
+{
+  mem_count_thread = uv_thread_self();
+  mem_count_thread_set = true;
+}
+
+static inline void mem_count_alloc(void)
+{
+  if (mem_count_thread_set) {
+    uv_thread_t self = uv_thread_self();
+    if (uv_thread_equal(&self, &mem_count_thread)) {
+      mem_alloc_count++;
+    }
+  }
+}
+
 /// Try to free memory. Used when trying to recover from out of memory errors.
 /// @see {xmalloc}
 static void try_to_free_memory(void)
@@ -110,6 +139,7 @@ static void do_outofmem_msg(size_t size)
 void *try_malloc(size_t size) FUNC_ATTR_MALLOC FUNC_ATTR_ALLOC_SIZE(1)
 {
   size_t allocated_size = size ? size : 1;
+  mem_count_alloc();
   void *ret = malloc(allocated_size);
   if (!ret) {
     try_to_free_memory();
@@ -170,6 +200,7 @@ void *xcalloc(size_t count, size_t size)
 {
   size_t allocated_count = count && size ? count : 1;
   size_t allocated_size = count && size ? size : 1;
+  mem_count_alloc();
   void *ret = calloc(allocated_count, allocated_size);
   if (!ret) {
     try_to_free_memory();
@@ -190,6 +221,7 @@ void *xrealloc(void *ptr, size_t size)
   FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_ALLOC_SIZE(2) FUNC_ATTR_NONNULL_RET
 {
   size_t allocated_size = size ? size : 1;
+  mem_count_alloc();
   void *ret = realloc(ptr, allocated_size);
   if (!ret) {
     try_to_free_memory();
@@ -292,6 +324,181 @@ void *xmemscan(const void *addr, char c, size_t size)
   return p ? p : (char *)addr + size;
 }
 
+/// Find the first byte in a memory object that is NUL, `c1` or `c2`. Quick
+/// for long stretches without them, which are checked 16 or 8 bytes at a time.
+///
+/// @param addr The address of the memory object.
+/// @param c1   A char to look for.
+/// @param c2   Another char to look for, may be equal to `c1`.
+/// @param size The size of the memory object.
+/// @returns the number of bytes before the first one found, `size` if none.
+size_t xmemcspn(const void *addr, char c1, char c2, size_t size)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  const uint8_t *s = addr;
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  for (; size - i >= 16; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, zero),
+                                              _mm_or_si128(_mm_cmpeq_epi8(v, v1),
+                                                           _mm_cmpeq_epi8(v, v2))));
+    if (mask != 0) {
+      return i + (size_t)xctz((uint64_t)mask);
+    }
+  }
+#else
+  // A byte of "w" is zero when the high bit of that byte in
+  // (w - 0x01..) & ~w & 0x80.. is set, no false positives before it.
+# define HASZERO(w) (((w) - 0x0101010101010101ULL) & ~(w) & 0x8080808080808080ULL)
+  const uint64_t m1 = 0x0101010101010101ULL * (uint8_t)c1;
+  const uint64_t m2 = 0x0101010101010101ULL * (uint8_t)c2;
+  for (; size - i >= 8; i += 8) {
+    uint64_t w;
+    memcpy(&w, s + i, sizeof(w));
+    if (HASZERO(w) | HASZERO(w ^ m1) | HASZERO(w ^ m2)) {
+      break;
+    }
+  }
+# undef HASZERO
+#endif
+  for (; i < size; i++) {
+    if (s[i] == NUL || s[i] == (uint8_t)c1 || s[i] == (uint8_t)c2) {
+      break;
+    }
+  }
+  return i;
+}
+
+/// Compare "n" bytes, ignoring the case of ASCII letters when "ic" is true.
+static bool memeq_ic(const uint8_t *a, const uint8_t *b, size_t n, bool ic)
+{
+  if (!ic) {
+    return memcmp(a, b, n) == 0;
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (TOLOWER_ASC(a[i]) != TOLOWER_ASC(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Find `needle` in a memory object, like memmem().  Candidate positions are
+/// found by checking the first and the last byte of `needle` at 16 or 8
+/// positions at a time.
+///
+/// @param addr   The address of the memory object, may contain NULs.
+/// @param size   The size of the memory object.
+/// @param needle The bytes to look for.
+/// @param nlen   The length of `needle`.
+/// @param ic     Ignore the case of ASCII letters.
+/// @returns a pointer to the first instance of `needle`, or NULL if not found.
+void *xmemfind(const void *addr, size_t size, const char *needle, size_t nlen, bool ic)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  const uint8_t *s = addr;
+  const uint8_t *nd = (const uint8_t *)needle;
+  if (nlen == 0) {
+    return (void *)s;
+  }
+  if (nlen > size) {
+    return NULL;
+  }
+  // With "ic" a letter is compared with bit 0x20 set on both sides, which
+  // only makes upper and lower case of the same letter equal.
+  const uint8_t fm = ic && ASCII_ISALPHA(nd[0]) ? 0x20 : 0;
+  const uint8_t lm = ic && ASCII_ISALPHA(nd[nlen - 1]) ? 0x20 : 0;
+  const uint8_t fc = nd[0] | fm;
+  const uint8_t lc = nd[nlen - 1] | lm;
+  const size_t nstart = size - nlen + 1;  // number of possible starts
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i vfm = _mm_set1_epi8((char)fm);
+  const __m128i vlm = _mm_set1_epi8((char)lm);
+  const __m128i vfc = _mm_set1_epi8((char)fc);
+  const __m128i vlc = _mm_set1_epi8((char)lc);
+  for (; nstart - i >= 16; i += 16) {
+    __m128i f = _mm_loadu_si128((const __m128i *)(s + i));
+    __m128i l = _mm_loadu_si128((const __m128i *)(s + i + nlen - 1));
+    unsigned mask
+      = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(f, vfm), vfc),
+                                                  _mm_cmpeq_epi8(_mm_or_si128(l, vlm), vlc)));
+    while (mask != 0) {
+      size_t j = i + (size_t)xctz(mask);
+      if (memeq_ic(s + j, nd, nlen, ic)) {
+        return (void *)(s + j);
+      }
+      mask &= mask - 1;
+    }
+  }
+#else
+  // See xmemcspn().  A false positive only means looking at the 8 positions
+  // one by one.
+# define HASZERO(w) (((w) - 0x0101010101010101ULL) & ~(w) & 0x8080808080808080ULL)
+  const uint64_t mf = 0x0101010101010101ULL * fm;
+  const uint64_t ml = 0x0101010101010101ULL * lm;
+  const uint64_t cf = 0x0101010101010101ULL * fc;
+  const uint64_t cl = 0x0101010101010101ULL * lc;
+  for (; nstart - i >= 8; i += 8) {
+    uint64_t f;
+    uint64_t l;
+    memcpy(&f, s + i, sizeof(f));
+    memcpy(&l, s + i + nlen - 1, sizeof(l));
+    if (HASZERO((f | mf) ^ cf) & HASZERO((l | ml) ^ cl)) {
+      for (size_t j = i; j < i + 8; j++) {
+        if ((s[j] | fm) == fc && memeq_ic(s + j, nd, nlen, ic)) {
+          return (void *)(s + j);
+        }
+      }
+    }
+  }
+# undef HASZERO
+#endif
+  for (; i < nstart; i++) {
+    if ((s[i] | fm) == fc && memeq_ic(s + i, nd, nlen, ic)) {
+      return (void *)(s + i);
+    }
+  }
+  return NULL;
+}
+
+/// Check if a memory object only contains ASCII bytes, 16 or 8 at a time.
+///
+/// @param addr The address of the memory object.
+/// @param size The size of the memory object.
+/// @returns true if no byte has the high bit set.
+bool xmemisascii(const void *addr, size_t size)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  const uint8_t *s = addr;
+  size_t i = 0;
+#ifdef __SSE2__
+  for (; size - i >= 16; i += 16) {
+    if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i))) != 0) {
+      return false;
+    }
+  }
+#else
+  for (; size - i >= 8; i += 8) {
+    uint64_t w;
+    memcpy(&w, s + i, sizeof(w));
+    if (w & 0x8080808080808080ULL) {
+      return false;
+    }
+  }
+#endif
+  for (; i < size; i++) {
+    if (s[i] >= 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
 /// Replaces every instance of `c` with `x`.
 ///
 /// @warning Will read past `str + strlen(str)` if `c == NUL`.
@@ -45,6 +45,8 @@ typedef void (*MergeSortSetFunc)(void *, void *);
 typedef int (*MergeSortCompareFunc)(const void *, const void *);
 
 EXTERN size_t arena_alloc_count INIT( = 0);
+/// Number of malloc(), calloc() and realloc() calls by the main thread.
+EXTERN size_t mem_alloc_count INIT( = 0);
 
 #define kv_fixsize_arena(a, v, s) \
   ((v).capacity = (s), \
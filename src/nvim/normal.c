@@ -1472,8 +1472,11 @@ static int normal_check(VimState *state)
     }
 
     normal_check_folds(s);
-    normal_redraw(s);
-    do_redraw = false;
+    // A redraw for events may have to wait for the next frame.
+    if (do_redraw || must_redraw == 0 || !redraw_frame_hold()) {
+      normal_redraw(s);
+      do_redraw = false;
+    }
 
     // Now that we have drawn the first screen all the startup stuff
     // has been done, close any file for startup messages.
@@ -93,6 +93,7 @@
 #include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
 #include "nvim/path.h"
+#include "nvim/plines.h"
 #include "nvim/popupmenu.h"
 #include "nvim/pos_defs.h"
 #include "nvim/regexp.h"
@@ -2840,6 +2841,10 @@ static const char *validate_num_option(OptIndex opt_idx, OptInt *newval, char *e
   case kOptTextwidth:
   case kOptWritedelay:
   case kOptTimeoutlen:
+  case kOptLazyload:
+  case kOptMemcompress:
+  case kOptAsyncwrite:
+  case kOptRedrawrate:
     if (value < 0) {
       return e_positive;
     }
@@ -2895,7 +2900,7 @@ static const char *validate_num_option(OptIndex opt_idx, OptInt *newval, char *e
     }
     break;
   case kOptRegexpengine:
-    if (value < 0 || value > 2) {
+    if (value < 0 || value > 3) {
       return e_invarg;
     }
     break;
@@ -3532,6 +3537,8 @@ static const char *did_set_option(OptIndex opt_idx, void *varp, OptVal old_value
     }
   }
 
+  rowfp_clear_all();
+
   // Don't do anything else if setting the option directly.
   if (direct) {
     return errmsg;
@@ -3572,6 +3579,7 @@ static const char *did_set_option(OptIndex opt_idx, void *varp, OptVal old_value
   }
 
   check_redraw(opt->flags);
+  linesize_cache_clear_all();
 
   if (errmsg == NULL) {
     opt->flags |= kOptFlagWasSet;
@@ -4863,6 +4871,7 @@ void win_copy_options(win_T *wp_from, win_T *wp_to)
   copy_winopt(&wp_from->w_onebuf_opt, &wp_to->w_onebuf_opt);
   copy_winopt(&wp_from->w_allbuf_opt, &wp_to->w_allbuf_opt);
   didset_window_options(wp_to, true);
+  rowfp_clear_all();
 }
 
 static char *copy_option_val(const char *val)
@@ -5044,6 +5053,8 @@ void buf_copy_options(buf_T *buf, int flags)
   char *save_p_isk = NULL;           // init for GCC
   bool did_isk = false;
 
+  rowfp_clear_all();
+
   // Skip this when the option defaults have not been set yet.  Happens when
   // main() allocates the first buffer.
   if (p_cpo != NULL) {
@@ -248,6 +248,7 @@ EXTERN char empty_string_option[] INIT( = "");
 // The following are actual variables for the options
 
 EXTERN char *p_ambw;             ///< 'ambiwidth'
+EXTERN OptInt p_awr;             ///< 'asyncwrite'
 EXTERN int p_acd;                ///< 'autochdir'
 EXTERN int p_ai;                 ///< 'autoindent'
 EXTERN int p_bin;                ///< 'binary'
@@ -344,6 +345,7 @@ EXTERN char *p_ff;              ///< 'fileformat'
 EXTERN char *p_ffs;             ///< 'fileformats'
 EXTERN int p_fic;               ///< 'fileignorecase'
 EXTERN char *p_ft;              ///< 'filetype'
+EXTERN int p_fw;                ///< 'filewatch'
 EXTERN char *p_fcs;             ///< 'fillchar'
 EXTERN char *p_ffu;             ///< 'findfunc'
 EXTERN int p_fixeol;            ///< 'fixendofline'
@@ -401,6 +403,7 @@ EXTERN char *p_lispwords;       ///< 'lispwords'
 EXTERN OptInt p_ls;             ///< 'laststatus'
 EXTERN OptInt p_stal;           ///< 'showtabline'
 EXTERN char *p_lcs;             ///< 'listchars'
+EXTERN OptInt p_lazyload;       ///< 'lazyload'
 EXTERN int p_lz;                ///< 'lazyredraw'
 EXTERN int p_lpl;               ///< 'loadplugins'
 EXTERN int p_magic;             ///< 'magic'
@@ -413,6 +416,7 @@ EXTERN OptInt p_mco;            ///< 'maxcombine'
 EXTERN OptInt p_mfd;            ///< 'maxfuncdepth'
 EXTERN OptInt p_mmd;            ///< 'maxmapdepth'
 EXTERN OptInt p_mmp;            ///< 'maxmempattern'
+EXTERN OptInt p_mcm;            ///< 'memcompress'
 EXTERN OptInt p_mis;            ///< 'menuitems'
 EXTERN char *p_mopt;            ///< 'messagesopt'
 EXTERN OptInt p_msc;            ///< 'maxsearchcount'
@@ -446,6 +450,7 @@ EXTERN char *p_qe;              ///< 'quoteescape'
 EXTERN int p_ro;                ///< 'readonly'
 EXTERN char *p_rdb;             ///< 'redrawdebug'
 EXTERN unsigned rdb_flags;
+EXTERN OptInt p_rdr;            ///< 'redrawrate'
 EXTERN OptInt p_rdt;            ///< 'redrawtime'
 EXTERN OptInt p_re;             ///< 'regexpengine'
 EXTERN OptInt p_report;         ///< 'report'
@@ -210,6 +210,33 @@ local options = {
       type = 'boolean',
       varname = 'p_arshape',
     },
+    {
+      abbreviation = 'awr',
+      defaults = 0,
+      desc = [=[
+        Minimal size of a buffer in Kbyte to write it in the background.
+        When |:write| or |:update| writes at least this much text to the file
+        being edited, Nvim takes a snapshot of the buffer and a worker thread
+        writes it to a new file next to the original one.  Only
+        when that is done the new file replaces the original, the
+        |BufWritePost| autocommands are triggered and, when the buffer was
+        not changed in the meantime, 'modified' is reset.  Editing can
+        continue while a big file is being written.
+        Only used for an existing file that needs no conversion, is not a
+        link, is owned by the user, with 'fileformat' "unix" or "dos", and
+        when 'backup' and 'patchmode' are not set and 'backupcopy' does not
+        include "yes".  Otherwise, or when the value is zero, the buffer is
+        written as usual.
+        A command that follows, such as in ":w | !make", may run before
+        writing is done.  Writing the buffer again, or abandoning or
+        unloading it, first waits for the write to finish.
+      ]=],
+      full_name = 'asyncwrite',
+      scope = { 'global' },
+      short_desc = N_('minimal size in Kbyte for writing in the background'),
+      type = 'number',
+      varname = 'p_awr',
+    },
     {
       abbreviation = 'acd',
       cb = 'did_set_autochdir',
@@ -3199,6 +3226,29 @@ local options = {
       type = 'string',
       varname = 'p_ft',
     },
+    {
+      abbreviation = 'fw',
+      defaults = true,
+      desc = [=[
+        When on, the files of loaded buffers are watched for changes made
+        outside of Nvim, using the file system notifications of the operating
+        system.  A change marks the buffer, and when checking timestamps
+        |timestamp| only the marked buffers are looked at, instead of getting
+        the file info for every buffer.  For a buffer with 'autoread' set
+        that was not changed in Nvim, the file is read again as soon as the
+        change is noticed, without waiting for focus to return to Nvim or a
+        shell command to finish.
+        Buffers whose file cannot be watched are always checked.  Switch this
+        option off for file systems that do not report all changes, e.g. a
+        network file system where the file may be changed on another
+        machine.  |:checktime| always checks all buffers.
+      ]=],
+      full_name = 'filewatch',
+      scope = { 'global' },
+      short_desc = N_('watch files of buffers for changes'),
+      type = 'boolean',
+      varname = 'p_fw',
+    },
     {
       abbreviation = 'fcs',
       cb = 'did_set_chars_option',
@@ -5210,6 +5260,32 @@ local options = {
       type = 'number',
       varname = 'p_ls',
     },
+    {
+      abbreviation = 'lzl',
+      defaults = 0,
+      desc = [=[
+        Minimal size of a file in Kbyte to load it lazily.  When editing a
+        file at least this big, Nvim keeps it open instead of reading it.
+        A block of lines is read from the file when it is first used, and
+        dropped again when it was not changed and has not been used for a
+        while.  Opening a very large file is much faster and takes little
+        memory this way.
+        Only used for a file that needs no conversion (it is valid UTF-8 and
+        has no BOM), is in "unix" 'fileformat' and when there is no
+        'undofile' to read.  Otherwise, or when the value is zero, the file
+        is read as usual.
+        Unchanged lines are read from the file as it is when they are used.
+        Appending to the file does not change them.  When the file is changed
+        or truncated in another way, lines read after that may be empty and a
+        warning is given.  Writing the buffer to the file first reads all the
+        lines.
+      ]=],
+      full_name = 'lazyload',
+      scope = { 'global' },
+      short_desc = N_('minimal file size in Kbyte for lazy loading'),
+      type = 'number',
+      varname = 'p_lazyload',
+    },
     {
       abbreviation = 'lz',
       defaults = false,
@@ -5743,6 +5819,25 @@ local options = {
       type = 'number',
       varname = 'p_msc',
     },
+    {
+      abbreviation = 'mcm',
+      defaults = 0,
+      desc = [=[
+        Maximum amount of memory in Kbyte used for the text of a buffer that
+        has no swap file.  When more is used, the blocks of lines that were
+        not used for the longest time are compressed in memory, and they are
+        uncompressed again when used.  This makes a big buffer without a
+        swap file take much less memory, at the cost of some time when
+        jumping around in it.
+        When the value is zero nothing is compressed.  See |nvim__stats()|
+        for how well it works.
+      ]=],
+      full_name = 'memcompress',
+      scope = { 'global' },
+      short_desc = N_('max memory in Kbyte used for uncompressed text'),
+      type = 'number',
+      varname = 'p_mcm',
+    },
     {
       abbreviation = 'mis',
       defaults = 25,
@@ -6849,6 +6944,23 @@ local options = {
       varname = 'p_rdb',
       flags_varname = 'rdb_flags',
     },
+    {
+      abbreviation = 'rdr',
+      defaults = 0,
+      desc = [=[
+        Maximum number of screen updates per second for redrawing caused by
+        events, such as job output, RPC requests and timers.  Redraws asked
+        for in between are combined into the next update.  Typed keys are
+        always handled and displayed right away.
+        When the value is zero there is no limit.  See |nvim__stats()| for
+        the number of combined and skipped updates.
+      ]=],
+      full_name = 'redrawrate',
+      scope = { 'global' },
+      short_desc = N_('max number of redraws per second for events'),
+      type = 'number',
+      varname = 'p_rdr',
+    },
     {
       abbreviation = 'rdt',
       defaults = 2000,
@@ -6878,13 +6990,15 @@ local options = {
         	0	automatic selection
         	1	old engine
         	2	NFA engine
+        	3	NFA engine with a lazy DFA
         Note that when using the NFA engine and the pattern contains something
         that is not supported the pattern will not match.  This is only useful
         for debugging the regexp engine.
         Using automatic selection enables Vim to switch the engine, if the
         default engine becomes too costly.  E.g., when the NFA engine uses too
         many states.  This should prevent Vim from hanging on a combination of
-        a complex pattern with long text.
+        a complex pattern with long text.  Automatic selection also uses the
+        lazy DFA for patterns that it supports.
       ]=],
       full_name = 'regexpengine',
       scope = { 'global' },
@@ -373,6 +373,22 @@ int64_t os_get_pid(void)
 #endif
 }
 
+/// Get the number of CPUs, for splitting work between threads.
+///
+/// @return at least one.
+int os_cpu_count(void)
+{
+  static int cpu_count = 0;
+  if (cpu_count == 0) {
+    uv_cpu_info_t *cpu_infos;
+    if (uv_cpu_info(&cpu_infos, &cpu_count) == 0) {
+      uv_free_cpu_info(cpu_infos, cpu_count);
+    }
+    cpu_count = MAX(cpu_count, 1);
+  }
+  return cpu_count;
+}
+
 /// Signals to the OS that Nvim is an application for "interactive work"
 /// which should be prioritized similar to a GUI app.
 void os_hint_priority(void)
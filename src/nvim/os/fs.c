@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -670,6 +671,35 @@ ptrdiff_t os_readv(const int fd, bool *const ret_eof, struct iovec *iov, size_t
 }
 #endif  // HAVE_READV
 
+/// Read from a file at an offset, without changing the file position
+///
+/// @param[in]  fd  File descriptor to read from.
+/// @param[out]  ret_buf  Buffer to write to.
+/// @param[in]  size  Amount of bytes to read.
+/// @param[in]  offset  Offset in the file to read from.
+///
+/// @return Number of bytes read, less than "size" at the end of the file, or
+///         libuv error code (< 0).
+ptrdiff_t os_pread(const int fd, char *const ret_buf, const size_t size, const uint64_t offset)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  size_t read_bytes = 0;
+  while (read_bytes != size) {
+    uv_buf_t buf = uv_buf_init(ret_buf + read_bytes, (unsigned)MIN(size - read_bytes, INT_MAX));
+    int r;
+    RUN_UV_FS_FUNC(r, uv_fs_read, fd, &buf, 1, (int64_t)(offset + read_bytes), NULL);
+    if (r == UV_EINTR || r == UV_EAGAIN) {
+      continue;
+    } else if (r < 0) {
+      return (ptrdiff_t)r;
+    } else if (r == 0) {
+      break;
+    }
+    read_bytes += (size_t)r;
+  }
+  return (ptrdiff_t)read_bytes;
+}
+
 /// Write to a file
 ///
 /// @param[in]  fd  File descriptor to write to.
@@ -711,6 +741,62 @@ ptrdiff_t os_write(const int fd, const char *const buf, const size_t size, const
   return (ptrdiff_t)written_bytes;
 }
 
+#ifdef HAVE_WRITEV
+/// Write multiple buffers to a file at once
+///
+/// Wrapper for writev().
+///
+/// @param[in]  fd  File descriptor to write to.
+/// @param[in,out]  iov  Description of buffers to write. Note: this description
+///                      may change, it is incorrect to use it after
+///                      os_writev().
+/// @param[in]  iov_size  Number of buffers in iov, at most IOV_MAX.
+/// @param[in]  non_blocking  Do not restart syscall if EAGAIN was encountered.
+///
+/// @return Number of bytes written or libuv error code (< 0).
+ptrdiff_t os_writev(const int fd, struct iovec *iov, size_t iov_size, const bool non_blocking)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  size_t written_bytes = 0;
+  size_t towrite = 0;
+  for (size_t i = 0; i < iov_size; i++) {
+    // Overflow, trying to write too much data
+    assert(towrite <= SIZE_MAX - iov[i].iov_len);
+    towrite += iov[i].iov_len;
+  }
+  while (written_bytes < towrite) {
+    ptrdiff_t cur_written_bytes = writev(fd, iov, (int)iov_size);
+    if (cur_written_bytes > 0) {
+      written_bytes += (size_t)cur_written_bytes;
+      while (iov_size && cur_written_bytes) {
+        if (cur_written_bytes < (ptrdiff_t)iov->iov_len) {
+          iov->iov_len -= (size_t)cur_written_bytes;
+          iov->iov_base = (char *)iov->iov_base + cur_written_bytes;
+          cur_written_bytes = 0;
+        } else {
+          cur_written_bytes -= (ptrdiff_t)iov->iov_len;
+          iov_size--;
+          iov++;
+        }
+      }
+    } else if (cur_written_bytes < 0) {
+      const int error = os_translate_sys_error(errno);
+      errno = 0;
+      if (non_blocking && error == UV_EAGAIN) {
+        break;
+      } else if (error == UV_EINTR || error == UV_EAGAIN) {
+        continue;
+      } else {
+        return (ptrdiff_t)error;
+      }
+    } else {
+      return UV_UNKNOWN;
+    }
+  }
+  return (ptrdiff_t)written_bytes;
+}
+#endif  // HAVE_WRITEV
+
 /// Copies a file from `path` to `new_path`.
 ///
 /// @see http://docs.libuv.org/en/v1.x/fs.html#c.uv_fs_copyfile
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "klib/kvec.h"
 #include "nvim/api/extmark.h"
 #include "nvim/ascii_defs.h"
 #include "nvim/buffer.h"
@@ -76,7 +77,122 @@ int linetabsize_col(int startvcol, char *s)
 /// Doesn't count the size of 'listchars' "eol".
 int linetabsize(win_T *wp, linenr_T lnum)
 {
-  return win_linetabsize(wp, lnum, ml_get_buf(wp->w_buffer, lnum), MAXCOL);
+  return win_linesize(wp, lnum);
+}
+
+/// Incremented to invalidate the line size cache of all windows.
+static int linesize_gen = 0;
+
+/// Invalidate the line size cache of all windows, e.g. when an option was set
+/// that may change the number of cells of characters.
+void linesize_cache_clear_all(void)
+{
+  linesize_gen++;
+}
+
+/// Invalidate the line size cache of all windows for buffer "buf", when it
+/// is unloaded.
+void linesize_cache_clear_buf(buf_T *buf)
+{
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    if (wp->w_linesize.lc_buf == buf) {
+      kv_size(wp->w_linesize.lc_size) = 0;
+      wp->w_linesize.lc_buf = NULL;
+    }
+  }
+}
+
+/// Invalidate the cached sizes of lines "lnum" to "lnume" (exclusive) of
+/// buffer "buf" after they were changed, and of the lines below them when
+/// "xtra" lines were inserted or deleted.
+/// Must be called right after b:changedtick was incremented for the change.
+void linesize_cache_changed(buf_T *buf, linenr_T lnum, linenr_T lnume, linenr_T xtra)
+{
+  varnumber_T const changedtick = buf_get_changedtick(buf);
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    LineSizeCache *lc = &wp->w_linesize;
+    if (lc->lc_buf != buf) {
+      continue;
+    }
+    size_t const top = (size_t)MAX(lnum - 1, 0);
+    if (lc->lc_changedtick != changedtick - 1) {
+      // There was another change, don't know which lines it changed.
+      kv_size(lc->lc_size) = 0;
+    } else if (xtra != 0) {
+      kv_size(lc->lc_size) = MIN(kv_size(lc->lc_size), top);
+    } else {
+      for (size_t i = top; i < kv_size(lc->lc_size) && i < (size_t)lnume - 1; i++) {
+        kv_A(lc->lc_size, i) = -1;
+      }
+    }
+    lc->lc_changedtick = changedtick;
+  }
+}
+
+/// Get the line size cache of window "wp", cleared when the sizes it has may
+/// be wrong now.
+///
+/// @return  NULL when the cache can't be used, because the buffer has inline
+///          virtual text.
+static LineSizeCache *linesize_cache_get(win_T *wp)
+{
+  buf_T *const buf = wp->w_buffer;
+  if (buf_meta_total(buf, kMTMetaInline) > 0) {
+    return NULL;
+  }
+
+  LineSizeCache *lc = &wp->w_linesize;
+  int const col_off = win_col_off(wp);
+  int const col_off2 = win_col_off2(wp);
+  if (lc->lc_buf != buf
+      || lc->lc_changedtick != buf_get_changedtick(buf)
+      || lc->lc_gen != linesize_gen
+      || lc->lc_width != wp->w_view_width
+      || lc->lc_col_off != col_off
+      || lc->lc_col_off2 != col_off2
+      || lc->lc_ts != buf->b_p_ts
+      || lc->lc_vts != buf->b_p_vts_array
+      || lc->lc_list != wp->w_p_list
+      || lc->lc_wrap != wp->w_p_wrap
+      || lc->lc_lbr != wp->w_p_lbr
+      || lc->lc_bri != wp->w_p_bri) {
+    kv_size(lc->lc_size) = 0;
+    lc->lc_buf = buf;
+    lc->lc_changedtick = buf_get_changedtick(buf);
+    lc->lc_gen = linesize_gen;
+    lc->lc_width = wp->w_view_width;
+    lc->lc_col_off = col_off;
+    lc->lc_col_off2 = col_off2;
+    lc->lc_ts = buf->b_p_ts;
+    lc->lc_vts = buf->b_p_vts_array;
+    lc->lc_list = wp->w_p_list;
+    lc->lc_wrap = wp->w_p_wrap;
+    lc->lc_lbr = wp->w_p_lbr;
+    lc->lc_bri = wp->w_p_bri;
+  }
+  return lc;
+}
+
+/// Like linetabsize(), but remembers the size in the line size cache of the
+/// window.  Scrolling through wrapped lines then doesn't need to go over the
+/// text of each line again.
+static int win_linesize(win_T *wp, linenr_T lnum)
+{
+  LineSizeCache *lc = linesize_cache_get(wp);
+  if (lc != NULL && (size_t)lnum <= kv_size(lc->lc_size) && kv_A(lc->lc_size, lnum - 1) >= 0) {
+    g_stats.linesize_hit++;
+    return kv_A(lc->lc_size, lnum - 1);
+  }
+
+  int size = win_linetabsize(wp, lnum, ml_get_buf(wp->w_buffer, lnum), MAXCOL);
+  if (lc != NULL) {
+    g_stats.linesize_miss++;
+    while (kv_size(lc->lc_size) < (size_t)lnum) {
+      kv_push(lc->lc_size, -1);
+    }
+    kv_A(lc->lc_size, lnum - 1) = size;
+  }
+  return size;
 }
 
 /// Like linetabsize(), but counts the size of 'listchars' "eol".
@@ -784,20 +900,11 @@ int plines_win_nofill(win_T *wp, linenr_T lnum, bool limit_winheight)
 /// Does not care about folding, 'wrap' or filler lines.
 int plines_win_nofold(win_T *wp, linenr_T lnum)
 {
-  char *s = ml_get_buf(wp->w_buffer, lnum);
-  CharsizeArg csarg;
-  CSType const cstype = init_charsize_arg(&csarg, wp, lnum, s);
-  if (*s == NUL && csarg.virt_row < 0) {
+  int64_t col = win_linesize(wp, lnum);
+  if (col == 0) {
     return 1;  // be quick for an empty line
   }
 
-  int64_t col;
-  if (cstype == kCharsizeFast) {
-    col = linesize_fast(&csarg, 0, MAXCOL);
-  } else {
-    col = linesize_regular(&csarg, 0, MAXCOL);
-  }
-
   // If list mode is on, then the '$' at the end of the line may take up one
   // extra column.
   if (wp->w_p_list && wp->w_p_lcs_chars.eol != NUL) {
@@ -9,7 +9,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <uv.h>
 
+#include "klib/kvec.h"
 #include "nvim/arglist.h"
 #include "nvim/ascii_defs.h"
 #include "nvim/autocmd.h"
@@ -259,6 +261,37 @@ typedef struct {
   char *qf_title;      ///< quickfix list title
 } vgr_args_T;
 
+enum {
+  VGR_READ_BATCH = 64,  ///< files read ahead by vgr_read_files()
+  VGR_READ_MAXPARTS = 16,  ///< maximum number of threads
+};
+
+/// Line of a file read by vgr_read_files() that may match.
+typedef struct {
+  linenr_T lnum;
+  colnr_T len;
+  size_t off;   ///< byte offset in the file
+} vgr_line_T;
+
+/// File of :vimgrep read by vgr_read_files().
+typedef struct {
+  char *fname;   ///< name in the argument list
+  bool try_read;  ///< may be searched without loading it into a buffer
+  bool read;     ///< was read, is searched without loading it into a buffer
+  char *text;    ///< text of the file, NULL when no line may match
+  kvec_t(vgr_line_T) lines;  ///< lines that may match
+} vgr_file_T;
+
+/// Files read by one thread of vgr_read_files().
+typedef struct {
+  vgr_file_T *files;
+  int first;     ///< index of the first file to read
+  int count;     ///< number of files
+  int step;      ///< read every "step" file
+  regfilter_T *rf;  ///< check for lines that may match, NULL to use all lines
+  uv_thread_t thread;
+} vgr_part_T;
+
 #include "quickfix.c.generated.h"
 
 static const char *e_no_more_items = N_("E553: No more items");
@@ -5584,6 +5617,236 @@ static bool vgr_match_buflines(qf_list_T *qfl, char *fname, buf_T *buf, char *sp
   return found_match;
 }
 
+/// Check if a file that is valid UTF-8 without a BOM, NUL or CR can be
+/// searched as it is: loading it into a buffer would not change its text or
+/// what the pattern matches.
+static bool vgr_can_read(vgr_args_T *args)
+{
+  if ((args->flags & VGR_FUZZY) || !re_line_local(args->regmatch.regprog)
+      || strstr(p_ffs, "unix") == NULL || strcmp(curbuf->b_p_isk, p_isk) != 0) {
+    return false;
+  }
+  // Without a BOM the item after "ucs-bom" in 'fileencodings' is used.
+  const char *fenc = p_fencs;
+  if (strncmp(fenc, "ucs-bom", 7) == 0 && (fenc[7] == ',' || fenc[7] == NUL)) {
+    fenc += fenc[7] == ',' ? 8 : 7;
+  }
+  return *fenc == NUL || (strncmp(fenc, "utf-8", 5) == 0 && (fenc[5] == ',' || fenc[5] == NUL));
+}
+
+/// Read file "vf" and find the lines that may match with "rf", using "line"
+/// of "line_size" bytes to copy a line into.  When the file can't be searched
+/// as it is "vf->read" is left false.
+static void vgr_read_file(vgr_file_T *vf, regfilter_T *rf, char **line, size_t *line_size)
+{
+  int fd = os_open(vf->fname, O_RDONLY, 0);
+  if (fd < 0) {
+    return;
+  }
+  // Read a copy of the text, a file that is changed or truncated meanwhile
+  // then only gives a short read.
+  FileInfo file_info;
+  char *text = NULL;
+  size_t size = 0;
+  if (os_fileinfo_fd(fd, &file_info) && S_ISREG(file_info.stat.st_mode)
+      && os_fileinfo_size(&file_info) > 0 && os_fileinfo_size(&file_info) < SIZE_MAX) {
+    size = (size_t)os_fileinfo_size(&file_info);
+    text = try_malloc(size);
+    bool eof;
+    if (text != NULL && os_read(fd, &eof, text, size, false) != (ptrdiff_t)size) {
+      XFREE_CLEAR(text);
+    }
+  }
+  os_close(fd);
+  if (text == NULL) {
+    return;
+  }
+  // What reading the file into a buffer would change.
+  if ((size >= 3 && memcmp(text, "\xef\xbb\xbf", 3) == 0)
+      || memchr(text, NUL, size) != NULL || memchr(text, CAR, size) != NULL
+      || utf_valid_len(text, size) < size) {
+    xfree(text);
+    return;
+  }
+
+  const char *p = text;
+  const char *const end = text + size;
+  for (linenr_T lnum = 1; p < end; lnum++) {
+    const char *nl = memchr(p, NL, (size_t)(end - p));
+    const size_t len = (size_t)((nl == NULL ? end : nl) - p);
+    if (len >= MAXCOL || lnum >= MAXLNUM) {
+      kv_destroy(vf->lines);
+      xfree(text);
+      return;
+    }
+    bool may_match = true;
+    if (rf != NULL) {
+      if (len >= *line_size) {
+        *line_size = MAX(len + 1, *line_size * 2);
+        xfree(*line);
+        *line = xmalloc(*line_size);
+      }
+      memcpy(*line, p, len);
+      (*line)[len] = NUL;
+      may_match = vim_regfilter_line(rf, *line, (colnr_T)len);
+    }
+    if (may_match) {
+      kv_push(vf->lines, ((vgr_line_T){ .lnum = lnum, .len = (colnr_T)len,
+                                        .off = (size_t)(p - text) }));
+    }
+    p += len + 1;
+  }
+  vf->read = true;
+  if (kv_size(vf->lines) > 0) {
+    vf->text = text;
+  } else {
+    xfree(text);
+  }
+}
+
+/// Read the files of "arg", a vgr_part_T.
+static void vgr_read_part(void *arg)
+{
+  vgr_part_T *part = arg;
+  char *line = NULL;
+  size_t line_size = 0;
+  for (int i = part->first; i < part->count; i += part->step) {
+    if (part->files[i].try_read) {
+      vgr_read_file(&part->files[i], part->rf, &line, &line_size);
+    }
+  }
+  xfree(line);
+}
+
+/// Read the "count" files of :vimgrep from "files", those that can be
+/// searched without loading them into a buffer.  The files are split between
+/// worker threads, which only check lines with vim_regfilter_line(): the
+/// regexp engines keep their state in globals.  Lines that may match must
+/// still be checked with vgr_match_filelines(), in order.
+static void vgr_read_files(vgr_args_T *args, vgr_file_T *files, int count)
+{
+  if (!vgr_can_read(args)) {
+    return;
+  }
+  int nread = 0;
+  for (int i = 0; i < count; i++) {
+    vgr_file_T *vf = &files[i];
+    buf_T *buf = buflist_findname_exp(vf->fname);
+    // A loaded buffer is searched as it is, autocommands may change how a
+    // file is read.
+    vf->try_read = (buf == NULL || buf->b_ml.ml_mfp == NULL)
+                   && !has_autocmd(EVENT_BUFREADCMD, vf->fname, NULL)
+                   && !has_autocmd(EVENT_BUFREADPRE, vf->fname, NULL);
+    nread += vf->try_read;
+  }
+  int nparts = MIN(MIN(os_cpu_count(), VGR_READ_MAXPARTS), nread);
+  if (nparts == 0) {
+    return;
+  }
+
+  vgr_part_T *part = xcalloc((size_t)nparts, sizeof(vgr_part_T));
+  for (int i = 0; i < nparts; i++) {
+    part[i] = (vgr_part_T){
+      .files = files,
+      .first = i,
+      .count = count,
+      .step = nparts,
+      .rf = vim_regfilter_new(&args->regmatch, curbuf),
+    };
+  }
+
+  // Read the first part in this thread while the others are done by worker
+  // threads. When a thread can't be created its part is read here too.
+  bool *started = xcalloc((size_t)nparts, sizeof(bool));
+  for (int i = 1; i < nparts; i++) {
+    started[i] = uv_thread_create(&part[i].thread, vgr_read_part, &part[i]) == 0;
+  }
+  vgr_read_part(&part[0]);
+  for (int i = 1; i < nparts; i++) {
+    if (started[i]) {
+      uv_thread_join(&part[i].thread);
+    } else {
+      vgr_read_part(&part[i]);
+    }
+  }
+  xfree(started);
+
+  for (int i = 0; i < nparts; i++) {
+    vim_regfilter_free(part[i].rf);
+  }
+  xfree(part);
+}
+
+/// Free what vgr_read_files() read for file "vf".
+static void vgr_file_clear(vgr_file_T *vf)
+{
+  xfree(vf->text);
+  kv_destroy(vf->lines);
+  *vf = (vgr_file_T){ 0 };
+}
+
+/// Search for a pattern in the lines of file "vf" read by vgr_read_files()
+/// and add the matching lines to a quickfix list, like vgr_match_buflines().
+static bool vgr_match_filelines(qf_list_T *qfl, char *fname, vgr_file_T *vf,
+                                regmmatch_T *regmatch, int *tomatch, int flags)
+  FUNC_ATTR_NONNULL_ALL
+{
+  bool found_match = false;
+  regmatch_T rm = { .regprog = regmatch->regprog, .rm_ic = regmatch->rmm_ic };
+  char *line = NULL;
+
+  for (size_t i = 0; i < kv_size(vf->lines) && *tomatch > 0; i++) {
+    const vgr_line_T *l = &kv_A(vf->lines, i);
+    xfree(line);
+    line = xmemdupz(vf->text + l->off, (size_t)l->len);
+    colnr_T col = 0;
+    while (vim_regexec(&rm, line, col)) {
+      // Use the file name, the buffer is made when the entry is added.
+      if (qf_add_entry(qfl,
+                       NULL,   // dir
+                       fname,
+                       NULL,
+                       0,
+                       line,
+                       l->lnum,
+                       l->lnum,
+                       (int)(rm.startp[0] - line) + 1,
+                       (int)(rm.endp[0] - line) + 1,
+                       false,  // vis_col
+                       NULL,   // search pattern
+                       0,      // nr
+                       0,      // type
+                       NULL,   // user_data
+                       true)   // valid
+          == QF_FAIL) {
+        got_int = true;
+        break;
+      }
+      found_match = true;
+      if (--*tomatch == 0) {
+        break;
+      }
+      if ((flags & VGR_GLOBAL) == 0) {
+        break;
+      }
+      const colnr_T endcol = (colnr_T)(rm.endp[0] - line);
+      col = endcol + (col == endcol);
+      if (col > l->len) {
+        break;
+      }
+    }
+    line_breakcheck();
+    if (got_int) {
+      break;
+    }
+  }
+
+  // The engine may have been changed.
+  regmatch->regprog = rm.regprog;
+  xfree(line);
+  return found_match;
+}
+
 /// Jump to the first match and update the directory.
 static void vgr_jump_to_match(qf_info_T *qi, int forceit, bool *redraw_for_dummy,
                               buf_T *first_match_buf, char *target_dir)  // NOLINT(readability-non-const-parameter)
@@ -5675,6 +5938,12 @@ static int vgr_process_files(win_T *wp, qf_info_T *qi, vgr_args_T *cmd_args, boo
   // ":lcd %:p:h" changes the meaning of short path names.
   os_dirname(dirname_start, MAXPATHL);
 
+  // Files are read ahead in batches, while the files of a batch are searched
+  // in order.
+  vgr_file_T *files = xcalloc(VGR_READ_BATCH, sizeof(vgr_file_T));
+  int batch_first = 0;
+  int batch_count = 0;
+
   time_t seconds = 0;
   for (int fi = 0; fi < cmd_args->fcount && !got_int && cmd_args->tomatch > 0; fi++) {
     char *fname = path_try_shorten_fname(cmd_args->fnames[fi]);
@@ -5685,7 +5954,32 @@ static int vgr_process_files(win_T *wp, qf_info_T *qi, vgr_args_T *cmd_args, boo
       vgr_display_fname(fname);
     }
 
+    if (fi >= batch_first + batch_count) {
+      batch_first = fi;
+      batch_count = MIN(VGR_READ_BATCH, cmd_args->fcount - fi);
+      for (int i = 0; i < batch_count; i++) {
+        files[i].fname = cmd_args->fnames[fi + i];
+      }
+      vgr_read_files(cmd_args, files, batch_count);
+    }
+    vgr_file_T *vf = &files[fi - batch_first];
+
     buf_T *buf = buflist_findname_exp(cmd_args->fnames[fi]);
+    if (vf->read && (buf == NULL || buf->b_ml.ml_mfp == NULL)) {
+      // Search the text of the file without loading it into a buffer.
+      vgr_match_filelines(qf_get_curlist(qi), fname, vf, &cmd_args->regmatch,
+                          &cmd_args->tomatch, cmd_args->flags);
+      vgr_file_clear(vf);
+      // Adding an entry makes a buffer, autocommands might have changed the
+      // quickfix list.
+      if (!vgr_qflist_valid(wp, qi, save_qfid, cmd_args->qf_title)) {
+        goto theend;
+      }
+      save_qfid = qf_get_curlist(qi)->qf_id;
+      continue;
+    }
+    vgr_file_clear(vf);
+
     bool using_dummy;
     if (buf == NULL || buf->b_ml.ml_mfp == NULL) {
       // Remember that a buffer with this name already exists.
@@ -5783,6 +6077,10 @@ static int vgr_process_files(win_T *wp, qf_info_T *qi, vgr_args_T *cmd_args, boo
   status = OK;
 
 theend:
+  for (int i = 0; i < batch_count; i++) {
+    vgr_file_clear(&files[i]);
+  }
+  xfree(files);
   xfree(dirname_now);
   xfree(dirname_start);
   return status;
@@ -63,6 +63,15 @@ enum {
   /// In the NFA engine: how many states are allowed.
   NFA_MAX_STATES = 100000,
   NFA_TOO_EXPENSIVE = -1,
+  /// Longest literal kept in "re_must" for skipping lines.
+  RE_MUST_MAX = 16,
+  /// Number of patterns kept by vim_regcomp_cached().
+  REGCACHE_SIZE = 32,
+  /// Levels of nfa_regmatch() recursion that keep their state lists in the
+  /// program.
+  NFA_LISTS_DEPTH = 4,
+  /// Most bytes of state lists kept in a program for one level.
+  NFA_LISTS_KEEP_MAX = 256 * 1024,
 };
 
 /// Which regexp engine to use? Needed for vim_regcomp().
@@ -71,6 +80,7 @@ enum {
   AUTOMATIC_ENGINE    = 0,
   BACKTRACKING_ENGINE = 1,
   NFA_ENGINE          = 2,
+  DFA_ENGINE          = 3,
 };
 
 /// Structure returned by vim_regcomp() to pass on to vim_regexec().
@@ -82,18 +92,24 @@ struct regprog {
   unsigned re_engine;  ///< Automatic, backtracking or NFA engine.
   unsigned re_flags;   ///< Second argument for vim_regcomp().
   bool re_in_use;      ///< prog is being executed
+  int re_refcount;     ///< references when in the cache, see vim_regcomp_cached()
+  uint8_t re_mustlen;  ///< length of "re_must", zero when there is none
+  char re_must[RE_MUST_MAX];  ///< ASCII text that every match contains
 };
 
 /// Structure used by the back track matcher.
 /// These fields are only to be used in regexp.c!
 /// See regexp.c for an explanation.
 typedef struct {
-  // These four members implement regprog_T.
+  // These members implement regprog_T.
   regengine_T *engine;
   unsigned regflags;
   unsigned re_engine;
   unsigned re_flags;
   bool re_in_use;
+  int re_refcount;
+  uint8_t re_mustlen;
+  char re_must[RE_MUST_MAX];
 
   int regstart;
   uint8_t reganch;
@@ -115,14 +131,84 @@ struct nfa_state {
   int val;
 };
 
+/// State of the lazy DFA: the NFA states reached by the text so far, before
+/// following empty transitions, and the class of the previous character.
+typedef struct dfa_state dfa_state_T;
+struct dfa_state {
+  dfa_state_T *next[128];  ///< state after each ASCII character, NULL if not computed yet
+  dfa_state_T *hnext;      ///< next state in the same hash bucket
+  int prev_class;          ///< class of the previous character, -1 at the start of the line
+  int nkernel;             ///< number of items in "kernel"
+  int kernel[];            ///< sorted indexes in nfa_regprog_T.state[]
+};
+
+/// DFA built while matching an NFA program, see dfa_regexec_multi().
+typedef struct {
+  dfa_state_T *init[4];    ///< start states, by "prev_class" + 1
+  dfa_state_T **hash;      ///< DFA_HASH_SIZE buckets
+  int nstates;             ///< number of states in "hash"
+  int nflush;              ///< number of times the states were dropped
+  bool failed;             ///< too many states, only use the NFA
+  bool ic;                 ///< ignoring case for the computed states
+  uint64_t chartab[4];     ///< 'iskeyword' for the computed states
+  // Scratch space for computing a transition.
+  int gen;                 ///< generation for "seen" and "kseen"
+  int *seen;               ///< NFA state was visited in generation
+  int *kseen;              ///< NFA state was added to "kernel" in generation
+  int *stack;
+  int *kernel;
+} dfa_T;
+
+/// Aho-Corasick automaton for a pattern that is an alternation of words, see
+/// nfa_get_ac().  It runs on the UTF-8 bytes of the case folded text.
+typedef struct {
+  int nstates;
+  int nclasses;            ///< number of byte classes, class 0 is for bytes in no word
+  uint8_t byte_class[256];  ///< class of each byte
+  int *next;               ///< next state, by state * "nclasses" + byte class
+  int *out;                ///< first word ending in a state, -1 for none
+  int *out_link;           ///< longest suffix state where a word ends, -1 for none
+  int *word_next;          ///< next word ending in the same state, -1 for none
+  int *word_start;         ///< index in "chars" of the first character of a word
+  int *word_len;           ///< number of characters in a word
+  int *chars;              ///< characters of the words as in the pattern
+  int maxlen;              ///< most characters in a word
+  bool bow;                ///< pattern starts with "\<"
+  bool eow;                ///< pattern ends with "\>"
+  int nsub;                ///< 1 when the words are inside "\(\)", otherwise 0
+} ac_T;
+
+/// Check of lines for a regexp that can be used by any thread, see
+/// vim_regfilter_new().
+struct regfilter {
+  regprog_T *prog;
+  buf_T *buf;              ///< buffer for 'iskeyword'
+  bool ic;                 ///< ignoring case
+  dfa_T *dfa;              ///< own DFA, NULL when "prog" is not run with the DFA
+  const ac_T *ac;          ///< automaton of "prog", NULL when it has none
+  uint64_t chartab[4];     ///< 'iskeyword' for "ac"
+};
+
+/// State lists of nfa_regmatch(), kept in the program so that the next match
+/// doesn't need to allocate them again.
+typedef struct {
+  struct nfa_thread_S *t[2];  ///< list[0].t and list[1].t, NULL if not kept
+  int len[2];                 ///< allocated number of states in "t"
+  int *listids;               ///< for recursive_regmatch()
+  int listids_len;            ///< allocated length of "listids"
+} nfa_lists_T;
+
 /// Structure used by the NFA matcher.
 typedef struct {
-  // These four members implement regprog_T.
+  // These members implement regprog_T.
   regengine_T *engine;
   unsigned regflags;
   unsigned re_engine;
   unsigned re_flags;
   bool re_in_use;
+  int re_refcount;
+  uint8_t re_mustlen;
+  char re_must[RE_MUST_MAX];
 
   nfa_state_T *start;   ///< points into state[]
 
@@ -135,6 +221,10 @@ typedef struct {
   int reghasz;
   char *pattern;
   int nsubexp;          ///< number of ()
+  dfa_T *dfa;           ///< used by the DFA engine, allocated when first matching
+  ac_T *ac;             ///< when the pattern is an alternation of words
+  nfa_lists_T lists[NFA_LISTS_DEPTH];  ///< by nfa_regmatch() recursion depth
+  int lists_depth;      ///< current nfa_regmatch() recursion depth
   int nstate;
   nfa_state_T state[];
 } nfa_regprog_T;
@@ -265,7 +355,7 @@ struct nfa_pim_S {
 };
 
 // nfa_thread_T contains execution information of a NFA state
-typedef struct {
+typedef struct nfa_thread_S {
   nfa_state_T *state;
   int count;
   nfa_pim_T pim;                // if pim.result != NFA_PIM_UNUSED: postponed
@@ -575,6 +665,7 @@ static void init_class_tab(void)
 #define RF_HASNL    4   // can match a NL
 #define RF_ICOMBINE 8   // ignore combining characters
 #define RF_LOOKBH   16  // uses "\@<=" or "\@<!"
+#define RF_CONTEXT  32  // uses the cursor, Visual area, marks or line/column
 
 // Global work variables for vim_regcomp().
 
@@ -642,8 +733,35 @@ typedef struct {
   int regnpar;
 } parse_state_T;
 
+/// What is known about the text matched by a part of the postfix form, used
+/// to find text that every match contains.  Only ASCII characters are used.
+typedef struct {
+  bool exact;                 ///< "left" is all of the matched text
+  uint8_t llen;
+  uint8_t rlen;
+  uint8_t ilen;
+  char left[RE_MUST_MAX];     ///< every match starts with this
+  char right[RE_MUST_MAX];    ///< every match ends with this
+  char in[RE_MUST_MAX];       ///< every match contains this
+} nfa_must_T;
+
+/// Compiled pattern kept by vim_regcomp_cached().
+typedef struct {
+  char *pat;
+  size_t len;
+  int re_flags;
+  int engine;        ///< 'regexpengine' when compiled
+  bool cpo_lit;      ///< 'cpoptions' contained 'l' when compiled
+  regprog_T *prog;   ///< NULL when the entry is unused
+  uint64_t used;     ///< "regcache_tick" when last used
+} regcache_T;
+
+static regcache_T regcache[REGCACHE_SIZE];
+static uint64_t regcache_tick = 0;
+
 static regengine_T bt_regengine;
 static regengine_T nfa_regengine;
+static regengine_T dfa_regengine;
 
 #include "regexp.c.generated.h"
 
@@ -654,6 +772,80 @@ int re_multiline(const regprog_T *prog)
   return prog->regflags & RF_HASNL;
 }
 
+/// Check if where "prog" matches only depends on the text of the line, not on
+/// other lines, the cursor, marks or the line number.
+bool re_line_local(const regprog_T *prog)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return !(prog->regflags & (RF_HASNL | RF_LOOKBH | RF_CONTEXT));
+}
+
+/// Check if where "prog" matches depends on the cursor, the Visual area, marks
+/// or the line number, not only on the text.
+bool re_uses_context(const regprog_T *prog)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return prog->regflags & RF_CONTEXT;
+}
+
+/// Get whether matching "prog" ignores case, "ic" unless the pattern contains
+/// "\c" or "\C".
+static bool regprog_ic(const regprog_T *prog, bool ic)
+{
+  if (prog->regflags & RF_ICASE) {
+    return true;
+  } else if (prog->regflags & RF_NOICASE) {
+    return false;
+  }
+  return ic;
+}
+
+/// Offer "len" bytes at "p", which every match of "prog" contains, for
+/// "re_must".  Only the longest run of ASCII characters is used: other text
+/// can match differently encoded text when ignoring case or composing
+/// characters.
+static void re_must_add(regprog_T *prog, const char *p, size_t len)
+{
+  size_t i = 0;
+  while (i < len) {
+    size_t start = i;
+    while (i < len && (uint8_t)p[i] < 0x80 && p[i] != NUL && p[i] != NL) {
+      i++;
+    }
+    size_t n = MIN(i - start, RE_MUST_MAX);
+    if (n > prog->re_mustlen) {
+      memcpy(prog->re_must, p + start, n);
+      prog->re_mustlen = (uint8_t)n;
+    }
+    i++;
+  }
+}
+
+/// Check if line "lnum" of "buf" cannot contain a match for "rmp" because the
+/// text in "re_must" is missing.  Quicker than running either engine, which
+/// helps a lot when searching a big buffer for something rare.
+static bool re_must_skip_line(regmmatch_T *rmp, buf_T *buf, linenr_T lnum)
+{
+  regprog_T *prog = rmp->regprog;
+  if (prog->re_mustlen == 0 || lnum < 1 || lnum > buf->b_ml.ml_line_count) {
+    return false;
+  }
+  return re_must_missing(prog, regprog_ic(prog, rmp->rmm_ic), ml_get_buf(buf, lnum),
+                         (size_t)ml_get_buf_len(buf, lnum));
+}
+
+/// Check if "len" bytes at "line" cannot contain a match for "prog" because
+/// the text in "re_must" is missing.  "prog" must have "re_must".
+static bool re_must_missing(const regprog_T *prog, bool ic, const char *line, size_t len)
+{
+  if (xmemfind(line, len, prog->re_must, prog->re_mustlen, ic) != NULL) {
+    return false;
+  }
+  // Text with multibyte characters may still match: composing characters
+  // and some characters that fold to ASCII letters.
+  return xmemisascii(line, len);
+}
+
 // Check for an equivalence class name "[=a=]".  "pp" points to the '['.
 // Returns a character representing the class. Zero means that no item was
 // recognized.  Otherwise "pp" is advanced to after the item.
@@ -1521,7 +1713,7 @@ static int prog_magic_wrong(void)
   regprog_T *prog;
 
   prog = REG_MULTI ? rex.reg_mmatch->regprog : rex.reg_match->regprog;
-  if (prog->engine == &nfa_regengine) {
+  if (prog->engine == &nfa_regengine || prog->engine == &dfa_regengine) {
     // For NFA matcher we don't check the magic
     return false;
   }
@@ -4497,10 +4689,12 @@ static uint8_t *regatom(int *flagp)
     // pattern -- regardless of whether or not it makes sense.
     case '^':
       ret = regnode(RE_BOF);
+      regflags |= RF_CONTEXT;
       break;
 
     case '$':
       ret = regnode(RE_EOF);
+      regflags |= RF_CONTEXT;
       break;
 
     case '#':
@@ -4510,10 +4704,12 @@ static uint8_t *regatom(int *flagp)
         return FAIL;
       }
       ret = regnode(CURSOR);
+      regflags |= RF_CONTEXT;
       break;
 
     case 'V':
       ret = regnode(RE_VISUAL);
+      regflags |= RF_CONTEXT;
       break;
 
     case 'C':
@@ -4631,6 +4827,7 @@ static uint8_t *regatom(int *flagp)
         bool cur = false;
         bool got_digit = false;
 
+        regflags |= RF_CONTEXT;
         cmp = c;
         if (cmp == '<' || cmp == '>') {
           c = getchr();
@@ -5449,6 +5646,7 @@ static regprog_T *bt_regcomp(uint8_t *expr, int re_flags)
   // Allocate space.
   bt_regprog_T *r = xmalloc(offsetof(bt_regprog_T, program) + (size_t)regsize);
   r->re_in_use = false;
+  r->re_refcount = 0;
 
   // Second pass: emit code.
   regcomp_start(expr, re_flags);
@@ -5467,6 +5665,7 @@ static regprog_T *bt_regcomp(uint8_t *expr, int re_flags)
   r->reganch = 0;
   r->regmust = NULL;
   r->regmlen = 0;
+  r->re_mustlen = 0;
   r->regflags = regflags;
   if (flags & HASNL) {
     r->regflags |= RF_HASNL;
@@ -5524,6 +5723,15 @@ static regprog_T *bt_regcomp(uint8_t *expr, int re_flags)
       r->regmust = longest;
       r->regmlen = len;
     }
+
+    // Text that every match contains, to skip lines without it.
+    if (!(flags & HASNL) && !(regflags & RF_ICOMBINE)) {
+      for (scan = OPERAND(&r->program[1]); scan != NULL; scan = regnext(scan)) {
+        if (OP(scan) == EXACTLY) {
+          re_must_add((regprog_T *)r, (char *)OPERAND(scan), strlen((char *)OPERAND(scan)));
+        }
+      }
+    }
   }
 #ifdef BT_REGEXP_DUMP
   regdump(expr, r);
@@ -8749,6 +8957,224 @@ static uint8_t *nfa_get_match_text(nfa_state_T *start)
   return ret;
 }
 
+/// Put "a" followed by "b" in "dst", keeping the start or, with "keep_end",
+/// the end when it is too long.
+static uint8_t nfa_must_join(char *dst, const char *a, size_t alen, const char *b, size_t blen,
+                             bool keep_end)
+{
+  char buf[2 * RE_MUST_MAX];
+  memcpy(buf, a, alen);
+  memcpy(buf + alen, b, blen);
+  size_t len = MIN(alen + blen, RE_MUST_MAX);
+  memmove(dst, keep_end ? buf + alen + blen - len : buf, len);
+  return (uint8_t)len;
+}
+
+/// Concatenate "b" to "a": what is known about the text matched by "a"
+/// followed by "b".
+static void nfa_must_concat(nfa_must_T *a, const nfa_must_T *b)
+{
+  if (a->exact && b->exact && a->llen + b->llen <= RE_MUST_MAX) {
+    a->llen = nfa_must_join(a->left, a->left, a->llen, b->left, b->llen, false);
+    memcpy(a->right, a->left, a->llen);
+    memcpy(a->in, a->left, a->llen);
+    a->rlen = a->ilen = a->llen;
+    return;
+  }
+  char mid[RE_MUST_MAX];
+  uint8_t midlen = nfa_must_join(mid, a->right, a->rlen, b->left, b->llen, false);
+  if (a->exact) {
+    a->llen = nfa_must_join(a->left, a->left, a->llen, b->left, b->llen, false);
+  }
+  if (b->exact) {
+    a->rlen = nfa_must_join(a->right, a->right, a->rlen, b->right, b->rlen, true);
+  } else {
+    memcpy(a->right, b->right, b->rlen);
+    a->rlen = b->rlen;
+  }
+  a->exact = false;
+  // "in" is the longest of what is known.
+  if (b->ilen > a->ilen) {
+    memcpy(a->in, b->in, b->ilen);
+    a->ilen = b->ilen;
+  }
+  if (midlen > a->ilen) {
+    memcpy(a->in, mid, midlen);
+    a->ilen = midlen;
+  }
+  if (a->llen > a->ilen) {
+    memcpy(a->in, a->left, a->llen);
+    a->ilen = a->llen;
+  }
+  if (a->rlen > a->ilen) {
+    memcpy(a->in, a->right, a->rlen);
+    a->ilen = a->rlen;
+  }
+}
+
+/// Find text that every match of the postfix form "postfix" to "end" contains
+/// and store it in "re_must" of "prog".  Anything that is not a plain ASCII
+/// character, an item without width or a concatenation of them is taken to
+/// match unknown text.
+static void nfa_get_must(regprog_T *prog, int *postfix, int *end)
+{
+  static const nfa_must_T unknown = { .exact = false };
+  static const nfa_must_T empty = { .exact = true };
+  nfa_must_T *stack = xmalloc(sizeof(*stack) * (size_t)(end - postfix + 1));
+  int sp = 0;
+  bool in_coll = false;
+
+  prog->re_mustlen = 0;
+  if (prog->regflags & (RF_HASNL | RF_ICOMBINE)) {
+    goto theend;
+  }
+
+  for (int *p = postfix; p < end; p++) {
+    switch (*p) {
+    case NFA_CONCAT:
+      if (sp < 2) {
+        goto theend;
+      }
+      sp--;
+      nfa_must_concat(&stack[sp - 1], &stack[sp]);
+      break;
+
+    case NFA_OR:
+    case NFA_RANGE:
+      if (sp < 2) {
+        goto theend;
+      }
+      sp--;
+      stack[sp - 1] = unknown;
+      break;
+
+    case NFA_END_COLL:
+    case NFA_END_NEG_COLL:
+      in_coll = false;
+      FALLTHROUGH;
+    case NFA_STAR:
+    case NFA_STAR_NONGREEDY:
+    case NFA_QUEST:
+    case NFA_QUEST_NONGREEDY:
+    case NFA_PREV_ATOM_LIKE_PATTERN:
+      if (sp < 1) {
+        goto theend;
+      }
+      stack[sp - 1] = unknown;
+      break;
+
+    case NFA_PREV_ATOM_JUST_BEFORE:
+    case NFA_PREV_ATOM_JUST_BEFORE_NEG:
+      p++;  // skip the count
+      FALLTHROUGH;
+    case NFA_PREV_ATOM_NO_WIDTH:
+    case NFA_PREV_ATOM_NO_WIDTH_NEG:
+      if (sp < 1) {
+        goto theend;
+      }
+      stack[sp - 1] = empty;
+      break;
+
+    case NFA_OPT_CHARS: {
+      int n = *++p;
+      if (sp < n || n < 1) {
+        goto theend;
+      }
+      sp -= n - 1;
+      stack[sp - 1] = unknown;
+      break;
+    }
+
+    case NFA_COMPOSING:
+      if (sp == 0) {
+        stack[sp++] = unknown;
+      } else {
+        stack[sp - 1] = unknown;
+      }
+      break;
+
+    case NFA_MOPEN:
+    case NFA_MOPEN1:
+    case NFA_MOPEN2:
+    case NFA_MOPEN3:
+    case NFA_MOPEN4:
+    case NFA_MOPEN5:
+    case NFA_MOPEN6:
+    case NFA_MOPEN7:
+    case NFA_MOPEN8:
+    case NFA_MOPEN9:
+    case NFA_ZOPEN:
+    case NFA_ZOPEN1:
+    case NFA_ZOPEN2:
+    case NFA_ZOPEN3:
+    case NFA_ZOPEN4:
+    case NFA_ZOPEN5:
+    case NFA_ZOPEN6:
+    case NFA_ZOPEN7:
+    case NFA_ZOPEN8:
+    case NFA_ZOPEN9:
+    case NFA_NOPEN:
+      // The group matches what is inside, or nothing when it is empty.
+      if (sp == 0) {
+        stack[sp++] = empty;
+      }
+      break;
+
+    case NFA_LNUM:
+    case NFA_LNUM_GT:
+    case NFA_LNUM_LT:
+    case NFA_VCOL:
+    case NFA_VCOL_GT:
+    case NFA_VCOL_LT:
+    case NFA_COL:
+    case NFA_COL_GT:
+    case NFA_COL_LT:
+    case NFA_MARK:
+    case NFA_MARK_GT:
+    case NFA_MARK_LT:
+      p++;  // skip the lnum, col or mark name
+      FALLTHROUGH;
+    case NFA_BOL:
+    case NFA_EOL:
+    case NFA_BOW:
+    case NFA_EOW:
+    case NFA_BOF:
+    case NFA_EOF:
+    case NFA_ZSTART:
+    case NFA_ZEND:
+    case NFA_EMPTY:
+    case NFA_CURSOR:
+    case NFA_VISUAL:
+      stack[sp++] = empty;
+      break;
+
+    case NFA_START_COLL:
+    case NFA_START_NEG_COLL:
+      in_coll = true;
+      stack[sp++] = unknown;
+      break;
+
+    default:
+      if (!in_coll && *p > 0 && *p < 0x80 && *p != NL) {
+        nfa_must_T *m = &stack[sp++];
+        m->exact = true;
+        m->left[0] = m->right[0] = m->in[0] = (char)(*p);
+        m->llen = m->rlen = m->ilen = 1;
+      } else {
+        stack[sp++] = unknown;
+      }
+      break;
+    }
+  }
+
+  if (sp == 1) {
+    re_must_add(prog, stack[0].in, stack[0].ilen);
+  }
+
+theend:
+  xfree(stack);
+}
+
 // Allocate more space for post_start.  Called when
 // running above the estimated number of states.
 static void realloc_post_list(void)
@@ -10267,10 +10693,12 @@ static int nfa_regatom(void)
     // pattern -- regardless of whether or not it makes sense.
     case '^':
       EMIT(NFA_BOF);
+      regflags |= RF_CONTEXT;
       break;
 
     case '$':
       EMIT(NFA_EOF);
+      regflags |= RF_CONTEXT;
       break;
 
     case '#':
@@ -10281,10 +10709,12 @@ static int nfa_regatom(void)
         return FAIL;
       }
       EMIT(NFA_CURSOR);
+      regflags |= RF_CONTEXT;
       break;
 
     case 'V':
       EMIT(NFA_VISUAL);
+      regflags |= RF_CONTEXT;
       break;
 
     case 'C':
@@ -10329,6 +10759,7 @@ static int nfa_regatom(void)
       bool cur = false;
       bool got_digit = false;
 
+      regflags |= RF_CONTEXT;
       if (c == '<' || c == '>') {
         c = getchr();
       }
@@ -10428,6 +10859,7 @@ collection:
           EMIT(result - NFA_ADD_NL);
           EMIT(NFA_NEWL);
           EMIT(NFA_OR);
+          regflags |= RF_HASNL;
         } else {
           EMIT(result);
         }
@@ -10708,6 +11140,7 @@ collection:
       if (extra == NFA_ADD_NL) {
         EMIT(reg_string ? NL : NFA_NEWL);
         EMIT(NFA_OR);
+        regflags |= RF_HASNL;
       }
 
       return OK;
@@ -14139,12 +14572,26 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 #endif
   nfa_match = false;
 
-  // Allocate memory for the lists of nodes.
-  size_t size = (size_t)(prog->nstate + 1) * sizeof(nfa_thread_T);
-  list[0].t = xmalloc(size);
-  list[0].len = prog->nstate + 1;
-  list[1].t = xmalloc(size);
-  list[1].len = prog->nstate + 1;
+  // Use the lists of nodes kept in the program for this recursion depth, or
+  // allocate memory for them.
+  nfa_lists_T *const kept = prog->lists_depth < NFA_LISTS_DEPTH
+                            ? &prog->lists[prog->lists_depth] : NULL;
+  prog->lists_depth++;
+  for (int i = 0; i < 2; i++) {
+    if (kept != NULL && kept->t[i] != NULL) {
+      list[i].t = kept->t[i];
+      list[i].len = kept->len[i];
+      kept->t[i] = NULL;
+    } else {
+      list[i].t = xmalloc((size_t)(prog->nstate + 1) * sizeof(nfa_thread_T));
+      list[i].len = prog->nstate + 1;
+    }
+  }
+  if (kept != NULL) {
+    listids = kept->listids;
+    listids_len = kept->listids_len;
+    kept->listids = NULL;
+  }
 
 #ifdef REGEXP_DEBUG
   log_fd = fopen(NFA_REGEXP_RUN_LOG, "a");
@@ -15496,10 +15943,23 @@ nextchar:
 #endif
 
 theend:
-  // Free memory
-  xfree(list[0].t);
-  xfree(list[1].t);
-  xfree(listids);
+  // Keep the lists for the next match, unless they grew big.
+  prog->lists_depth--;
+  for (int i = 0; i < 2; i++) {
+    if (kept != NULL
+        && (size_t)list[i].len * sizeof(nfa_thread_T) <= NFA_LISTS_KEEP_MAX) {
+      kept->t[i] = list[i].t;
+      kept->len[i] = list[i].len;
+    } else {
+      xfree(list[i].t);
+    }
+  }
+  if (kept != NULL) {
+    kept->listids = listids;
+    kept->listids_len = listids_len;
+  } else {
+    xfree(listids);
+  }
 #undef ADD_STATE_IF_MATCH
 #ifdef NFA_REGEXP_DEBUG_LOG
   fclose(debug);
@@ -15631,6 +16091,33 @@ static int nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *tim
   return 1 + rex.lnum;
 }
 
+/// Set the submatches for a match of the words of "prog->ac" from "col" to
+/// "endcol" in the current line.
+///
+/// @return  the number of lines in the match, like nfa_regtry().
+static int ac_regtry(nfa_regprog_T *prog, colnr_T col, colnr_T endcol)
+{
+  cleanup_subexpr();
+  for (int i = 0; i <= prog->ac->nsub; i++) {
+    if (REG_MULTI) {
+      rex.reg_startpos[i].lnum = 0;
+      rex.reg_startpos[i].col = col;
+      rex.reg_endpos[i].lnum = 0;
+      rex.reg_endpos[i].col = endcol;
+    } else {
+      rex.reg_startp[i] = rex.line + col;
+      rex.reg_endp[i] = rex.line + endcol;
+    }
+  }
+  if (REG_MULTI && rex.reg_mmatch != NULL) {
+    rex.reg_mmatch->rmm_matchcol = col;
+  }
+
+  unref_extmatch(re_extmatch_out);
+  re_extmatch_out = NULL;
+  return 1;
+}
+
 /// Match a regexp against a string ("line" points to the string) or multiple
 /// lines (if "line" is NULL, use reg_getline()).
 ///
@@ -15702,7 +16189,19 @@ static int nfa_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
     rex.need_clear_zsubexpr = false;
   }
 
-  if (prog->regstart != NUL) {
+  if (prog->ac != NULL) {
+    // An alternation of words: find the match with the automaton.  Only when
+    // the match may not go beyond "rex.reg_maxcol" let the NFA check it.
+    colnr_T endcol;
+    col = ac_find(prog->ac, line, col, rex.reg_ic, rex.reg_buf->b_chartab, &endcol);
+    if (col < 0) {
+      return 0L;
+    }
+    if (rex.reg_maxcol == 0) {
+      retval = ac_regtry(prog, col, endcol);
+      goto theend;
+    }
+  } else if (prog->regstart != NUL) {
     // Skip ahead until a character we know the match must start with.
     // When there is none there is no match.
     if (skip_to_start(prog->regstart, &col) == FAIL) {
@@ -15821,6 +16320,7 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   prog = xmalloc(prog_size);
   state_ptr = prog->state;
   prog->re_in_use = false;
+  prog->re_refcount = 0;
 
   // PASS 2
   // Build the NFA
@@ -15834,12 +16334,17 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   prog->has_zend = rex.nfa_has_zend;
   prog->has_backref = rex.nfa_has_backref;
   prog->nsubexp = regnpar;
+  prog->dfa = NULL;
+  memset(prog->lists, 0, sizeof(prog->lists));
+  prog->lists_depth = 0;
 
   nfa_postprocess(prog);
 
   prog->reganch = nfa_get_reganch(prog->start, 0);
   prog->regstart = nfa_get_regstart(prog->start, 0);
   prog->match_text = nfa_get_match_text(prog->start);
+  nfa_get_must((regprog_T *)prog, postfix, post_ptr);
+  prog->ac = nfa_get_ac(prog);
 
 #ifdef REGEXP_DEBUG
   nfa_postfix_dump(expr, OK);
@@ -15874,8 +16379,15 @@ static void nfa_regfree(regprog_T *prog)
     return;
   }
 
-  xfree(((nfa_regprog_T *)prog)->match_text);
-  xfree(((nfa_regprog_T *)prog)->pattern);
+  nfa_regprog_T *const nprog = (nfa_regprog_T *)prog;
+  for (int i = 0; i < NFA_LISTS_DEPTH; i++) {
+    xfree(nprog->lists[i].t[0]);
+    xfree(nprog->lists[i].t[1]);
+    xfree(nprog->lists[i].listids);
+  }
+  ac_free(nprog->ac);
+  xfree(nprog->match_text);
+  xfree(nprog->pattern);
   xfree(prog);
 }
 
@@ -15946,56 +16458,912 @@ static int nfa_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T
 }
 // }}}1
 
-static regengine_T bt_regengine = {
-  bt_regcomp,
-  bt_regfree,
-  bt_regexec_nl,
-  bt_regexec_multi,
-#ifdef REGEXP_DEBUG
-  "",
-#endif
-};
+// regexp_dfa.c {{{1
 
-static regengine_T nfa_regengine = {
-  nfa_regcomp,
-  nfa_regfree,
-  nfa_regexec_nl,
-  nfa_regexec_multi,
-#ifdef REGEXP_DEBUG
-  "",
-#endif
+// Lazy DFA for NFA programs.
+//
+// A DFA state stands for the set of NFA states that can be active at a
+// position.  It is computed from the previous one when a character is first
+// seen in that state and then cached, so that scanning a line takes one table
+// lookup per byte once the DFA has been built for the kind of text searched.
+// It only tells whether a line contains a match, the NFA engine is then used
+// to find where and to get the submatches.  Only patterns where each NFA state
+// depends on nothing but the current and previous character can be used:
+// without back references, look-around, positions like "\%V" and "\%23l", and
+// without items that depend on global options such as "\i".  Text with
+// multibyte characters goes straight to the NFA engine.
+
+enum {
+  DFA_HASH_SIZE = 256,  ///< number of hash buckets
+  DFA_MAX_STATES = 2000,  ///< states kept before dropping all of them
+  DFA_MAX_FLUSH = 5,  ///< times the states may be dropped before giving up
 };
 
-// Which regexp engine to use? Needed for vim_regcomp().
-// Must match with 'regexpengine'.
-static int regexp_engine = 0;
+/// "next" of a state when a match ends at that position.
+static dfa_state_T dfa_match_state;
+/// "next" of a state when the end of the line is reached without a match.
+static dfa_state_T dfa_nomatch_state;
 
-#ifdef REGEXP_DEBUG
-static uint8_t regname[][30] = {
-  "AUTOMATIC Regexp Engine",
-  "BACKTRACKING Regexp Engine",
-  "NFA Regexp Engine"
-};
-#endif
+/// Check if a state inside a collection can be used by the DFA.
+static bool dfa_coll_item_ok(int c)
+{
+  return c > 0 || c == NFA_RANGE_MIN || c == NFA_RANGE_MAX
+         || (c >= NFA_CLASS_ALNUM && c <= NFA_CLASS_FNAME
+             && c != NFA_CLASS_PRINT && c != NFA_CLASS_IDENT && c != NFA_CLASS_FNAME);
+}
 
-// Compile a regular expression into internal code.
-// Returns the program in allocated memory.
-// Use vim_regfree() to free the memory.
-// Returns NULL for an error.
-regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
+/// Check if the NFA program "prog" can be used with the DFA engine.
+static bool dfa_can_run(nfa_regprog_T *prog)
 {
-  regprog_T *prog = NULL;
-  const char *expr = expr_arg;
+  if (prog->regflags & (RF_HASNL | RF_ICOMBINE) || prog->has_backref) {
+    return false;
+  }
 
-  regexp_engine = (int)p_re;
+  bool *seen = xcalloc((size_t)prog->nstate, sizeof(bool));
+  nfa_state_T **stack = xmalloc(sizeof(*stack) * (size_t)(2 * prog->nstate + 1));
+  int sp = 0;
+  bool ok = true;
+  stack[sp++] = prog->start;
+  while (ok && sp > 0) {
+    nfa_state_T *state = stack[--sp];
+    if (state == NULL || seen[state - prog->state]) {
+      continue;
+    }
+    seen[state - prog->state] = true;
+    switch (state->c) {
+    case NFA_MATCH:
+      break;
 
-  // Check for prefix "\%#=", that sets the regexp engine
-  if (strncmp(expr, "\\%#=", 4) == 0) {
-    int newengine = expr[4] - '0';
+    case NFA_SPLIT:
+      stack[sp++] = state->out;
+      stack[sp++] = state->out1;
+      break;
+
+    case NFA_START_COLL:
+    case NFA_START_NEG_COLL:
+      for (nfa_state_T *item = state->out; item->c != NFA_END_COLL; item = item->out) {
+        if (!dfa_coll_item_ok(item->c)) {
+          ok = false;
+          break;
+        }
+      }
+      stack[sp++] = state->out1->out;
+      break;
+
+    case NFA_EMPTY:
+    case NFA_BOL:
+    case NFA_EOL:
+    case NFA_BOW:
+    case NFA_EOW:
+    case NFA_ZSTART:
+    case NFA_ZEND:
+    case NFA_NOPEN:
+    case NFA_NCLOSE:
+    case NFA_ANY:
+    case NFA_KWORD:
+    case NFA_SKWORD:
+    case NFA_WHITE:
+    case NFA_NWHITE:
+    case NFA_DIGIT:
+    case NFA_NDIGIT:
+    case NFA_HEX:
+    case NFA_NHEX:
+    case NFA_OCTAL:
+    case NFA_NOCTAL:
+    case NFA_WORD:
+    case NFA_NWORD:
+    case NFA_HEAD:
+    case NFA_NHEAD:
+    case NFA_ALPHA:
+    case NFA_NALPHA:
+    case NFA_LOWER:
+    case NFA_NLOWER:
+    case NFA_UPPER:
+    case NFA_NUPPER:
+    case NFA_LOWER_IC:
+    case NFA_NLOWER_IC:
+    case NFA_UPPER_IC:
+    case NFA_NUPPER_IC:
+      stack[sp++] = state->out;
+      break;
+
+    default:
+      if (state->c > 0
+          || (state->c >= NFA_MOPEN && state->c <= NFA_ZCLOSE9)) {
+        stack[sp++] = state->out;
+      } else {
+        ok = false;
+      }
+      break;
+    }
+  }
+
+  xfree(stack);
+  xfree(seen);
+  return ok;
+}
+
+/// Get the class of ASCII character "c" like mb_get_class_tab().
+static int dfa_char_class(int c, const uint64_t *chartab)
+{
+  if (c == NUL || ascii_iswhite(c)) {
+    return 0;
+  }
+  return vim_iswordc_tab(c, chartab) ? 2 : 1;
+}
+
+/// Check if NFA state "state", which consumes a character, matches ASCII
+/// character "c".  Must do the same as nfa_regmatch().
+static bool dfa_char_matches(const nfa_state_T *state, int c, bool ic, buf_T *buf)
+{
+  switch (state->c) {
+  case NFA_START_COLL:
+  case NFA_START_NEG_COLL: {
+    bool matched = false;
+    for (const nfa_state_T *item = state->out; item->c != NFA_END_COLL && !matched;
+         item = item->out) {
+      if (item->c == NFA_RANGE_MIN) {
+        int c1 = item->val;
+        item = item->out;  // advance to NFA_RANGE_MAX
+        int c2 = item->val;
+        matched = c >= c1 && c <= c2;
+        if (!matched && ic) {
+          int c_low = utf_fold(c);
+          for (; c1 <= c2 && !matched; c1++) {
+            matched = utf_fold(c1) == c_low;
+          }
+        }
+      } else if (item->c == NFA_CLASS_KEYWORD) {
+        matched = vim_iswordc_buf(c, buf);
+      } else if (item->c < 0) {
+        matched = check_char_class(item->c, c);
+      } else {
+        matched = c == item->c || (ic && utf_fold(c) == utf_fold(item->c));
+      }
+    }
+    return matched == (state->c == NFA_START_COLL);
+  }
+  case NFA_ANY:
+    return true;
+  case NFA_KWORD:
+    return vim_iswordc_buf(c, buf);
+  case NFA_SKWORD:
+    return !ascii_isdigit(c) && vim_iswordc_buf(c, buf);
+  case NFA_WHITE:
+    return ascii_iswhite(c);
+  case NFA_NWHITE:
+    return !ascii_iswhite(c);
+  case NFA_DIGIT:
+    return ri_digit(c);
+  case NFA_NDIGIT:
+    return !ri_digit(c);
+  case NFA_HEX:
+    return ri_hex(c);
+  case NFA_NHEX:
+    return !ri_hex(c);
+  case NFA_OCTAL:
+    return ri_octal(c);
+  case NFA_NOCTAL:
+    return !ri_octal(c);
+  case NFA_WORD:
+    return ri_word(c);
+  case NFA_NWORD:
+    return !ri_word(c);
+  case NFA_HEAD:
+    return ri_head(c);
+  case NFA_NHEAD:
+    return !ri_head(c);
+  case NFA_ALPHA:
+    return ri_alpha(c);
+  case NFA_NALPHA:
+    return !ri_alpha(c);
+  case NFA_LOWER:
+    return ri_lower(c);
+  case NFA_NLOWER:
+    return !ri_lower(c);
+  case NFA_UPPER:
+    return ri_upper(c);
+  case NFA_NUPPER:
+    return !ri_upper(c);
+  case NFA_LOWER_IC:
+    return ri_lower(c) || (ic && ri_upper(c));
+  case NFA_NLOWER_IC:
+    return !(ri_lower(c) || (ic && ri_upper(c)));
+  case NFA_UPPER_IC:
+    return ri_upper(c) || (ic && ri_lower(c));
+  case NFA_NUPPER_IC:
+    return !(ri_upper(c) || (ic && ri_lower(c)));
+  default:
+    return c == state->c || (ic && utf_fold(c) == utf_fold(state->c));
+  }
+}
+
+/// Drop all states of "dfa".
+static void dfa_clear(dfa_T *dfa)
+{
+  for (int i = 0; i < DFA_HASH_SIZE; i++) {
+    dfa_state_T *d = dfa->hash[i];
+    while (d != NULL) {
+      dfa_state_T *next = d->hnext;
+      xfree(d);
+      d = next;
+    }
+    dfa->hash[i] = NULL;
+  }
+  CLEAR_FIELD(dfa->init);
+  dfa->nstates = 0;
+}
+
+static void dfa_free(dfa_T *dfa)
+{
+  if (dfa == NULL) {
+    return;
+  }
+  dfa_clear(dfa);
+  xfree(dfa->hash);
+  xfree(dfa->seen);
+  xfree(dfa->kseen);
+  xfree(dfa->stack);
+  xfree(dfa->kernel);
+  xfree(dfa);
+}
+
+static dfa_T *dfa_new(nfa_regprog_T *prog)
+{
+  size_t n = (size_t)prog->nstate + 1;
+  dfa_T *dfa = xcalloc(1, sizeof(dfa_T));
+  dfa->hash = xcalloc(DFA_HASH_SIZE, sizeof(*dfa->hash));
+  dfa->seen = xcalloc(n, sizeof(int));
+  dfa->kseen = xcalloc(n, sizeof(int));
+  dfa->stack = xmalloc(3 * n * sizeof(int));
+  dfa->kernel = xmalloc(n * sizeof(int));
+  return dfa;
+}
+
+/// Find the DFA state for "kernel" and "prev_class", add it when missing.
+///
+/// @return  NULL when there are too many states.
+static dfa_state_T *dfa_find_state(dfa_T *dfa, const int *kernel, int nkernel, int prev_class)
+{
+  uint32_t hash = 2166136261U ^ (uint32_t)(prev_class + 1);
+  for (int i = 0; i < nkernel; i++) {
+    hash = (hash ^ (uint32_t)kernel[i]) * 16777619U;
+  }
+  dfa_state_T **bucket = &dfa->hash[hash % DFA_HASH_SIZE];
+  for (dfa_state_T *d = *bucket; d != NULL; d = d->hnext) {
+    if (d->prev_class == prev_class && d->nkernel == nkernel
+        && memcmp(d->kernel, kernel, (size_t)nkernel * sizeof(int)) == 0) {
+      return d;
+    }
+  }
+  if (dfa->nstates >= DFA_MAX_STATES) {
+    return NULL;
+  }
+  dfa_state_T *d = xmalloc(offsetof(dfa_state_T, kernel) + (size_t)nkernel * sizeof(int));
+  CLEAR_FIELD(d->next);
+  d->prev_class = prev_class;
+  d->nkernel = nkernel;
+  memcpy(d->kernel, kernel, (size_t)nkernel * sizeof(int));
+  d->hnext = *bucket;
+  *bucket = d;
+  dfa->nstates++;
+  return d;
+}
+
+static int dfa_int_cmp(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+/// Compute the DFA state after ASCII character "c" in state "d".  With "c"
+/// NUL at the end of the line.
+///
+/// @return  &dfa_match_state when a match ends before "c",
+///          &dfa_nomatch_state at the end of the line without a match,
+///          NULL when there are too many states.
+static dfa_state_T *dfa_step(nfa_regprog_T *prog, dfa_T *dfa, dfa_state_T *d, int c, buf_T *buf)
+{
+  const int cur_class = dfa_char_class(c, dfa->chartab);
+  int *stack = dfa->stack;
+  int sp = 0;
+  int nkernel = 0;
+  bool match = false;
+
+  if (++dfa->gen == INT_MAX) {
+    memset(dfa->seen, 0, (size_t)(prog->nstate + 1) * sizeof(int));
+    memset(dfa->kseen, 0, (size_t)(prog->nstate + 1) * sizeof(int));
+    dfa->gen = 1;
+  }
+  const int gen = dfa->gen;
+
+  // A match may start at every position.
+  if (!prog->reganch || d->prev_class < 0) {
+    stack[sp++] = (int)(prog->start - prog->state);
+  }
+  for (int i = 0; i < d->nkernel; i++) {
+    stack[sp++] = d->kernel[i];
+  }
+
+  // Follow the empty transitions, like addstate() does, and collect the
+  // states reached by consuming "c".
+  while (sp > 0) {
+    int idx = stack[--sp];
+    if (dfa->seen[idx] == gen) {
+      continue;
+    }
+    dfa->seen[idx] = gen;
+    nfa_state_T *state = &prog->state[idx];
+    nfa_state_T *next = NULL;
+
+    switch (state->c) {
+    case NFA_MATCH:
+      match = true;
+      break;
+
+    case NFA_SPLIT:
+      stack[sp++] = (int)(state->out1 - prog->state);
+      next = state->out;
+      break;
+
+    case NFA_EMPTY:
+    case NFA_ZSTART:
+    case NFA_ZEND:
+    case NFA_NOPEN:
+    case NFA_NCLOSE:
+      next = state->out;
+      break;
+
+    case NFA_BOL:
+      if (d->prev_class < 0) {
+        next = state->out;
+      }
+      break;
+
+    case NFA_EOL:
+      if (c == NUL) {
+        next = state->out;
+      }
+      break;
+
+    case NFA_BOW:
+      if (c != NUL && cur_class > 1 && cur_class != d->prev_class) {
+        next = state->out;
+      }
+      break;
+
+    case NFA_EOW:
+      if (d->prev_class > 1 && cur_class != d->prev_class) {
+        next = state->out;
+      }
+      break;
+
+    default:
+      if (state->c >= NFA_MOPEN && state->c <= NFA_ZCLOSE9) {
+        next = state->out;
+      } else if (c != NUL && dfa_char_matches(state, c, dfa->ic, buf)) {
+        nfa_state_T *to = state->c == NFA_START_COLL || state->c == NFA_START_NEG_COLL
+                          ? state->out1->out : state->out;
+        int to_idx = (int)(to - prog->state);
+        if (dfa->kseen[to_idx] != gen) {
+          dfa->kseen[to_idx] = gen;
+          dfa->kernel[nkernel++] = to_idx;
+        }
+      }
+      break;
+    }
+    if (next != NULL) {
+      stack[sp++] = (int)(next - prog->state);
+    }
+  }
+
+  if (match) {
+    return &dfa_match_state;
+  }
+  if (c == NUL) {
+    return &dfa_nomatch_state;
+  }
+  qsort(dfa->kernel, (size_t)nkernel, sizeof(int), dfa_int_cmp);
+  return dfa_find_state(dfa, dfa->kernel, nkernel, cur_class);
+}
+
+/// Check if line "lnum" of "buf" may contain a match for "prog" at or after
+/// column "col".
+///
+/// @return  false if there certainly is no match.
+static bool dfa_may_match(nfa_regprog_T *prog, buf_T *buf, linenr_T lnum, colnr_T col, bool ic)
+{
+  if (lnum < 1 || lnum > buf->b_ml.ml_line_count) {
+    return true;
+  }
+  if (prog->dfa == NULL) {
+    prog->dfa = dfa_new(prog);
+  }
+  dfa_T *dfa = prog->dfa;
+  if (dfa->failed) {
+    return true;
+  }
+  // The states depend on 'ignorecase' and 'iskeyword'.
+  if (dfa->ic != ic || memcmp(dfa->chartab, buf->b_chartab, sizeof(dfa->chartab)) != 0) {
+    dfa_clear(dfa);
+    dfa->ic = ic;
+    memcpy(dfa->chartab, buf->b_chartab, sizeof(dfa->chartab));
+  }
+
+  return dfa_line_may_match(prog, dfa, buf, (uint8_t *)ml_get_buf(buf, lnum),
+                            ml_get_buf_len(buf, lnum), col);
+}
+
+/// Check if "line" of "len" bytes may contain a match for "prog" at or after
+/// column "col", using and extending the states of "dfa".
+///
+/// @return  false if there certainly is no match.
+static bool dfa_line_may_match(nfa_regprog_T *prog, dfa_T *dfa, buf_T *buf, const uint8_t *line,
+                               colnr_T len, colnr_T col)
+{
+  if (dfa->failed) {
+    return true;
+  }
+  if (col > len || (col > 0 && line[col - 1] >= 0x80)) {
+    return true;
+  }
+  const int prev_class = col > 0 ? dfa_char_class(line[col - 1], dfa->chartab) : -1;
+  dfa_state_T *d = dfa->init[prev_class + 1];
+  if (d == NULL) {
+    d = dfa_find_state(dfa, NULL, 0, prev_class);
+    dfa->init[prev_class + 1] = d;
+  }
+
+  for (colnr_T i = col; d != NULL; i++) {
+    const uint8_t c = line[i];
+    if (c >= 0x80) {
+      return true;
+    }
+    dfa_state_T *next = d->next[c];
+    if (next == NULL) {
+      next = dfa_step(prog, dfa, d, c, buf);
+      d->next[c] = next;
+    }
+    if (next == &dfa_match_state) {
+      return true;
+    } else if (next == &dfa_nomatch_state) {
+      return false;
+    }
+    d = next;
+  }
+
+  // Too many states: start over next time, unless that happens too often.
+  dfa_clear(dfa);
+  if (++dfa->nflush > DFA_MAX_FLUSH) {
+    dfa->failed = true;
+  }
+  return true;
+}
+
+static void dfa_regfree(regprog_T *prog)
+{
+  if (prog == NULL) {
+    return;
+  }
+  dfa_free(((nfa_regprog_T *)prog)->dfa);
+  nfa_regfree(prog);
+}
+
+/// Match a regexp against multiple lines, like nfa_regexec_multi().  Lines
+/// where the DFA finds no match are skipped without running the NFA.
+static int dfa_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum, colnr_T col,
+                             proftime_T *tm, int *timed_out)
+{
+  // The automaton for words is faster than the DFA.
+  if (((nfa_regprog_T *)rmp->regprog)->ac == NULL
+      && !dfa_may_match((nfa_regprog_T *)rmp->regprog, buf, lnum, col,
+                        regprog_ic(rmp->regprog, rmp->rmm_ic))) {
+    return 0;
+  }
+  return nfa_regexec_multi(rmp, win, buf, lnum, col, tm, timed_out);
+}
+// }}}1
+
+// regexp_ac.c {{{1
+
+// Aho-Corasick automaton for NFA programs.
+//
+// Patterns like "\<\(if\|else\|while\)\>" are common in syntax files and
+// plugins.  The NFA engine tries every word at every position, the automaton
+// finds all of them in one pass over the line, however many words there are.
+// It is used when the pattern is nothing but words separated by "\|",
+// optionally inside one "\(\)" or "\%(\)" and between "\<" and "\>".  It runs
+// on the case folded text, so that the same automaton is used with and without
+// ignoring case; without ignoring case the characters of a word found are
+// compared with the text.  The match is the same as found by the NFA engine:
+// the leftmost one, and of the words starting there the first one in the
+// pattern.
+
+enum {
+  AC_MAX_CHARS = 64,  ///< longest word in characters
+  AC_MAX_STATES = 100000,  ///< most states of an automaton
+};
+
+static void ac_free(ac_T *ac)
+{
+  if (ac == NULL) {
+    return;
+  }
+  xfree(ac->next);
+  xfree(ac->out);
+  xfree(ac->out_link);
+  xfree(ac->word_next);
+  xfree(ac->word_start);
+  xfree(ac->word_len);
+  xfree(ac->chars);
+  xfree(ac);
+}
+
+/// Add the word starting at "state" to "chars" and its start to "starts".
+///
+/// @param[in,out] join  state after the words, NULL for the first word
+///
+/// @return  false if "state" does not start a word followed by "join".
+static bool ac_add_word(nfa_state_T *state, nfa_state_T **join, garray_T *chars,
+                        garray_T *starts)
+{
+  if (state->c <= 0 || utf_iscomposing_legacy(state->c)) {
+    return false;
+  }
+  const int start = chars->ga_len;
+  GA_APPEND(int, starts, start);
+  for (; state->c > 0; state = state->out) {
+    if (state->c == NL || chars->ga_len - start >= AC_MAX_CHARS) {
+      return false;
+    }
+    GA_APPEND(int, chars, state->c);
+  }
+  if (*join == NULL) {
+    *join = state;
+  }
+  return state == *join;
+}
+
+/// Build the automaton for "nwords" words with characters "chars", word "i"
+/// starting at "chars[starts[i]]".
+///
+/// @return  NULL when there would be too many states.
+static ac_T *ac_new(const int *chars, int nchars, const int *starts, int nwords)
+{
+  // The UTF-8 bytes of the case folded words.
+  char *bytes = xmalloc((size_t)nchars * MB_MAXCHAR);
+  int *byte_start = xmalloc(((size_t)nwords + 1) * sizeof(int));
+  int nbytes = 0;
+  for (int i = 0; i < nwords; i++) {
+    byte_start[i] = nbytes;
+    const int end = i + 1 < nwords ? starts[i + 1] : nchars;
+    for (int j = starts[i]; j < end; j++) {
+      nbytes += utf_char2bytes(utf_fold(chars[j]), bytes + nbytes);
+    }
+  }
+  byte_start[nwords] = nbytes;
+  if (nbytes + 1 > AC_MAX_STATES) {
+    xfree(bytes);
+    xfree(byte_start);
+    return NULL;
+  }
+
+  ac_T *ac = xcalloc(1, sizeof(ac_T));
+  ac->nclasses = 1;
+  for (int i = 0; i < nbytes; i++) {
+    uint8_t *cls = &ac->byte_class[(uint8_t)bytes[i]];
+    if (*cls == 0) {
+      *cls = (uint8_t)ac->nclasses++;
+    }
+  }
+
+  // Build the trie, -1 for a missing transition.
+  const int nclasses = ac->nclasses;
+  const size_t maxstates = (size_t)nbytes + 1;
+  ac->next = xmalloc(maxstates * (size_t)nclasses * sizeof(int));
+  memset(ac->next, 0xff, maxstates * (size_t)nclasses * sizeof(int));
+  ac->out = xmalloc(maxstates * sizeof(int));
+  memset(ac->out, 0xff, maxstates * sizeof(int));
+  ac->out_link = xmalloc(maxstates * sizeof(int));
+  ac->word_next = xmalloc((size_t)nwords * sizeof(int));
+  ac->word_start = xmemdup(starts, (size_t)nwords * sizeof(int));
+  ac->word_len = xmalloc((size_t)nwords * sizeof(int));
+  ac->chars = xmemdup(chars, (size_t)nchars * sizeof(int));
+  ac->nstates = 1;
+  for (int i = 0; i < nwords; i++) {
+    int state = 0;
+    for (int j = byte_start[i]; j < byte_start[i + 1]; j++) {
+      int *to = &ac->next[state * nclasses + ac->byte_class[(uint8_t)bytes[j]]];
+      if (*to < 0) {
+        *to = ac->nstates++;
+      }
+      state = *to;
+    }
+    ac->word_len[i] = (i + 1 < nwords ? starts[i + 1] : nchars) - starts[i];
+    ac->maxlen = MAX(ac->maxlen, ac->word_len[i]);
+    ac->word_next[i] = ac->out[state];
+    ac->out[state] = i;
+  }
+  xfree(bytes);
+  xfree(byte_start);
+
+  // Breadth first, fill in the missing transitions with those of the longest
+  // suffix that is in the trie.
+  int *fail = xmalloc((size_t)ac->nstates * sizeof(int));
+  int *queue = xmalloc((size_t)ac->nstates * sizeof(int));
+  int qhead = 0;
+  int qtail = 0;
+  fail[0] = 0;
+  ac->out_link[0] = -1;
+  for (int k = 0; k < nclasses; k++) {
+    int *to = &ac->next[k];
+    if (*to < 0) {
+      *to = 0;
+    } else {
+      fail[*to] = 0;
+      ac->out_link[*to] = -1;
+      queue[qtail++] = *to;
+    }
+  }
+  while (qhead < qtail) {
+    const int state = queue[qhead++];
+    for (int k = 0; k < nclasses; k++) {
+      int *to = &ac->next[state * nclasses + k];
+      const int suffix = ac->next[fail[state] * nclasses + k];
+      if (*to < 0) {
+        *to = suffix;
+      } else {
+        fail[*to] = suffix;
+        ac->out_link[*to] = ac->out[suffix] >= 0 ? suffix : ac->out_link[suffix];
+        queue[qtail++] = *to;
+      }
+    }
+  }
+  xfree(fail);
+  xfree(queue);
+  return ac;
+}
+
+/// Make the automaton for "prog" when it is an alternation of words.
+///
+/// @return  NULL when it is not.
+static ac_T *nfa_get_ac(nfa_regprog_T *prog)
+{
+  if (prog->regflags & RF_ICOMBINE) {
+    return NULL;
+  }
+  nfa_state_T *p = prog->start;
+  if (p->c != NFA_MOPEN) {
+    return NULL;
+  }
+  p = p->out;
+  const bool bow = p->c == NFA_BOW;
+  if (bow) {
+    p = p->out;
+  }
+  int close = 0;
+  if (p->c == NFA_MOPEN1 || p->c == NFA_NOPEN) {
+    close = p->c == NFA_NOPEN ? NFA_NCLOSE : NFA_MCLOSE1;
+    p = p->out;
+  }
+  if (p->c != NFA_SPLIT) {
+    return NULL;
+  }
+
+  // Depth first through the splits, the words are found in the order of the
+  // pattern.
+  garray_T chars, starts, stack;
+  ga_init(&chars, sizeof(int), 64);
+  ga_init(&starts, sizeof(int), 16);
+  ga_init(&stack, sizeof(nfa_state_T *), 16);
+  GA_APPEND(nfa_state_T *, &stack, p);
+  nfa_state_T *join = NULL;
+  bool ok = true;
+  for (int steps = 0; ok && stack.ga_len > 0; steps++) {
+    nfa_state_T *state = ((nfa_state_T **)stack.ga_data)[--stack.ga_len];
+    if (steps > prog->nstate) {
+      ok = false;  // going around in circles
+    } else if (state->c == NFA_SPLIT) {
+      ok = state->out1 != NULL;
+      if (ok) {
+        GA_APPEND(nfa_state_T *, &stack, state->out1);
+        GA_APPEND(nfa_state_T *, &stack, state->out);
+      }
+    } else {
+      ok = ac_add_word(state, &join, &chars, &starts);
+    }
+  }
+
+  if (ok && close != 0) {
+    ok = join->c == close;
+    if (ok) {
+      join = join->out;
+    }
+  }
+  const bool eow = ok && join->c == NFA_EOW;
+  if (eow) {
+    join = join->out;
+  }
+  ac_T *ac = NULL;
+  if (ok && join->c == NFA_MCLOSE && join->out->c == NFA_MATCH) {
+    ac = ac_new(chars.ga_data, chars.ga_len, starts.ga_data, starts.ga_len);
+  }
+  if (ac != NULL) {
+    ac->bow = bow;
+    ac->eow = eow;
+    ac->nsub = close == NFA_MCLOSE1 ? 1 : 0;
+  }
+  ga_clear(&chars);
+  ga_clear(&starts);
+  ga_clear(&stack);
+  return ac;
+}
+
+/// Get the class of the character before column "col" of "line".
+static int ac_class_before(const uint8_t *line, colnr_T col, const uint64_t *chartab)
+{
+  const char *p = (char *)line + col - 1;
+  return mb_get_class_tab(p - utf_head_off((char *)line, p), chartab);
+}
+
+/// Check if word "w" of "ac", found from "start" to "end" in "line", is a
+/// match like the NFA engine finds it.
+static bool ac_word_matches(const ac_T *ac, int w, const uint8_t *line, colnr_T start,
+                            colnr_T end, bool ic, const uint64_t *chartab)
+{
+  if (!ic) {
+    const char *p = (char *)line + start;
+    const int *wc = ac->chars + ac->word_start[w];
+    for (int i = 0; i < ac->word_len[w]; i++) {
+      if (utf_ptr2char(p) != wc[i]) {
+        return false;
+      }
+      p += utf_ptr2len(p);
+    }
+  }
+  // Not a match when ending before a composing character, like NFA_MATCH.
+  if (line[end] >= 0x80 && utf_iscomposing_legacy(utf_ptr2char((char *)line + end))) {
+    return false;
+  }
+  if (ac->bow) {
+    const int this_class = mb_get_class_tab((char *)line + start, chartab);
+    if (this_class <= 1
+        || (start > 0 && ac_class_before(line, start, chartab) == this_class)) {
+      return false;
+    }
+  }
+  if (ac->eow) {
+    const int this_class = mb_get_class_tab((char *)line + end, chartab);
+    const int prev_class = ac_class_before(line, end, chartab);
+    if (this_class == prev_class || prev_class == 0 || prev_class == 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Find the first match of the words of "ac" in "line" at or after "col".
+/// Uses no global state, so that it can be used by any thread.
+///
+/// @param  ic       ignore case
+/// @param  chartab  'iskeyword' for "\<" and "\>"
+/// @param[out] endcol  column just after the match
+///
+/// @return  column of the match or -1 when there is none.
+static colnr_T ac_find(const ac_T *ac, const uint8_t *line, colnr_T col, bool ic,
+                       const uint64_t *chartab, colnr_T *endcol)
+{
+  colnr_T char_col[AC_MAX_CHARS];  // columns of the last characters
+  colnr_T best = -1;
+  int best_char = 0;
+  int best_word = 0;
+  int state = 0;
+
+  for (int ci = 0; line[col] != NUL; ci++) {
+    if (best >= 0 && ci - best_char >= ac->maxlen) {
+      break;  // no other word can start at or before "best"
+    }
+    char_col[ci % AC_MAX_CHARS] = col;
+    int c = line[col];
+    if (c < 0x80) {
+      c = TOLOWER_ASC(c);
+      col++;
+    } else {
+      c = utf_fold(utf_ptr2char((char *)line + col));
+      col += utf_ptr2len((char *)line + col);
+    }
+    if (c < 0x80) {
+      state = ac->next[state * ac->nclasses + ac->byte_class[c]];
+    } else {
+      char buf[MB_MAXCHAR];
+      const int len = utf_char2bytes(c, buf);
+      for (int i = 0; i < len; i++) {
+        state = ac->next[state * ac->nclasses + ac->byte_class[(uint8_t)buf[i]]];
+      }
+    }
+
+    for (int s = ac->out[state] >= 0 ? state : ac->out_link[state]; s >= 0; s = ac->out_link[s]) {
+      for (int w = ac->out[s]; w >= 0; w = ac->word_next[w]) {
+        const int start_char = ci - ac->word_len[w] + 1;
+        if (best >= 0
+            && (start_char > best_char || (start_char == best_char && w > best_word))) {
+          continue;
+        }
+        const colnr_T start = char_col[start_char % AC_MAX_CHARS];
+        if (ac_word_matches(ac, w, line, start, col, ic, chartab)) {
+          best = start;
+          best_char = start_char;
+          best_word = w;
+          *endcol = col;
+        }
+      }
+    }
+  }
+  return best;
+}
+// }}}1
+
+static regengine_T bt_regengine = {
+  bt_regcomp,
+  bt_regfree,
+  bt_regexec_nl,
+  bt_regexec_multi,
+#ifdef REGEXP_DEBUG
+  "",
+#endif
+};
+
+static regengine_T nfa_regengine = {
+  nfa_regcomp,
+  nfa_regfree,
+  nfa_regexec_nl,
+  nfa_regexec_multi,
+#ifdef REGEXP_DEBUG
+  "",
+#endif
+};
+
+static regengine_T dfa_regengine = {
+  nfa_regcomp,
+  dfa_regfree,
+  nfa_regexec_nl,
+  dfa_regexec_multi,
+#ifdef REGEXP_DEBUG
+  "",
+#endif
+};
+
+// Which regexp engine to use? Needed for vim_regcomp().
+// Must match with 'regexpengine'.
+static int regexp_engine = 0;
+
+#ifdef REGEXP_DEBUG
+static uint8_t regname[][30] = {
+  "AUTOMATIC Regexp Engine",
+  "BACKTRACKING Regexp Engine",
+  "NFA Regexp Engine",
+  "Lazy DFA Regexp Engine"
+};
+#endif
+
+// Compile a regular expression into internal code.
+// Returns the program in allocated memory.
+// Use vim_regfree() to free the memory.
+// Returns NULL for an error.
+regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
+{
+  regprog_T *prog = NULL;
+  const char *expr = expr_arg;
+
+  regexp_engine = (int)p_re;
+
+  // Check for prefix "\%#=", that sets the regexp engine
+  if (strncmp(expr, "\\%#=", 4) == 0) {
+    int newengine = expr[4] - '0';
 
     if (newengine == AUTOMATIC_ENGINE
         || newengine == BACKTRACKING_ENGINE
-        || newengine == NFA_ENGINE) {
+        || newengine == NFA_ENGINE
+        || newengine == DFA_ENGINE) {
       regexp_engine = expr[4] - '0';
       expr += 5;
 #ifdef REGEXP_DEBUG
@@ -16004,7 +17372,7 @@ regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
            regname[newengine]);
 #endif
     } else {
-      emsg(_("E864: \\%#= can only be followed by 0, 1, or 2. The automatic engine will be used "));
+      emsg(_("E864: \\%#= can only be followed by 0, 1, 2, or 3. The automatic engine will be used "));
       regexp_engine = AUTOMATIC_ENGINE;
     }
   }
@@ -16052,6 +17420,13 @@ regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
     }
   }
 
+  // Use the DFA when it can handle the pattern.
+  if (prog != NULL && prog->engine == &nfa_regengine
+      && (regexp_engine == AUTOMATIC_ENGINE || regexp_engine == DFA_ENGINE)
+      && dfa_can_run((nfa_regprog_T *)prog)) {
+    prog->engine = &dfa_regengine;
+  }
+
   if (prog != NULL) {
     // Store the info needed to call regcomp() again when the engine turns out
     // to be very slow when executing it.
@@ -16065,14 +17440,95 @@ regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
 // Free a compiled regexp program, returned by vim_regcomp().
 void vim_regfree(regprog_T *prog)
 {
-  if (prog != NULL) {
-    prog->engine->regfree(prog);
+  if (prog == NULL) {
+    return;
+  }
+  // A program in the cache is freed when the last reference is dropped.
+  if (prog->re_refcount > 1) {
+    prog->re_refcount--;
+    return;
+  }
+  prog->engine->regfree(prog);
+}
+
+/// Compile "expr" with "re_flags" like vim_regcomp(), but use the program of
+/// a recent call with the same pattern and flags when there is one.  For
+/// callers that compile the same pattern over and over, e.g. for every
+/// redraw.  The program is shared, it must not be changed.  Free it with
+/// vim_regfree() as usual.
+regprog_T *vim_regcomp_cached(const char *expr, int re_flags)
+  FUNC_ATTR_NONNULL_ALL
+{
+  // Extra matches are set by the caller.  A character class like
+  // "[[:keyword:]]" depends on options of the current buffer.
+  if (reg_do_extmatch != 0 || strstr(expr, "[:") != NULL) {
+    return vim_regcomp(expr, re_flags);
+  }
+
+  const size_t len = strlen(expr);
+  const bool cpo_lit = vim_strchr(p_cpo, CPO_LITERAL) != NULL;
+  regcache_T *slot = &regcache[0];
+  for (int i = 0; i < REGCACHE_SIZE; i++) {
+    regcache_T *rc = &regcache[i];
+    if (rc->prog == NULL) {
+      if (slot->prog != NULL) {
+        slot = rc;
+      }
+      continue;
+    }
+    if (rc->len == len && rc->re_flags == re_flags && rc->engine == (int)p_re
+        && rc->cpo_lit == cpo_lit && memcmp(rc->pat, expr, len) == 0) {
+      if (rc->prog->re_in_use) {
+        // Cannot use the same program recursively.
+        return vim_regcomp(expr, re_flags);
+      }
+      g_stats.regcache_hit++;
+      rc->used = ++regcache_tick;
+      rc->prog->re_refcount++;
+      return rc->prog;
+    }
+    if (slot->prog != NULL && rc->used < slot->used) {
+      slot = rc;
+    }
+  }
+
+  g_stats.regcache_miss++;
+  regprog_T *prog = vim_regcomp(expr, re_flags);
+  // "\%.l" and friends store the cursor position in the program.
+  if (prog == NULL || (prog->regflags & RF_CONTEXT)) {
+    return prog;
+  }
+  // Replace the least recently used entry.
+  regcache_clear_entry(slot);
+  *slot = (regcache_T){
+    .pat = xmemdupz(expr, len),
+    .len = len,
+    .re_flags = re_flags,
+    .engine = (int)p_re,
+    .cpo_lit = cpo_lit,
+    .prog = prog,
+    .used = ++regcache_tick,
+  };
+  // One reference for the cache and one for the caller.
+  prog->re_refcount = 2;
+  return prog;
+}
+
+static void regcache_clear_entry(regcache_T *rc)
+{
+  if (rc->prog != NULL) {
+    vim_regfree(rc->prog);
+    xfree(rc->pat);
   }
+  *rc = (regcache_T){ 0 };
 }
 
 #if defined(EXITFREE)
 void free_regexp_stuff(void)
 {
+  for (int i = 0; i < REGCACHE_SIZE; i++) {
+    regcache_clear_entry(&regcache[i]);
+  }
   ga_clear(&regstack);
   ga_clear(&backpos);
   xfree(reg_tofree);
@@ -16209,6 +17665,9 @@ int vim_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum, c
     emsg(_(e_recursive));
     return false;
   }
+  if (re_must_skip_line(rmp, buf, lnum)) {
+    return 0;
+  }
   rmp->regprog->re_in_use = true;
 
   if (rex_in_use) {
@@ -16260,3 +17719,64 @@ int vim_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum, c
 
   return result <= 0 ? 0 : result;
 }
+
+/// Make a quick check for lines of "buf" that cannot contain a match for
+/// "rmp", see vim_regfilter_line().  Unlike vim_regexec_multi() it uses no
+/// global state, so that another thread can check lines while "rmp" and the
+/// options of "buf" are not changed.  Each thread needs its own.
+///
+/// @return  NULL when there is no such check for the pattern.
+regfilter_T *vim_regfilter_new(regmmatch_T *rmp, buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  regprog_T *prog = rmp->regprog;
+  const ac_T *ac = prog->engine != &bt_regengine ? ((nfa_regprog_T *)prog)->ac : NULL;
+  const bool use_dfa = ac == NULL && prog->engine == &dfa_regengine
+                       && (((nfa_regprog_T *)prog)->dfa == NULL
+                           || !((nfa_regprog_T *)prog)->dfa->failed);
+  if (prog->re_mustlen == 0 && !use_dfa && ac == NULL) {
+    return NULL;
+  }
+
+  regfilter_T *rf = xcalloc(1, sizeof(regfilter_T));
+  rf->prog = prog;
+  rf->buf = buf;
+  rf->ic = regprog_ic(prog, rmp->rmm_ic);
+  if (ac != NULL) {
+    rf->ac = ac;
+    memcpy(rf->chartab, buf->b_chartab, sizeof(rf->chartab));
+  } else if (use_dfa) {
+    rf->dfa = dfa_new((nfa_regprog_T *)prog);
+    rf->dfa->ic = rf->ic;
+    memcpy(rf->dfa->chartab, buf->b_chartab, sizeof(rf->dfa->chartab));
+  }
+  return rf;
+}
+
+/// Check if "line" of "len" bytes, a line of the buffer "rf" was made for,
+/// may contain a match.
+///
+/// @return  false if there certainly is no match.
+bool vim_regfilter_line(regfilter_T *rf, const char *line, colnr_T len)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (rf->prog->re_mustlen > 0 && re_must_missing(rf->prog, rf->ic, line, (size_t)len)) {
+    return false;
+  }
+  if (rf->ac != NULL) {
+    colnr_T endcol;
+    return ac_find(rf->ac, (uint8_t *)line, 0, rf->ic, rf->chartab, &endcol) >= 0;
+  }
+  return rf->dfa == NULL
+         || dfa_line_may_match((nfa_regprog_T *)rf->prog, rf->dfa, rf->buf, (uint8_t *)line, len,
+                               0);
+}
+
+void vim_regfilter_free(regfilter_T *rf)
+{
+  if (rf == NULL) {
+    return;
+  }
+  dfa_free(rf->dfa);
+  xfree(rf);
+}
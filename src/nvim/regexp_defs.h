@@ -25,6 +25,9 @@ enum {
 
 typedef struct regengine regengine_T;
 
+/// Check of lines for a regexp that any thread can use, see vim_regfilter_new().
+typedef struct regfilter regfilter_T;
+
 /// Structure to be used for multi-line matching.
 /// Sub-match "no" starts in line "startpos[no].lnum" column "startpos[no].col"
 /// and ends in line "endpos[no].lnum" just before column "endpos[no].col".
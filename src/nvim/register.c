@@ -27,6 +27,7 @@
 #include "nvim/mark.h"
 #include "nvim/mbyte.h"
 #include "nvim/memline.h"
+#include "nvim/memline_defs.h"
 #include "nvim/message.h"
 #include "nvim/move.h"
 #include "nvim/normal.h"
@@ -1879,6 +1880,13 @@ void do_put(int regname, yankreg_T *reg, int dir, int count, int flags)
         orig_indent = get_indent();
       }
 
+      // Whole lines that are not looked at again can be added in one go.
+      const bool bulk = y_type == kMTLineWise && !(flags & (PUT_FIXINDENT | PUT_LINE_SPLIT));
+      mlbulk_T mlbulk;
+      if (bulk) {
+        ml_append_bulk_start(&mlbulk, curbuf, lnum, 0);
+      }
+
       // Insert at least one line.  When y_type is kMTCharWise, break the first
       // line in two.
       for (int cnt = 1; cnt <= count; cnt++) {
@@ -1913,7 +1921,8 @@ void do_put(int regname, yankreg_T *reg, int dir, int count, int flags)
 
         for (; i < y_size; i++) {
           if ((y_type != kMTCharWise || i < y_size - 1)) {
-            if (ml_append(lnum, y_array[i].data, 0, false) == FAIL) {
+            if ((bulk ? ml_append_bulk(&mlbulk, y_array[i].data, 0)
+                 : ml_append(lnum, y_array[i].data, 0, false)) == FAIL) {
               goto error;
             }
             new_lnum++;
@@ -1973,6 +1982,10 @@ void do_put(int regname, yankreg_T *reg, int dir, int count, int flags)
       }
 
 error:
+      if (bulk) {
+        ml_append_bulk_end(&mlbulk);
+      }
+
       // Adjust marks.
       if (y_type == kMTLineWise) {
         curbuf->b_op_start.col = 0;
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "klib/kvec.h"
 #include "nvim/ascii_defs.h"
 #include "nvim/autocmd.h"
 #include "nvim/autocmd_defs.h"
@@ -22,6 +23,10 @@
 #include "nvim/eval/typval.h"
 #include "nvim/eval/typval_defs.h"
 #include "nvim/eval/vars.h"
+#include "nvim/event/defs.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
+#include "nvim/event/time.h"
 #include "nvim/ex_cmds.h"
 #include "nvim/ex_cmds_defs.h"
 #include "nvim/ex_docmd.h"
@@ -36,6 +41,7 @@
 #include "nvim/indent_c.h"
 #include "nvim/insexpand.h"
 #include "nvim/macros_defs.h"
+#include "nvim/main.h"
 #include "nvim/mark.h"
 #include "nvim/mark_defs.h"
 #include "nvim/mbyte.h"
@@ -203,7 +209,7 @@ int search_regcomp(char *pat, size_t patlen, char **used_pat, int pat_save, int
 
   regmatch->rmm_ic = ignorecase(pat);
   regmatch->rmm_maxcol = 0;
-  regmatch->regprog = vim_regcomp(pat, magic ? RE_MAGIC : 0);
+  regmatch->regprog = vim_regcomp_cached(pat, magic ? RE_MAGIC : 0);
   if (regmatch->regprog == NULL) {
     return FAIL;
   }
@@ -486,6 +492,16 @@ char *last_search_pat(void)
   return spats[last_idx].pat;
 }
 
+size_t last_search_pat_len(void)
+{
+  return spats[last_idx].patlen;
+}
+
+int last_search_pat_magic(void)
+{
+  return spats[last_idx].magic;
+}
+
 // Reset search direction to forward.  For "gd" and "gD" commands.
 void reset_search_dir(void)
 {
@@ -2748,9 +2764,15 @@ static void update_search_stat(int dirc, pos_T *pos, pos_T *cursor_pos, searchst
     if (timeout > 0) {
       start = profile_setlimit(timeout);
     }
-    while (!got_int && searchit(curwin, curbuf, &lastpos, &endpos,
-                                FORWARD, NULL, 0, 1, SEARCH_KEEP, RE_LAST,
-                                NULL) != FAIL) {
+    // Counting all matches again is quick with the search index.
+    if (EMPTY_POS(lastpos)
+        && search_index_stat(curbuf, p, timeout, maxcount, &cur, &cnt, &exact_match,
+                             &incomplete)) {
+      done_search = true;
+    }
+    while (!done_search && !got_int && searchit(curwin, curbuf, &lastpos, &endpos,
+                                                FORWARD, NULL, 0, 1, SEARCH_KEEP, RE_LAST,
+                                                NULL) != FAIL) {
       done_search = true;
       // Stop after passing the time limit.
       if (timeout > 0 && profile_passed_limit(start)) {
@@ -2790,6 +2812,306 @@ static void update_search_stat(int dirc, pos_T *pos, pos_T *cursor_pos, searchst
   p_ws = save_ws;
 }
 
+enum {
+  SEARCH_INDEX_LINES = 1000,  ///< lines searched at a time for the search index
+  SEARCH_INDEX_SLICE = 10,    ///< msec spent on the search index in the background
+};
+
+/// Timer for searching more lines for the search index in the background.
+static TimeWatcher search_index_timer;
+static bool search_index_timer_init = false;
+/// Buffer handle of the search index to complete in the background.
+static handle_T search_index_bufnr = 0;
+
+/// Drop the search index of "buf".
+void search_index_clear(buf_T *buf)
+{
+  SearchIndex *si = &buf->b_search_index;
+  kv_destroy(si->si_lines);
+  XFREE_CLEAR(si->si_pat);
+  si->si_dirty_top = 0;
+}
+
+/// Get the search index of "buf" for the last search pattern, dropping what
+/// it has when that was for another pattern or the text changed.
+///
+/// @return  NULL when the pattern can't use an index, because its matches
+///          depend on more than the text of each line.
+static SearchIndex *search_index_get(buf_T *buf)
+{
+  SearchPattern *const sp = &spats[last_idx];
+  regmmatch_T regmatch;
+  if (sp->pat == NULL
+      || search_regcomp(NULL, 0, NULL, RE_SEARCH, RE_LAST, SEARCH_KEEP, &regmatch) == FAIL) {
+    return NULL;
+  }
+  const bool line_local = re_line_local(regmatch.regprog);
+  const bool ic = regmatch.rmm_ic;
+  vim_regfree(regmatch.regprog);
+  SearchIndex *si = &buf->b_search_index;
+  if (!line_local) {
+    search_index_clear(buf);
+    return NULL;
+  }
+
+  const bool match_end = vim_strchr(p_cpo, CPO_SEARCH) != NULL;
+  if (si->si_pat == NULL
+      || si->si_patlen != sp->patlen
+      || memcmp(si->si_pat, sp->pat, sp->patlen) != 0
+      || si->si_magic != sp->magic
+      || si->si_ic != ic
+      || si->si_match_end != match_end
+      || memcmp(si->si_chartab, buf->b_chartab, sizeof(si->si_chartab)) != 0
+      || si->si_changedtick != buf_get_changedtick(buf)) {
+    search_index_clear(buf);
+    si->si_pat = xmemdupz(sp->pat, sp->patlen);
+    si->si_patlen = sp->patlen;
+    si->si_magic = sp->magic;
+    si->si_ic = ic;
+    si->si_match_end = match_end;
+    memcpy(si->si_chartab, buf->b_chartab, sizeof(si->si_chartab));
+    si->si_changedtick = buf_get_changedtick(buf);
+    si->si_next = 1;
+  }
+  return si;
+}
+
+/// @return  the index of the first item in "si_lines" at or below "lnum".
+static size_t search_index_find(const SearchIndex *si, linenr_T lnum)
+{
+  size_t lo = 0;
+  size_t hi = kv_size(si->si_lines);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (kv_A(si->si_lines, mid).sl_lnum < lnum) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/// Find the next match of the last search pattern in "buf" after "pos",
+/// like the search count does, but not below line "bot".  Start with
+/// "pos->lnum" zero to find a match in the first line.
+static bool search_index_next(buf_T *buf, pos_T *pos, pos_T *endpos, linenr_T bot)
+{
+  searchit_arg_T sia = { .sa_stop_lnum = bot };
+  const int save_ws = p_ws;
+  p_ws = false;
+  bool found = searchit(curwin, buf, pos, endpos, FORWARD, NULL, 0, 1, SEARCH_KEEP, RE_LAST,
+                        &sia) != FAIL && pos->lnum <= bot;
+  p_ws = save_ws;
+  return found;
+}
+
+/// Search lines "top" to "bot" of "buf" and store the number of matches in
+/// each of them in the search index, replacing what it had for them.
+static void search_index_scan(buf_T *buf, linenr_T top, linenr_T bot)
+{
+  SearchIndex *si = &buf->b_search_index;
+  kvec_t(SearchIndexLine) found = KV_INITIAL_VALUE;
+  pos_T pos = { top - 1, top > 1 ? MAXCOL : 0, 0 };
+  pos_T endpos;
+  while (!got_int && search_index_next(buf, &pos, &endpos, bot)) {
+    if (kv_size(found) > 0 && kv_last(found).sl_lnum == pos.lnum) {
+      kv_last(found).sl_count++;
+    } else {
+      kv_push(found, ((SearchIndexLine){ .sl_lnum = pos.lnum, .sl_count = 1 }));
+    }
+  }
+
+  // Replace the items for lines "top" to "bot" with "found".
+  const size_t i = search_index_find(si, top);
+  const size_t old_count = search_index_find(si, bot + 1) - i;
+  const size_t tail = kv_size(si->si_lines) - i - old_count;
+  if (kv_size(found) > old_count) {
+    kv_ensure_space(si->si_lines, kv_size(found) - old_count);
+  }
+  if (tail > 0) {
+    memmove(&kv_A(si->si_lines, i + kv_size(found)), &kv_A(si->si_lines, i + old_count),
+            tail * sizeof(SearchIndexLine));
+  }
+  if (kv_size(found) > 0) {
+    memcpy(&kv_A(si->si_lines, i), found.items, kv_size(found) * sizeof(SearchIndexLine));
+  }
+  kv_size(si->si_lines) = i + kv_size(found) + tail;
+  kv_destroy(found);
+}
+
+/// Search the lines of "buf" that were changed and the ones not searched yet
+/// for the search index, until "tm" has passed when it is not zero.
+///
+/// @return  true when the index is complete.
+static bool search_index_update(buf_T *buf, proftime_T tm)
+{
+  SearchIndex *si = &buf->b_search_index;
+  while (!got_int) {
+    linenr_T top;
+    linenr_T bot;
+    if (si->si_dirty_top > 0) {
+      top = si->si_dirty_top;
+      bot = MIN(si->si_dirty_bot, top + SEARCH_INDEX_LINES - 1);
+      si->si_dirty_top = bot < si->si_dirty_bot ? bot + 1 : 0;
+    } else if (si->si_next <= buf->b_ml.ml_line_count) {
+      top = si->si_next;
+      bot = MIN(buf->b_ml.ml_line_count, top + SEARCH_INDEX_LINES - 1);
+      si->si_next = bot + 1;
+    } else {
+      return true;
+    }
+    search_index_scan(buf, top, bot);
+    if (got_int) {
+      // Not all matches were found, start over next time.
+      search_index_clear(buf);
+      return false;
+    }
+    if (tm != 0 && profile_passed_limit(tm)) {
+      return si->si_dirty_top == 0 && si->si_next > buf->b_ml.ml_line_count;
+    }
+  }
+  return false;
+}
+
+/// Update the search index of buffer "buf" after lines "lnum" to "lnume"
+/// (exclusive) were changed and "xtra" lines were inserted or deleted.
+/// Must be called right after b:changedtick was incremented for the change.
+void search_index_changed(buf_T *buf, linenr_T lnum, linenr_T lnume, linenr_T xtra)
+{
+  SearchIndex *si = &buf->b_search_index;
+  if (si->si_pat == NULL) {
+    return;
+  }
+  const varnumber_T changedtick = buf_get_changedtick(buf);
+  if (si->si_changedtick != changedtick - 1) {
+    // There was another change, don't know which lines it changed.
+    search_index_clear(buf);
+    return;
+  }
+  si->si_changedtick = changedtick;
+  if (lnum >= si->si_next) {
+    return;  // not searched yet
+  }
+
+  // Drop the counts of the changed lines, move the ones below.
+  const size_t i = search_index_find(si, lnum);
+  const size_t j = search_index_find(si, lnume);
+  kv_shift(si->si_lines, i, j - i);
+  for (size_t k = i; k < kv_size(si->si_lines); k++) {
+    kv_A(si->si_lines, k).sl_lnum += xtra;
+  }
+
+#define MOVE_LNUM(l, inside) ((l) < lnum ? (l) : (l) >= lnume ? (l) + xtra : (inside))
+  if (si->si_next >= lnume) {
+    si->si_next += xtra;
+  } else {
+    si->si_next = lnum;
+  }
+  // Search the changed lines again, together with lines that were changed
+  // before and not searched yet.
+  linenr_T top = lnum;
+  linenr_T bot = lnume + xtra - 1;
+  if (si->si_dirty_top > 0) {
+    top = MIN(top, MOVE_LNUM(si->si_dirty_top, lnum));
+    bot = MAX(bot, MOVE_LNUM(si->si_dirty_bot, lnum));
+  }
+#undef MOVE_LNUM
+  bot = MIN(bot, si->si_next - 1);
+  si->si_dirty_top = top <= bot ? top : 0;
+  si->si_dirty_bot = bot;
+}
+
+static void search_index_timer_cb(TimeWatcher *watcher, void *data)
+{
+  buf_T *buf = handle_get_buffer(search_index_bufnr);
+  if (buf == NULL || buf->b_ml.ml_mfp == NULL || search_index_get(buf) == NULL) {
+    return;
+  }
+  if (!search_index_update(buf, profile_setlimit(SEARCH_INDEX_SLICE)) && !got_int) {
+    search_index_schedule(buf);
+  }
+}
+
+/// Continue searching lines for the search index of "buf" in the background,
+/// a bit at a time.
+static void search_index_schedule(buf_T *buf)
+{
+  if (!search_index_timer_init) {
+    time_watcher_init(&main_loop, &search_index_timer, NULL);
+    // Searching uses the regexp engine, which must not be busy already.
+    search_index_timer.events = multiqueue_new_child(main_loop.events);
+    search_index_timer_init = true;
+  }
+  search_index_bufnr = buf->handle;
+  time_watcher_start(&search_index_timer, search_index_timer_cb, 0, 0);
+}
+
+void search_index_teardown(void)
+{
+  if (!search_index_timer_init) {
+    return;
+  }
+  time_watcher_stop(&search_index_timer);
+  multiqueue_free(search_index_timer.events);
+  time_watcher_close(&search_index_timer, NULL);
+  search_index_timer_init = false;
+}
+
+/// Compute the search count of update_search_stat() for position "pos" in
+/// "buf" with the search index, searching lines that were not searched yet
+/// for up to "timeout" msec.  What is left is done in the background.
+///
+/// @return  false when the last search pattern can't use the index.
+static bool search_index_stat(buf_T *buf, pos_T pos, int timeout, int maxcount, int *cur,
+                              int *cnt, bool *exact_match, int *incomplete)
+{
+  SearchIndex *si = search_index_get(buf);
+  if (si == NULL) {
+    return false;
+  }
+  if (!search_index_update(buf, timeout > 0 ? profile_setlimit(timeout) : 0)) {
+    if (got_int) {
+      return false;
+    }
+    *incomplete = 1;
+    search_index_schedule(buf);
+  }
+
+  int64_t total = 0;
+  int64_t before = 0;
+  for (size_t i = 0; i < kv_size(si->si_lines); i++) {
+    SearchIndexLine *sl = &kv_A(si->si_lines, i);
+    total += sl->sl_count;
+    if (sl->sl_lnum < pos.lnum) {
+      before += sl->sl_count;
+    }
+  }
+  // Search the line of "pos" for the matches up to "pos".
+  const size_t i = search_index_find(si, pos.lnum);
+  if (i < kv_size(si->si_lines) && kv_A(si->si_lines, i).sl_lnum == pos.lnum) {
+    pos_T mpos = { pos.lnum - 1, pos.lnum > 1 ? MAXCOL : 0, 0 };
+    pos_T endpos;
+    while (search_index_next(buf, &mpos, &endpos, pos.lnum) && ltoreq(mpos, pos)) {
+      before++;
+      if (lt(pos, endpos)) {
+        *exact_match = true;
+      }
+    }
+  }
+
+  if (maxcount > 0 && total > maxcount) {
+    total = maxcount + 1;
+    before = MIN(before, total);
+    if (*incomplete == 0) {
+      *incomplete = 2;
+    }
+  }
+  *cnt = (int)MIN(total, INT_MAX);
+  *cur = (int)MIN(before, INT_MAX);
+  return true;
+}
+
 // "searchcount()" function
 void f_searchcount(typval_T *argvars, typval_T *rettv, EvalFuncData fptr)
 {
@@ -442,6 +442,7 @@ static int sign_define_by_name(char *name, char *icon, char *text, char *linehl,
         sh->number_hl_id = (*sp)->sn_num_hl;
         sh->cursorline_hl_id = (*sp)->sn_cul_hl;
         if (!did_redraw) {
+          rowfp_clear_all();
           FOR_ALL_WINDOWS_IN_TAB(wp, curtab) {
             if (buf_has_signs(wp->w_buffer)) {
               redraw_buf_later(wp->w_buffer, UPD_NOT_VALID);
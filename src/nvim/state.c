@@ -68,17 +68,23 @@ getkey:
       // redraw_later, this can't be done in command-line or when waiting for "Press ENTER".
       // In many of those cases the redraw is expected AFTER the key press, while normally it should
       // update the screen immediately.
+      // A redraw for events may have to wait for the next frame, see 'redrawrate'.
+      int delay = 0;
       if (must_redraw != 0 && !need_wait_return && (State & MODE_CMDLINE) == 0) {
-        update_screen();
-        setcursor();  // put cursor back where it belongs
+        delay = redraw_frame_delay();
+        if (delay == 0) {
+          update_screen();
+          setcursor();  // put cursor back where it belongs
+        }
       }
       // Flush screen updates before blocking.
       ui_flush();
       // Call `input_get` directly to block for events or user input without consuming anything from
       // `os/input.c:input_buffer` or calling the mapping engine.
-      input_get(NULL, 0, -1, typebuf.tb_change_cnt, main_loop.events);
-      // If an event was put into the queue, we send K_EVENT directly.
-      if (!input_available() && !multiqueue_empty(main_loop.events)) {
+      input_get(NULL, 0, delay > 0 ? delay : -1, typebuf.tb_change_cnt, main_loop.events);
+      // If an event was put into the queue, we send K_EVENT directly. Also when the next frame is
+      // due, so that check() redraws.
+      if (!input_available() && (delay > 0 || !multiqueue_empty(main_loop.events))) {
         key = K_EVENT;
       } else {
         goto getkey;
@@ -90,6 +96,9 @@ getkey:
       // Clear it if it should be cleared when getting the next character.
       check_end_reg_executing(true);
       may_sync_undo();
+    } else {
+      // Don't make typing wait for the next frame.
+      redraw_frame_typed();
     }
 
 #ifdef NVIM_LOG_DEBUG
@@ -5223,6 +5223,7 @@ void ex_syntax(exarg_T *eap)
   char *subcmd_end;
 
   syn_cmdlinep = eap->cmdlinep;
+  rowfp_clear_all();
 
   // isolate subcommand name
   for (subcmd_end = arg; ASCII_ISALPHA(*subcmd_end); subcmd_end++) {}
@@ -65,6 +65,12 @@ typedef struct {
   int top, bot, left, right;
 } Rect;
 
+/// Bytes needed to move the cursor in one direction.
+typedef struct {
+  int one;   ///< single step, repeated for longer moves
+  int parm;  ///< parametrized move with a one-digit count
+} StepCost;
+
 struct TUIData {
   Loop *loop;
   char buf[OUTBUF_SIZE];
@@ -121,6 +127,13 @@ struct TUIData {
   bool default_attr;
   bool set_default_colors;
   bool can_clear_attr;
+  bool attrs_redefined;  ///< attr ids were redefined since the last flush
+  struct {
+    int address;
+    int home;
+    int carriage_return;
+    StepCost left, right, up, down;
+  } motion_cost;  ///< see cursor_goto()
   ModeShape showing_mode;
   Integer verbose;
   struct {
@@ -151,6 +164,9 @@ static bool cursor_style_enabled = false;
 #define terminfo_print_num2(tui, what, num1, num2) terminfo_print_num(tui, what, num1, num2, 0)
 #define terminfo_print_num3 terminfo_print_num
 
+/// Cost of a cursor motion the terminal cannot do.
+#define MOTION_UNAVAILABLE (1 << 16)
+
 static Set(cstr_t) urls = SET_INIT;
 
 void tui_start(TUIData **tui_p, int *width, int *height, char **term, bool *rgb)
@@ -441,6 +457,7 @@ static void terminfo_start(TUIData *tui)
     || terminfo_is_term_family(term, "win32con")
     || terminfo_is_term_family(term, "interix");
   tui->bce = tui->ti.bce;
+  motion_cost_init(tui);
   // Set 't_Co' from the result of terminfo & fix_terminfo.
   t_colors = tui->ti.max_colors;
   // Enter alternate screen, save title, and clear.
@@ -933,29 +950,137 @@ static void print_cell(TUIData *tui, char *buf, sattr_T attr)
   }
 }
 
-static bool cheap_to_print(TUIData *tui, int row, int col, int next)
+/// Whether the `n` cells from `col` on `row` can be printed again to move the
+/// cursor across them: plain ASCII that is already in the current attributes.
+static bool cheap_to_print(TUIData *tui, int row, int col, int n)
 {
-  UGrid *grid = &tui->grid;
-  UCell *cell = grid->cells[row] + col;
-  while (next) {
-    next--;
-    if (attrs_differ(tui, cell->attr,
-                     tui->print_attr_id, tui->rgb)) {
-      if (tui->default_attr) {
-        return false;
+  UCell *cell = tui->grid.cells[row] + col;
+  for (; n > 0; n--, cell++) {
+    if (cell->attr != tui->print_attr_id || schar_get_ascii(cell->data) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static int num_digits(int n)
+{
+  int digits = 1;
+  while (n >= 10) {
+    n /= 10;
+    digits++;
+  }
+  return digits;
+}
+
+/// @return number of bytes `what` takes with one-digit parameters, or
+///         MOTION_UNAVAILABLE if the terminal lacks it.
+static int motion_cost_fmt(TUIData *tui, TerminfoDef what)
+{
+  const char *str = tui->ti.defs[what];
+  if (str == NULL || *str == NUL) {
+    return MOTION_UNAVAILABLE;
+  }
+  char buf[TERMINFO_SEQ_LIMIT];
+  TPVAR params[9] = { 0 };
+  params[0].num = 1;
+  params[1].num = 1;
+  size_t len = terminfo_fmt(buf, buf + sizeof(buf), str, params);
+  return len > 0 ? (int)len : MOTION_UNAVAILABLE;
+}
+
+/// Computes what each cursor motion costs on this terminal, see cursor_goto().
+static void motion_cost_init(TUIData *tui)
+{
+  tui->motion_cost.address = motion_cost_fmt(tui, kTerm_cursor_address);
+  tui->motion_cost.home = motion_cost_fmt(tui, kTerm_cursor_home);
+  tui->motion_cost.carriage_return = motion_cost_fmt(tui, kTerm_carriage_return);
+  tui->motion_cost.left = (StepCost){ motion_cost_fmt(tui, kTerm_cursor_left),
+                                      motion_cost_fmt(tui, kTerm_parm_left_cursor) };
+  tui->motion_cost.right = (StepCost){ motion_cost_fmt(tui, kTerm_cursor_right),
+                                       motion_cost_fmt(tui, kTerm_parm_right_cursor) };
+  tui->motion_cost.up = (StepCost){ motion_cost_fmt(tui, kTerm_cursor_up),
+                                    motion_cost_fmt(tui, kTerm_parm_up_cursor) };
+  tui->motion_cost.down = (StepCost){ motion_cost_fmt(tui, kTerm_cursor_down),
+                                      motion_cost_fmt(tui, kTerm_parm_down_cursor) };
+}
+
+/// Moves the cursor `n` cells in one direction with the single step repeated
+/// or the parametrized capability, whichever is shorter.
+///
+/// @param emit  if false, only compute the cost.
+/// @return number of bytes written, or that would be written.
+static int step_motion(TUIData *tui, StepCost cost, TerminfoDef one, TerminfoDef parm, int n,
+                       bool emit)
+{
+  if (n == 0) {
+    return 0;
+  }
+  int one_cost = cost.one < MOTION_UNAVAILABLE ? cost.one * n : MOTION_UNAVAILABLE;
+  int parm_cost = cost.parm < MOTION_UNAVAILABLE ? cost.parm + num_digits(n) - 1
+                                                 : MOTION_UNAVAILABLE;
+  if (emit) {
+    if (one_cost <= parm_cost) {
+      while (n--) {
+        terminfo_out(tui, one);
       }
+    } else {
+      terminfo_print_num1(tui, parm, n);
     }
-    if (schar_get_ascii(cell->data) == 0) {
-      return false;  // not ascii
+  }
+  return MIN(one_cost, parm_cost);
+}
+
+static int vertical_motion(TUIData *tui, int from, int to, bool emit)
+{
+  if (to > from) {
+    return step_motion(tui, tui->motion_cost.down, kTerm_cursor_down, kTerm_parm_down_cursor,
+                       to - from, emit);
+  }
+  return step_motion(tui, tui->motion_cost.up, kTerm_cursor_up, kTerm_parm_up_cursor,
+                     from - to, emit);
+}
+
+/// Moves the cursor from column `from` to `to` on `row`. Moving right may print
+/// the cells in between again, when that is shorter than a cursor motion.
+static int horizontal_motion(TUIData *tui, int row, int from, int to, bool emit)
+{
+  if (to < from) {
+    // Deferred right margin wrap terminals have inconsistent ideas about
+    // where the cursor actually is during a deferred wrap.  Relative
+    // motion calculations have OBOEs that cannot be compensated for,
+    // because two terminals that claim to be the same will implement
+    // different cursor positioning rules.
+    if (!tui->immediate_wrap_after_last_column && from >= tui->width) {
+      return MOTION_UNAVAILABLE;
     }
-    cell++;
+    return step_motion(tui, tui->motion_cost.left, kTerm_cursor_left, kTerm_parm_left_cursor,
+                       from - to, emit);
   }
-  return true;
+
+  int n = to - from;
+  int cost = step_motion(tui, tui->motion_cost.right, kTerm_cursor_right,
+                         kTerm_parm_right_cursor, n, false);
+  if (n > 0 && n < cost && cheap_to_print(tui, row, from, n)) {
+    if (emit) {
+      UCell *cell = tui->grid.cells[row] + from;
+      for (int i = 0; i < n; i++, cell++) {
+        char c = schar_get_ascii(cell->data);
+        out(tui, &c, 1);
+      }
+    }
+    return n;
+  }
+  if (emit) {
+    step_motion(tui, tui->motion_cost.right, kTerm_cursor_right, kTerm_parm_right_cursor, n, true);
+  }
+  return cost;
 }
 
-/// This optimizes several cases where it is cheaper to do something other
-/// than send a full cursor positioning control sequence.  However, there are
-/// some further optimizations that may seem obvious but that will not work.
+/// Moves the cursor with whatever writes the fewest bytes on this terminal:
+/// a cursor address, home or carriage return followed by relative motion, or
+/// relative motion alone.  However, there are some further optimizations that
+/// may seem obvious but that will not work.
 ///
 /// We cannot use VT (ASCII 0/11) for moving the cursor up, because VT means
 /// move the cursor down on a DEC terminal.  Similarly, on a DEC terminal FF
@@ -976,87 +1101,49 @@ static void cursor_goto(TUIData *tui, int row, int col)
     tui->print_attr_id = -1;
   }
 
-  if (0 == row && 0 == col) {
-    terminfo_out(tui, kTerm_cursor_home);
-    ugrid_goto(grid, row, col);
-    return;
-  }
-  if (grid->row == -1) {
-    goto safe_move;
-  }
-  if (0 == col
-      ? col != grid->col
-      : (row != grid->row
-         ? false
-         : (1 == col
-            ? (2 < grid->col && cheap_to_print(tui, grid->row, 0, col))
-            : (2 == col
-               ? (5 < grid->col && cheap_to_print(tui, grid->row, 0, col))
-               : false)))) {
-    // Motion to left margin from anywhere else, or CR + printing chars is
-    // even less expensive than using BSes or CUB.
-    terminfo_out(tui, kTerm_carriage_return);
-    ugrid_goto(grid, grid->row, 0);
-  }
-  if (row == grid->row) {
-    if (col < grid->col
-        // Deferred right margin wrap terminals have inconsistent ideas about
-        // where the cursor actually is during a deferred wrap.  Relative
-        // motion calculations have OBOEs that cannot be compensated for,
-        // because two terminals that claim to be the same will implement
-        // different cursor positioning rules.
-        && (tui->immediate_wrap_after_last_column || grid->col < tui->width)) {
-      int n = grid->col - col;
-      if (n <= 4) {  // This might be just BS, so it is considered really cheap.
-        while (n--) {
-          terminfo_out(tui, kTerm_cursor_left);
-        }
-      } else {
-        terminfo_print_num1(tui, kTerm_parm_left_cursor, n);
-      }
-      ugrid_goto(grid, row, col);
-      return;
-    } else if (col > grid->col) {
-      int n = col - grid->col;
-      if (n <= 2) {
-        while (n--) {
-          terminfo_out(tui, kTerm_cursor_right);
-        }
-      } else {
-        terminfo_print_num1(tui, kTerm_parm_right_cursor, n);
-      }
-      ugrid_goto(grid, row, col);
-      return;
+  enum { kMoveAddress, kMoveHome, kMoveReturn, kMoveRelative } move = kMoveAddress;
+  int best = tui->motion_cost.address + num_digits(row + 1) + num_digits(col + 1) - 2;
+  int cost;
+  if (row == 0) {
+    cost = tui->motion_cost.home + horizontal_motion(tui, 0, 0, col, false);
+    if (cost <= best) {
+      move = kMoveHome;
+      best = cost;
     }
   }
-  if (col == grid->col) {
-    if (row > grid->row) {
-      int n = row - grid->row;
-      if (n <= 4) {  // This might be just LF, so it is considered really cheap.
-        while (n--) {
-          terminfo_out(tui, kTerm_cursor_down);
-        }
-      } else {
-        terminfo_print_num1(tui, kTerm_parm_down_cursor, n);
-      }
-      ugrid_goto(grid, row, col);
-      return;
-    } else if (row < grid->row) {
-      int n = grid->row - row;
-      if (n <= 2) {
-        while (n--) {
-          terminfo_out(tui, kTerm_cursor_up);
-        }
-      } else {
-        terminfo_print_num1(tui, kTerm_parm_up_cursor, n);
-      }
-      ugrid_goto(grid, row, col);
-      return;
+  // Relative motion needs to know where the cursor is.
+  if (grid->row != -1) {
+    int vertical = vertical_motion(tui, grid->row, row, false);
+    cost = tui->motion_cost.carriage_return + vertical + horizontal_motion(tui, row, 0, col, false);
+    if (cost < best) {
+      move = kMoveReturn;
+      best = cost;
+    }
+    cost = vertical + horizontal_motion(tui, row, grid->col, col, false);
+    if (cost < best) {
+      move = kMoveRelative;
+      best = cost;
     }
   }
 
-safe_move:
-  terminfo_print_num2(tui, kTerm_cursor_address, row, col);
+  switch (move) {
+  case kMoveAddress:
+    terminfo_print_num2(tui, kTerm_cursor_address, row, col);
+    break;
+  case kMoveHome:
+    terminfo_out(tui, kTerm_cursor_home);
+    horizontal_motion(tui, 0, 0, col, true);
+    break;
+  case kMoveReturn:
+    terminfo_out(tui, kTerm_carriage_return);
+    vertical_motion(tui, grid->row, row, true);
+    horizontal_motion(tui, row, 0, col, true);
+    break;
+  case kMoveRelative:
+    vertical_motion(tui, grid->row, row, true);
+    horizontal_motion(tui, row, grid->col, col, true);
+    break;
+  }
   ugrid_goto(grid, row, col);
 }
 
@@ -1489,6 +1576,9 @@ void tui_hl_attr_define(TUIData *tui, Integer id, HlAttrs attrs, HlAttrs cterm_a
   attrs.cterm_fg_color = cterm_attrs.cterm_fg_color;
   attrs.cterm_bg_color = cterm_attrs.cterm_bg_color;
 
+  if ((size_t)id < kv_size(tui->attrs)) {
+    tui->attrs_redefined = true;
+  }
   kv_a(tui->attrs, (size_t)id) = attrs;
 }
 
@@ -1586,6 +1676,8 @@ void tui_flush(TUIData *tui)
   cursor_goto(tui, tui->row, tui->col);
 
   flush_buf(tui);
+  tui->attrs_redefined = false;
+  g_stats.tui_frames++;
 }
 
 /// Dumps termcap info to the messages area, if 'verbose' >= 3.
@@ -1754,26 +1846,80 @@ void tui_chdir(TUIData *tui, String path)
   }
 }
 
+/// @return number of leading cells that hold `chunk` and `attrs` already.
+static size_t cells_equal_prefix(const UCell *cells, const schar_T *chunk, const sattr_T *attrs,
+                                 size_t n)
+{
+  // Compare blocks of cells without branching on each one, so that the
+  // compiler can vectorize it, and only find the first difference in the
+  // block that has one.
+  enum { kBlockSize = 16 };
+  size_t i = 0;
+  for (; i + kBlockSize <= n; i += kBlockSize) {
+    uint32_t differ = 0;
+    for (size_t j = i; j < i + kBlockSize; j++) {
+      differ |= (cells[j].data ^ chunk[j]) | (uint32_t)(cells[j].attr ^ attrs[j]);
+    }
+    if (differ) {
+      break;
+    }
+  }
+  while (i < n && cells[i].data == chunk[i] && cells[i].attr == attrs[i]) {
+    i++;
+  }
+  return i;
+}
+
 void tui_raw_line(TUIData *tui, Integer g, Integer linerow, Integer startcol, Integer endcol,
                   Integer clearcol, Integer clearattr, LineFlags flags, const schar_T *chunk,
                   const sattr_T *attrs)
 {
   UGrid *grid = &tui->grid;
-  for (Integer c = startcol; c < endcol; c++) {
-    grid->cells[linerow][c].data = chunk[c - startcol];
-    assert((size_t)attrs[c - startcol] < kv_size(tui->attrs));
-    grid->cells[linerow][c].attr = attrs[c - startcol];
-  }
-  UGRID_FOREACH_CELL(grid, (int)linerow, (int)startcol, (int)endcol, {
-    print_cell_at_pos(tui, (int)linerow, curcol, cell,
-                      curcol < endcol - 1 && (cell + 1)->data == NUL);
-  });
+  UCell *cells = grid->cells[linerow];
+  // Only print the runs of cells that the terminal does not show yet. Cells
+  // with a redefined attr id look different even though they compare equal.
+  bool diff = !tui->attrs_redefined;
+  int printed_end = -1;
+  int col = (int)startcol;
+  while (col < endcol) {
+    if (diff) {
+      size_t off = (size_t)(col - startcol);
+      col += (int)cells_equal_prefix(cells + col, chunk + off, attrs + off, (size_t)(endcol - col));
+      if (col == endcol) {
+        break;
+      }
+    }
+    // Print the left half of a double-width char again when only its right
+    // half changed, and the right half along with a changed left half.
+    int start = diff && col > 0 && chunk[col - startcol] == NUL ? col - 1 : col;
+    do {
+      cells[col].data = chunk[col - startcol];
+      assert((size_t)attrs[col - startcol] < kv_size(tui->attrs));
+      cells[col].attr = attrs[col - startcol];
+      col++;
+    } while (col < endcol
+             && (!diff || chunk[col - startcol] == NUL
+                 || cells[col].data != chunk[col - startcol]
+                 || cells[col].attr != attrs[col - startcol]));
+    UGRID_FOREACH_CELL(grid, (int)linerow, start, col, {
+      print_cell_at_pos(tui, (int)linerow, curcol, cell,
+                        curcol < col - 1 && (cell + 1)->data == NUL);
+    });
+    printed_end = col;
+  }
 
   if (clearcol > endcol) {
-    ugrid_clear_chunk(grid, (int)linerow, (int)endcol, (int)clearcol,
-                      (sattr_T)clearattr);
-    clear_region(tui, (int)linerow, (int)linerow + 1, (int)endcol, (int)clearcol,
-                 (int)clearattr);
+    // Skip the cells that are blank in the clear attributes already.
+    int clearstart = (int)endcol;
+    while (diff && clearstart < clearcol && cells[clearstart].data == schar_from_ascii(' ')
+           && cells[clearstart].attr == clearattr) {
+      clearstart++;
+    }
+    if (clearstart < clearcol) {
+      ugrid_clear_chunk(grid, (int)linerow, clearstart, (int)clearcol, (sattr_T)clearattr);
+      clear_region(tui, (int)linerow, (int)linerow + 1, clearstart, (int)clearcol,
+                   (int)clearattr);
+    }
   }
 
   if (flags & kLineFlagWrap && tui->width == grid->width
@@ -1781,7 +1927,7 @@ void tui_raw_line(TUIData *tui, Integer g, Integer linerow, Integer startcol, In
     // Only do line wrapping if the grid width is equal to the terminal
     // width and the line continuation is within the grid.
 
-    if (endcol != grid->width) {
+    if (printed_end != grid->width) {
       // Print the last char of the row, if we haven't already done so.
       int size = grid->cells[linerow][grid->width - 1].data == NUL ? 2 : 1;
       print_cell_at_pos(tui, (int)linerow, grid->width - size,
@@ -2497,6 +2643,9 @@ static void flush_buf(TUIData *tui)
       fwrite(bufs[i].base, bufs[i].len, 1, tui->screenshot);
     }
   } else {
+    for (size_t i = 0; i < ARRAY_SIZE(bufs); i++) {
+      g_stats.tui_bytes += (int64_t)bufs[i].len;
+    }
     int ret
       = uv_write(&req, (uv_stream_t *)&tui->output_handle, bufs, ARRAY_SIZE(bufs), NULL);
     if (ret) {
@@ -30,6 +30,15 @@
 #include "nvim/ui.h"
 #include "nvim/ui_compositor.h"
 
+/// Last blend of compose_line(), which cells with the same attrs can reuse.
+typedef struct {
+  int back_attr;
+  int front_attr;
+  bool through;
+  int attr;
+  bool through_out;
+} BlendRun;
+
 #include "ui_compositor.c.generated.h"
 
 static int composed_uis = 0;
@@ -352,6 +361,22 @@ ScreenGrid *ui_comp_get_grid_at_coord(int row, int col)
   return &default_grid;
 }
 
+/// Blends like hl_blend_attrs(), but only calls it when the attrs differ from
+/// the previous cell, as runs of cells in a float mostly share them.
+static int blend_run(BlendRun *run, int back_attr, int front_attr, bool *through)
+{
+  if (back_attr != run->back_attr || front_attr != run->front_attr
+      || *through != run->through) {
+    run->back_attr = back_attr;
+    run->front_attr = front_attr;
+    run->through = *through;
+    run->through_out = *through;
+    run->attr = hl_blend_attrs(back_attr, front_attr, &run->through_out);
+  }
+  *through = run->through_out;
+  return run->attr;
+}
+
 /// Baseline implementation. This is always correct, but we can sometimes
 /// do something more efficient (where efficiency means smaller deltas to
 /// the downstream UI.)
@@ -434,6 +459,7 @@ static void compose_line(Integer row, Integer startcol, Integer endcol, LineFlag
 
     // 'pumblend' and 'winblend'
     if (grid->blending) {
+      BlendRun run = { .back_attr = INT_MIN };
       int width;
       for (int i = col - (int)startcol; i < until - startcol; i += width) {
         width = 1;
@@ -445,10 +471,9 @@ static void compose_line(Integer row, Integer startcol, Integer endcol, LineFlag
           thru &= (linebuf[i + 1] == schar_from_ascii(' ')
                    || linebuf[i + 1] == schar_from_char(L'\u2800'));
         }
-        attrbuf[i] = (sattr_T)hl_blend_attrs(bg_attrs[i], attrbuf[i], &thru);
+        attrbuf[i] = (sattr_T)blend_run(&run, bg_attrs[i], attrbuf[i], &thru);
         if (width == 2) {
-          attrbuf[i + 1] = (sattr_T)hl_blend_attrs(bg_attrs[i + 1],
-                                                   attrbuf[i + 1], &thru);
+          attrbuf[i + 1] = (sattr_T)blend_run(&run, bg_attrs[i + 1], attrbuf[i + 1], &thru);
         }
         if (thru) {
           memcpy(linebuf + i, bg_line + i, (size_t)width * sizeof(linebuf[i]));
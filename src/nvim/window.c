@@ -5318,6 +5318,10 @@ void win_free(win_T *wp, tabpage_T *tp)
   }
 
   xfree(wp->w_lines);
+  kv_destroy(wp->w_linesize.lc_size);
+  kv_destroy(wp->w_hlcache.hc_matches);
+  xfree(wp->w_hlcache.hc_pat);
+  kv_destroy(wp->w_rowfp);
 
   for (int i = 0; i < wp->w_tagstacklen; i++) {
     tagstack_clear_entry(&wp->w_tagstack[i]);
@@ -1,9 +1,11 @@
 -- Test for benchmarking the RE engine.
 
+local t = require('test.testutil')
 local n = require('test.functional.testnvim')()
 
 local insert, source = n.insert, n.source
 local clear, command = n.clear, n.command
+local eq = t.eq
 
 -- Temporary file for gathering benchmarking results for each regexp engine.
 local result_file = 'benchmark.out'
@@ -62,3 +64,158 @@ describe('regexp search', function()
     command('write')
   end)
 end)
+
+-- Patterns as used by syntax files, 'errorformat' and common searches.
+local patterns = {
+  { 'c number', [[\<\d\+\(u\=l\{0,2}\|ll\=u\)\>]] },
+  { 'c comment', [[/\*\|//]] },
+  { 'vim function', [[\<fu\%[nction]!\=\s\+\%([sSgGbBwWtTlL]:\|<[sS][iI][dD]>\)\=\h[a-zA-Z0-9_#.]*\ze\s*(]] },
+  { 'help tag', [[\*[#-)!+-~]\+\*\%(\s\|$\)]] },
+  { 'errorformat gcc', [[^\([^:]\+\):\(\d\+\):\(\d\+\): \(warning\|error\): \(.*\)$]] },
+  { 'errorformat make', [[^make\[\d\+\]: Entering directory [`']\(.*\)'$]] },
+  { 'trailing space', [[\s\+$]] },
+  { 'keyword', [[\<regexec\>]] },
+  { 'ignore case', [[\cnfa_\w\+]] },
+  { 'alternation', [[\<\(static\|const\|return\|while\)\>]] },
+  { 'back reference', [[\(\<\w\+\>\)\s\+\1\>]] },
+  { 'look-behind', [[\(nfa_\)\@<=state]] },
+  { 'multi-line', [[)\n\s*{]] },
+  { 'freeze', [[\s\+\%#\@<!$]] },
+}
+
+-- Large texts to search, generated ones are built in the Nvim instance.
+local fixtures = {
+  'src/nvim/regexp.c',
+  'runtime/doc/options.txt',
+  sample_file,
+  'compiler output',
+}
+
+--- Measures every pattern with every 'regexpengine' on every fixture:
+--- - throughput, from counting the matches in all lines with ":s///n"
+--- - allocations, as counted by nvim__stats() during that
+--- - worst-case latency, from searching each line on its own
+---
+--- Results are written to $BENCH_REGEXP_RESULT (default "bench_regexp.json").
+--- When $BENCH_REGEXP_BASELINE names such a file from an earlier run, the
+--- benchmark fails for each result that is worse than the baseline by more
+--- than $BENCH_REGEXP_THRESHOLD (default 0.2, i.e. 20%).
+describe('regexp engines', function()
+  local result_path = os.getenv('BENCH_REGEXP_RESULT') or 'bench_regexp.json'
+  local baseline_path = os.getenv('BENCH_REGEXP_BASELINE')
+  local threshold = tonumber(os.getenv('BENCH_REGEXP_THRESHOLD') or '0.2')
+  local results = {} --- @type table<string,table<string,number>>
+
+  --- @return table<string,table<string,number>>
+  local function measure(fixture, engine)
+    return n.exec_lua(function(fixture_, engine_, patterns_)
+      if fixture_ == 'compiler output' then
+        local lines = {}
+        for i = 1, 20000 do
+          if i % 50 == 0 then
+            lines[i] = ("make[%d]: Entering directory '/src/dir%d'"):format(i % 3, i)
+          else
+            local fmt = 'src/nvim/file%d.c:%d:%d: warning: unused variable x%d [-Wunused-variable]'
+            lines[i] = fmt:format(i % 97, i, i % 80, i)
+          end
+        end
+        vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+      else
+        vim.cmd.edit({ args = { fixture_ }, bang = true })
+      end
+      vim.o.regexpengine = engine_
+      local line_count = vim.api.nvim_buf_line_count(0)
+      local bytes = vim.fn.line2byte(line_count + 1) - 1
+      local out = {}
+      for _, p in ipairs(patterns_) do
+        local name, pat = p[1], p[2]
+        local allocs = vim.api.nvim__stats().alloc_count
+        local start = vim.uv.hrtime()
+        local msg = vim.fn.execute('%s/' .. vim.fn.escape(pat, '/') .. '//gne')
+        local elapsed = vim.uv.hrtime() - start
+        allocs = vim.api.nvim__stats().alloc_count - allocs
+        local matches = tonumber(msg:match('(%d+) match')) or 0
+
+        local worst = 0
+        for lnum = 1, line_count do
+          vim.api.nvim_win_set_cursor(0, { lnum, 0 })
+          local tic = vim.uv.hrtime()
+          vim.fn.search(pat, 'cnW', lnum)
+          worst = math.max(worst, vim.uv.hrtime() - tic)
+        end
+
+        out[name] = {
+          mb_per_s = bytes / 1e6 / math.max(elapsed / 1e9, 1e-9),
+          allocs = allocs,
+          worst_us = worst / 1000,
+          matches = matches,
+        }
+      end
+      return out
+    end, fixture, engine, patterns)
+  end
+
+  setup(clear)
+
+  teardown(function()
+    print('')
+    local keys = vim.tbl_keys(results)
+    table.sort(keys)
+    for _, key in ipairs(keys) do
+      local r = results[key]
+      print(
+        ('%-50s %9.2f MB/s %9d allocs %10.1f us worst %7d matches'):format(
+          key,
+          r.mb_per_s,
+          r.allocs,
+          r.worst_us,
+          r.matches
+        )
+      )
+    end
+    t.write_file(result_path, vim.json.encode(results))
+  end)
+
+  for _, fixture in ipairs(fixtures) do
+    it('on ' .. fixture, function()
+      local matches = {} --- @type table<string,integer>
+      for _, engine in ipairs({ 0, 1, 2, 3 }) do
+        for name, r in pairs(measure(fixture, engine)) do
+          results[('%s | re=%d | %s'):format(fixture, engine, name)] = r
+          -- All engines must find the same matches.
+          matches[name] = matches[name] or r.matches
+          eq(matches[name], r.matches, ('%s with re=%d'):format(name, engine))
+        end
+      end
+    end)
+  end
+
+  it('did not get slower', function()
+    if not baseline_path then
+      pending('set $BENCH_REGEXP_BASELINE to compare with an earlier run')
+      return
+    end
+    local baseline = vim.json.decode(t.read_file(baseline_path))
+    local regressions = {}
+    for key, r in pairs(results) do
+      local b = baseline[key]
+      local function regressed(fmt, ...)
+        table.insert(regressions, ('%s: ' .. fmt):format(key, ...))
+      end
+      if b then
+        if r.mb_per_s < b.mb_per_s * (1 - threshold) then
+          regressed('%.2f MB/s, was %.2f', r.mb_per_s, b.mb_per_s)
+        end
+        -- Allow for timer resolution and scheduling noise in single lines.
+        if r.worst_us > b.worst_us * (1 + threshold) + 100 then
+          regressed('%.1f us worst, was %.1f', r.worst_us, b.worst_us)
+        end
+        if r.allocs > b.allocs * (1 + threshold) + 10 then
+          regressed('%d allocs, was %d', r.allocs, b.allocs)
+        end
+      end
+    end
+    table.sort(regressions)
+    eq({}, regressions)
+  end)
+end)
@@ -792,6 +792,39 @@ describe('api/buf', function()
       eq({ 'e', 'a', 'b', 'c', 'd' }, get_lines(0, -1, true))
     end)
 
+    it('set_lines can insert many lines in the middle of the buffer', function()
+      local function make_lines(prefix, count)
+        local lines = {}
+        for i = 1, count do
+          lines[i] = prefix .. i .. (' '):rep(i % 300)
+        end
+        return lines
+      end
+      local old = make_lines('old', 300)
+      local new = make_lines('new', 6000)
+      set_lines(0, -1, true, old)
+      set_lines(150, 151, true, new)
+
+      local expected = {}
+      vim.list_extend(expected, old, 1, 150)
+      vim.list_extend(expected, new)
+      vim.list_extend(expected, old, 152, 300)
+      eq(#expected, line_count())
+      eq(expected, get_lines(0, -1, true))
+
+      local offset = 1
+      for i = 1, #expected, 97 do
+        eq(offset, fn.line2byte(i))
+        for j = i, math.min(i + 96, #expected) do
+          offset = offset + #expected[j] + 1
+        end
+      end
+      eq(offset, fn.line2byte(#expected + 1))
+
+      command('undo')
+      eq(old, get_lines(0, -1, true))
+    end)
+
     it('set_lines on alternate buffer does not access invalid line (E315)', function()
       feed_command('set hidden')
       insert('Initial file')
@@ -2186,6 +2219,38 @@ describe('api/buf', function()
       eq(0, get_offset(0, 0))
       eq(5, get_offset(0, 1))
     end)
+
+    it('works after edits all over a large buffer', function()
+      local lines = {}
+      for i = 1, 20000 do
+        lines[i] = ('x'):rep(i % 37)
+      end
+      api.nvim_buf_set_lines(0, 0, -1, true, lines)
+      -- Insert, change and delete lines at places spread over the buffer.
+      for i = 1, 200 do
+        local row = (i * 7919) % (#lines - 10)
+        if i % 3 == 0 then
+          api.nvim_buf_set_lines(0, row, row + 5, true, {})
+          for _ = 1, 5 do
+            table.remove(lines, row + 1)
+          end
+        elseif i % 3 == 1 then
+          api.nvim_buf_set_lines(0, row, row, true, { 'new', 'lines', 'here' })
+          table.insert(lines, row + 1, 'here')
+          table.insert(lines, row + 1, 'lines')
+          table.insert(lines, row + 1, 'new')
+        else
+          api.nvim_buf_set_lines(0, row, row + 1, true, { ('y'):rep(i) })
+          lines[row + 1] = ('y'):rep(i)
+        end
+        local offset = 0
+        for j = 1, row do
+          offset = offset + #lines[j] + 1
+        end
+        eq(offset, get_offset(0, row))
+        eq(row + 1, fn.byte2line(offset + 1))
+      end
+    end)
   end)
 
   describe('nvim_buf_get_var, nvim_buf_set_var, nvim_buf_del_var', function()
@@ -932,6 +932,37 @@ describe('API/win', function()
       )
     end)
 
+    it('remembers the size of lines until they change', function()
+      local lines = {}
+      for i = 1, 200 do
+        lines[i] = ('x'):rep(100)
+      end
+      api.nvim_buf_set_lines(0, 0, -1, true, lines)
+      local height = { all = 600, fill = 0, end_row = 199, end_vcol = 100 }
+      eq(height, api.nvim_win_text_height(0, {}))
+      local stats = request('nvim__stats')
+      eq(height, api.nvim_win_text_height(0, {}))
+      eq(stats.linesize_miss, request('nvim__stats').linesize_miss)
+      ok(request('nvim__stats').linesize_hit >= stats.linesize_hit + 200)
+
+      -- Only the changed line is measured again.
+      api.nvim_buf_set_lines(0, 100, 101, true, { ('x'):rep(10) })
+      height.all = 598
+      eq(height, api.nvim_win_text_height(0, {}))
+      eq(stats.linesize_miss + 1, request('nvim__stats').linesize_miss)
+
+      -- Inserting lines, changing options.
+      api.nvim_buf_set_lines(0, 0, 0, true, { ('x'):rep(50) })
+      height = { all = 600, fill = 0, end_row = 200, end_vcol = 100 }
+      eq(height, api.nvim_win_text_height(0, {}))
+      command('set number numberwidth=20')
+      height.all = 799
+      eq(height, api.nvim_win_text_height(0, {}))
+      command('set nowrap')
+      height.all = 201
+      eq(height, api.nvim_win_text_height(0, {}))
+    end)
+
     it('with two diff windows', function()
       exec([[
         set diffopt+=context:2 number
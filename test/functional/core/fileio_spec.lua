@@ -45,6 +45,8 @@ describe('fileio', function()
     os.remove('Xtest_тест.md')
     os.remove('Xtest-u8-int-max')
     os.remove('Xtest-overwrite-forced')
+    os.remove('Xtest-lazyload')
+    os.remove('Xtest-filewatch')
     rmdir('Xtest_startup_swapdir')
     rmdir('Xtest_backupdir')
     rmdir('Xtest_backupdir with spaces')
@@ -276,6 +278,8 @@ describe('fileio', function()
     local screen = Screen.new(40, 4)
     command('set shortmess-=F')
 
+    -- Don't reload the file when it is changed below.
+    command('set noautoread')
     command('e Xtest-overwrite-forced')
     screen:expect([[
       ^foobar                                  |
@@ -313,6 +317,134 @@ describe('fileio', function()
       <erwrite-forced" [noeol] 1L, 6B written |
     ]])
   end)
+
+  it("'lazyload' gives the same lines as reading the file", function()
+    clear()
+    local lines = {}
+    for i = 1, 5000 do
+      lines[i] = ('line %d '):format(i) .. ('x'):rep(i % 97) .. 'ü'
+    end
+    lines[3000] = ('long'):rep(5000)
+    lines[4000] = 'with\0nul'
+    write_file('Xtest-lazyload', table.concat(lines, '\n'))
+
+    command('set lazyload=1')
+    command('edit Xtest-lazyload')
+    eq(5000, fn.line('$'))
+    eq(lines[1], fn.getline(1))
+    eq(lines[5000], fn.getline(5000))
+    eq(lines[3000], fn.getline(3000))
+    eq('with\nnul', fn.getline(4000))
+    eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    eq(false, api.nvim_get_option_value('endofline', {}))
+    eq('utf-8', api.nvim_get_option_value('fileencoding', {}))
+    local offsets = {}
+    for _, lnum in ipairs({ 1, 2, 2999, 3001, 4999 }) do
+      offsets[lnum] = fn.line2byte(lnum)
+    end
+
+    -- Change a line and overwrite the file it was loaded from.
+    command('2999,3001delete | 1put =\'new\'')
+    command('write')
+    table.remove(lines, 3001)
+    table.remove(lines, 3000)
+    table.remove(lines, 2999)
+    table.insert(lines, 2, 'new')
+    eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+
+    -- Reading the file normally gives the same result.
+    command('set lazyload=0')
+    command('edit!')
+    eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    command('set lazyload=1')
+    command('edit!')
+    eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    eq(offsets[1], fn.line2byte(1))
+    eq(offsets[2] + 4, fn.line2byte(3))
+  end)
+
+  it("'lazyload' keeps working when the file is changed", function()
+    clear()
+    local lines = {}
+    for i = 1, 5000 do
+      lines[i] = ('line %d'):format(i)
+    end
+    write_file('Xtest-lazyload', table.concat(lines, '\n') .. '\n')
+    command('set lazyload=1')
+    command('edit Xtest-lazyload')
+    eq(lines[1], fn.getline(1))
+
+    -- Appending to the file does not change the lines.
+    write_file('Xtest-lazyload', 'appended\n', false, true)
+    eq(lines[2500], fn.getline(2500))
+    eq('', api.nvim_get_vvar('errmsg'))
+
+    -- Lines that are no longer in the file are empty.
+    write_file('Xtest-lazyload', 'short\n')
+    command('silent! let g:lines = getline(4901, 5000)')
+    eq(fn['repeat']({ '' }, 100), api.nvim_get_var('lines'))
+    matches('^Warning: The file was changed on disk', api.nvim_get_vvar('errmsg'))
+    eq(lines[1], fn.getline(1))
+    eq(5000, fn.line('$'))
+  end)
+
+  it("'memcompress' keeps the text of a buffer without a swap file", function()
+    clear()
+    command('set noswapfile memcompress=16')
+    local lines = {}
+    for i = 1, 20000 do
+      lines[i] = ('line %d '):format(i) .. ('abc'):rep(i % 30)
+    end
+    api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    local stats = request('nvim__stats')
+    ok(stats.memcompress_size > 0)
+    ok(stats.memcompress_bytes > 2 * stats.memcompress_size)
+
+    -- Changing compressed blocks.
+    command('2,3delete | 10000put =\'new\' | $delete')
+    table.remove(lines, 20000)
+    table.insert(lines, 10000, 'new')
+    table.remove(lines, 3)
+    table.remove(lines, 2)
+    eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    ok(request('nvim__stats').memcompress_miss > stats.memcompress_miss)
+
+    -- The swap file gets the text of compressed blocks.
+    command('set swapfile | preserve')
+    eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    command('set noswapfile')
+    eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+  end)
+
+  it("'filewatch' reloads a changed file for 'autoread' without checking", function()
+    clear()
+    write_file('Xtest-filewatch', 'old\n')
+    command('edit Xtest-filewatch')
+    write_file('Xtest-filewatch', 'new\n')
+    retry(nil, nil, function()
+      eq({ 'new' }, api.nvim_buf_get_lines(0, 0, -1, true))
+    end)
+
+    -- Replacing the file by another one.
+    write_file('Xtest-filewatch-new', 'renamed\n')
+    os.rename('Xtest-filewatch-new', 'Xtest-filewatch')
+    retry(nil, nil, function()
+      eq({ 'renamed' }, api.nvim_buf_get_lines(0, 0, -1, true))
+    end)
+    write_file('Xtest-filewatch', 'again\n')
+    retry(nil, nil, function()
+      eq({ 'again' }, api.nvim_buf_get_lines(0, 0, -1, true))
+    end)
+
+    -- Without 'filewatch' a change is noticed when checking.
+    command('set nofilewatch')
+    write_file('Xtest-filewatch', 'not watched\n')
+    sleep(50)
+    eq({ 'again' }, api.nvim_buf_get_lines(0, 0, -1, true))
+    command('checktime')
+    eq({ 'not watched' }, api.nvim_buf_get_lines(0, 0, -1, true))
+  end)
 end)
 
 describe('tmpdir', function()
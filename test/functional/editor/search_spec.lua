@@ -4,6 +4,9 @@ local n = require('test.functional.testnvim')()
 local clear = n.clear
 local command = n.command
 local eq = t.eq
+local eval = n.eval
+local api = n.api
+local fn = n.fn
 local pcall_err = t.pcall_err
 
 describe('search (/)', function()
@@ -13,4 +16,275 @@ describe('search (/)', function()
     eq([[Vim:E951: \% value too large]], pcall_err(command, '/\\v%18446744071562067968c'))
     eq([[Vim:E951: \% value too large]], pcall_err(command, '/\\v%2147483648c'))
   end)
+
+  it('skips lines without the text every match contains', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, {
+      'xx foobarbaz',
+      'foobaz',
+      'FOOBARBAZ',
+      'nothing here',
+      'foo bar baz',
+      'a foob',
+    })
+    local function count(pat)
+      command('let g:n = 0')
+      command('silent! g/' .. pat .. '/let g:n += 1')
+      return eval('g:n')
+    end
+    for _, engine in ipairs({ 1, 2 }) do
+      command('set noignorecase regexpengine=' .. engine)
+      eq(2, count([[foo\(bar\)\=baz]]))
+      eq(3, count([[\cfoo\(bar\)\=baz]]))
+      eq(3, count([[foo.*baz]]))
+      eq(1, count([[[fF]oo b]]))
+      eq(1, count([[\(bar\)\@<=baz]]))
+      eq(3, count([[o\{2}b]]))
+      eq(1, count([[baz\nfoo]]))
+      eq(0, count([[foo\%[bar]xyz]]))
+      command('set ignorecase')
+      eq(3, count([[FOOBA]]))
+      eq(2, count([[\CFOO\|bar ]]))
+    end
+  end)
+
+  it('finds a match across a line break with a collection', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'x', 'foobar', 'y' })
+    for _, engine in ipairs({ 1, 2, 3 }) do
+      command('set regexpengine=' .. engine)
+      for _, pat in ipairs({
+        [[x\_[ab]foobar]],
+        [[x\_[a-z]foobar]],
+        [[x\_[[:alpha:]]foobar]],
+        [[x\_[^y]foobar]],
+        [[x[\n]foobar]],
+      }) do
+        command('call cursor(3, 1)')
+        eq(1, fn.search(pat, 'w'), pat)
+        command('let g:n = 0')
+        command('silent! g/' .. pat .. '/let g:n += 1')
+        eq(1, eval('g:n'), pat)
+      end
+    end
+  end)
+
+  it('finds the same matches with the lazy DFA', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, {
+      'foo bar',
+      'foobar',
+      '  Foo_bar baz',
+      'x-foo-y',
+      'föo foo',
+      'tab\tfoo 12',
+      'END',
+      '',
+    })
+    local function matches(pat)
+      local ok, res = pcall(n.exec_capture, '%s/' .. pat .. '//gn')
+      return ok and res or 'none'
+    end
+    local patterns = {
+      [[\<foo\>]],
+      [[^foo]],
+      [[bar$]],
+      [[\<\k\+\>$]],
+      [[[a-f]o\+]],
+      [[[^ ]\+_]],
+      [[\cfoo]],
+      [[\s\zsfoo]],
+      [[\d\|D]],
+      [[^$]],
+      [[o\{2}b]],
+      [[\w-\w]],
+      [[\u\l]],
+      [[\(foo\)\@<=bar]],
+      [[\(o\)\1]],
+    }
+    for _, ic in ipairs({ 'noignorecase', 'ignorecase' }) do
+      command('set ' .. ic)
+      for _, pat in ipairs(patterns) do
+        command('set regexpengine=2')
+        local expected = matches(pat)
+        command('set regexpengine=3')
+        eq(expected, matches(pat), pat)
+        command('set regexpengine=0')
+        eq(expected, matches(pat), pat)
+      end
+    end
+    -- Changing 'iskeyword' changes what the DFA finds.
+    command('set regexpengine=3')
+    eq('4 matches on 4 lines', matches([[\<foo\>]]))
+    command('setlocal iskeyword+=-')
+    eq('3 matches on 3 lines', matches([[\<foo\>]]))
+  end)
+
+  it('finds the same matches for an alternation of words', function()
+    local lines = {
+      'if x then else end',
+      'IF elseif Else',
+      'foobar foo',
+      'ifelse while_if',
+      'x.if(while)',
+      'Kelvin \u{212A}elvin kelvin',
+      'éif ifé if\u{0301} if',
+      '',
+    }
+    api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    local patterns = {
+      [[\<\(if\|else\|elseif\|while\)\>]],
+      [[\<\%(else\|elseif\)\>]],
+      [[foo\|foobar]],
+      [[foobar\|foo]],
+      [[\cif\|kelvin]],
+      [[\(end\|then\)]],
+      [[\<\(if\|é\)]],
+    }
+    local function find(pat)
+      local res = {}
+      for lnum, line in ipairs(lines) do
+        res[#res + 1] = n.fn.matchlist(line, pat, 3)
+        api.nvim_win_set_cursor(0, { lnum, 0 })
+        res[#res + 1] = n.fn.searchpos(pat, 'cnW', lnum)
+      end
+      return res
+    end
+    for _, ic in ipairs({ 'noignorecase', 'ignorecase' }) do
+      command('set ' .. ic)
+      for _, pat in ipairs(patterns) do
+        -- An empty group at the end is not a word, the NFA does the matching.
+        command('set regexpengine=2')
+        local expected = find(pat .. [[\%(\)]])
+        for _, engine in ipairs({ 2, 3 }) do
+          command('set regexpengine=' .. engine)
+          eq(expected, find(pat), engine .. ': ' .. pat)
+        end
+      end
+    end
+  end)
+
+  it('compiles a pattern used over and over once', function()
+    local function stats()
+      local s = api.nvim__stats()
+      return { s.regcache_hit, s.regcache_miss }
+    end
+    local before = stats()
+    for _ = 1, 10 do
+      eq(1, eval([['foo bar' =~ 'o\+ b']]))
+    end
+    eq({ before[1] + 9, before[2] + 1 }, stats())
+    -- Another 'regexpengine' compiles it again.
+    command('set regexpengine=1')
+    eq(1, eval([['foo bar' =~ 'o\+ b']]))
+    eq({ before[1] + 9, before[2] + 2 }, stats())
+    -- A pattern with the cursor position is compiled each time.
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'a', 'a', 'a' })
+    api.nvim_win_set_cursor(0, { 2, 0 })
+    eq(2, n.fn.search([[\%.la]], 'nw'))
+    api.nvim_win_set_cursor(0, { 3, 0 })
+    eq(3, n.fn.search([[\%.la]], 'nw'))
+    -- Using the same pattern inside a substitute expression works.
+    eq('<x>-<y>', n.fn.substitute('x-y', [[\w]], [[\=substitute(submatch(0), '\w', '<&>', '')]], 'g'))
+  end)
+
+  it('matches with the NFA engine without allocating memory for each line', function()
+    local lines = {}
+    for i = 1, 1000 do
+      lines[i] = ('xa %d xb'):format(i)
+    end
+    api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    command('set regexpengine=2')
+    local function allocs(cmd)
+      local before = api.nvim__stats().alloc_count
+      command(cmd)
+      return api.nvim__stats().alloc_count - before
+    end
+    for _, pat in ipairs({ [[x\(a\|b\)\+y]], [[\(x\)\@<=a\+y]] }) do
+      local cmd = 'silent! %s/' .. pat .. '//gne'
+      allocs(cmd)
+      eq(true, allocs(cmd) < 100, pat)
+    end
+  end)
+
+  it(':global and :substitute find the same lines in a big buffer', function()
+    local lines = {}
+    for i = 1, 120000 do
+      if i % 1000 == 7 then
+        lines[i] = 'x foobar ' .. i
+      elseif i % 1000 == 500 then
+        lines[i] = 'FOOBAR'
+      elseif i % 7000 == 3 then
+        lines[i] = 'fööbar foobar'
+      else
+        lines[i] = 'line ' .. i
+      end
+    end
+    local function count(cmd, pat)
+      command('let g:n = 0')
+      command('silent! ' .. cmd .. '/' .. pat .. '/let g:n += 1')
+      return eval('g:n')
+    end
+    for _, engine in ipairs({ 1, 2, 3 }) do
+      api.nvim_buf_set_lines(0, 0, -1, true, lines)
+      command('set noignorecase regexpengine=' .. engine)
+      eq(138, count('g', 'foobar'))
+      eq(120000 - 138, count('v', 'foobar'))
+      eq(120, count('g', [[\<fo\+bar\> \d]]))
+      command('set ignorecase')
+      eq(258, count('g', 'foobar'))
+      eq(258, count('g', [[\<fo\+bar\>]]))
+
+      -- Lines inserted by the substitution don't change which lines match.
+      command('set noignorecase')
+      command([[%s/o\+bar \zs\d\+/\r&/]])
+      local expected = {}
+      for _, line in ipairs(lines) do
+        local head, num = line:match('^(x foobar )(%d+)$')
+        if head then
+          table.insert(expected, head)
+          table.insert(expected, num)
+        else
+          table.insert(expected, line)
+        end
+      end
+      eq(expected, api.nvim_buf_get_lines(0, 0, -1, true))
+    end
+  end)
+
+  it('searchcount() stays exact while the buffer changes', function()
+    local lines = {}
+    for i = 1, 5000 do
+      lines[i] = i % 3 == 0 and ('foo %d foo'):format(i) or ('bar %d'):format(i)
+    end
+    api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    local function expect(lnum, col)
+      local cur, total = 0, 0
+      for i, line in ipairs(api.nvim_buf_get_lines(0, 0, -1, true)) do
+        local init = 1
+        while true do
+          local s = line:find('foo', init, true)
+          if not s then
+            break
+          end
+          total = total + 1
+          if i < lnum or (i == lnum and s - 1 <= col) then
+            cur = total
+          end
+          init = s + 1
+        end
+      end
+      api.nvim_win_set_cursor(0, { lnum, col })
+      local sc = n.fn.searchcount({ recompute = 1, maxcount = 0, timeout = 0 })
+      eq({ cur, total }, { sc.current, sc.total })
+    end
+    command('let @/ = "foo"')
+    expect(1, 0)
+    expect(3000, 0)
+    expect(3000, 10)
+    command('2000,2999delete')
+    expect(2500, 0)
+    api.nvim_buf_set_lines(0, 10, 10, true, { 'foo foo foo', 'foo' })
+    expect(4000, 0)
+    n.fn.setline(13, 'no match')
+    command('undo')
+    expect(13, 2)
+  end)
 end)
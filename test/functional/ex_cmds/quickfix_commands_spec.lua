@@ -197,6 +197,51 @@ describe('quickfix', function()
     command('grep foo ' .. file)
   end)
 
+  it(':vimgrep finds the same matches with or without loading a buffer', function()
+    local dir = file_base .. '_vimgrep'
+    fn.mkdir(dir)
+    finally(function()
+      n.rmdir(dir)
+    end)
+    local files = {}
+    for i = 1, 100 do
+      local lines = { 'alpha ' .. i, ('beta foo %d foo'):format(i), '' }
+      files[#files + 1] = { ('%s/f%03d'):format(dir, i), lines }
+    end
+    -- These are loaded into a buffer: a changed buffer, CR-LF and latin1.
+    files[#files + 1] = { dir .. '/g1', { 'x foo\r', 'foo y\r' }, { 'x foo', 'foo y' } }
+    files[#files + 1] = { dir .. '/g2', { 'caf\233 foo' }, { 'café foo' } }
+    for _, f in ipairs(files) do
+      write_file(f[1], table.concat(f[2], '\n') .. '\n')
+    end
+    command('edit ' .. files[50][1])
+    fn.setline(1, 'foo changed')
+    files[50][3] = { 'foo changed', 'beta foo 50 foo' }
+    command('enew')
+
+    local expected = {}
+    for _, f in ipairs(files) do
+      for lnum, line in ipairs(f[3] or f[2]) do
+        local col = 1
+        while true do
+          local s, e = line:find('foo', col, true)
+          if s == nil then
+            break
+          end
+          expected[#expected + 1] = { f[1], lnum, s, e + 1, line }
+          col = e + 1
+        end
+      end
+    end
+    command('vimgrep /foo/gj ' .. dir .. '/*')
+    local found = {}
+    for _, item in ipairs(fn.getqflist()) do
+      found[#found + 1] = { fn.bufname(item.bufnr), item.lnum, item.col, item.end_col, item.text }
+    end
+    eq(expected, found)
+    eq(1, fn.getbufinfo(files[50][1])[1].changed)
+  end)
+
   it('jump message does not scroll with cmdheight=0 and shm+=O #29597', function()
     local screen = Screen.new(40, 6)
     command('set cmdheight=0')
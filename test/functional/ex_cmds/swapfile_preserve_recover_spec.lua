@@ -106,6 +106,20 @@ describe("preserve and (R)ecover with custom 'directory'", function()
     test_recover(swappath1)
   end)
 
+  it("with sync after 'updatetime' and SIGKILL", function()
+    local swappath1 = setup_swapname()
+    command('set updatetime=10')
+    -- The swapfile is written by a worker thread while waiting for input.
+    retry(nil, nil, function()
+      local f = assert(io.open(swappath1, 'rb'))
+      local data = f:read('*a')
+      f:close()
+      neq(nil, data:find('sometext', 1, true))
+    end)
+    eq(0, vim.uv.kill(eval('getpid()'), 'sigkill'))
+    test_recover(swappath1)
+  end)
+
   it('closing stdio channel without :preserve #22096', function()
     local swappath1 = setup_swapname()
     nvim0:close()
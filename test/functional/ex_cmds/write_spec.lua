@@ -142,6 +142,58 @@ describe(':write', function()
     end
   end)
 
+  it('writes many lines, NULs and line endings', function()
+    local lines = {}
+    for i = 1, 3000 do
+      lines[i] = ('line %d'):format(i)
+    end
+    api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    fn.setline(1500, 'with\nnul')
+    command('write ' .. fname)
+    lines[1500] = 'with\0nul'
+    eq(table.concat(lines, '\n') .. '\n', t.read_file(fname))
+
+    command('set fileformat=dos noendofline nofixendofline')
+    command('write!')
+    eq(table.concat(lines, '\r\n'), t.read_file(fname))
+
+    command('set binary')
+    command('write!')
+    eq(table.concat(lines, '\n'), t.read_file(fname))
+  end)
+
+  it("writes in the background with 'asyncwrite'", function()
+    local lines = {}
+    for i = 1, 3000 do
+      lines[i] = ('line %d'):format(i)
+    end
+    write_file(fname, table.concat(lines, '\n') .. '\n')
+    command('set asyncwrite=1')
+    command('edit ' .. fname)
+    command('let g:written = 0 | autocmd BufWritePost * let g:written += 1')
+    command('1,10delete')
+    fn.setline(1500, 'with\nnul')
+    command('write')
+    -- Changing the buffer while it is written does not change the file.
+    api.nvim_buf_set_lines(0, 0, 1, true, { 'changed' })
+    t.retry(nil, nil, function()
+      eq(1, eval('g:written'))
+    end)
+    local written = vim.list_slice(lines, 11)
+    written[1490] = 'with\0nul'
+    eq(table.concat(written, '\n') .. '\n', t.read_file(fname))
+    eq(true, api.nvim_get_option_value('modified', {}))
+    eq(nil, vim.uv.fs_stat(fname .. '.nvimwrite0'))
+
+    command('write')
+    t.retry(nil, nil, function()
+      eq(2, eval('g:written'))
+    end)
+    written[1] = 'changed'
+    eq(table.concat(written, '\n') .. '\n', t.read_file(fname))
+    eq(false, api.nvim_get_option_value('modified', {}))
+  end)
+
   it('errors out correctly', function()
     skip(is_ci('cirrus'))
     command('let $HOME=""')
@@ -633,6 +633,26 @@ describe('TUI', function()
     end)
   end)
 
+  it('counts bytes written to the terminal in nvim__stats()', function()
+    local function tui_stats()
+      return child_exec_lua([[
+        return vim.rpcrequest(vim.api.nvim_list_uis()[1].chan, 'nvim__stats')
+      ]])
+    end
+    local before = tui_stats()
+    feed_data('ifoobar')
+    screen:expect([[
+      foobar^                                            |
+      {100:~                                                 }|*3
+      {3:[No Name] [+]                                     }|
+      {5:-- INSERT --}                                      |
+      {5:-- TERMINAL --}                                    |
+    ]])
+    local after = tui_stats()
+    ok(after.tui_frames > before.tui_frames)
+    ok(after.tui_bytes > before.tui_bytes)
+  end)
+
   it('accepts resize while pager is active', function()
     child_session:request(
       'nvim_exec2',
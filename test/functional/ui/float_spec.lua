@@ -44,6 +44,29 @@ describe('float window', function()
     eq(1000, fn.win_getid())
   end)
 
+  it("reuses blended attrs with 'winblend'", function()
+    local screen = Screen.new(40, 8)
+    insert(('background text\n'):rep(6))
+    local buf = api.nvim_create_buf(false, true)
+    api.nvim_buf_set_lines(buf, 0, -1, true, { 'float', 'float' })
+    local win = api.nvim_open_win(
+      buf,
+      false,
+      { relative = 'editor', row = 1, col = 5, width = 20, height = 2, style = 'minimal' }
+    )
+    api.nvim_set_option_value('winblend', 30, { win = win })
+    screen:expect({ any = 'float' })
+    local stats = api.nvim__stats()
+    command('redraw!')
+    screen:expect_unchanged()
+    local new_stats = api.nvim__stats()
+    -- All blends were done before, and runs of cells with the same attrs
+    -- only look them up once.
+    eq(stats.blendcache_miss, new_stats.blendcache_miss)
+    t.ok(new_stats.blendcache_hit > stats.blendcache_hit)
+    t.ok(new_stats.blendcache_hit - stats.blendcache_hit < 40)
+  end)
+
   it('win_execute() should work', function()
     local buf = api.nvim_create_buf(false, false)
     api.nvim_buf_set_lines(buf, 0, -1, true, { 'the floatwin', 'abc', 'def' })
@@ -573,6 +573,24 @@ local function screen_tests(linegrid)
       ]])
     end)
 
+    it('can be resized a few cells at a time', function()
+      screen:try_resize(25, 5)
+      feed('iresize<Esc>')
+      screen:expect([[
+        resiz^e                   |
+        {0:~                        }|*3
+                                 |
+      ]])
+      screen:try_resize(27, 6)
+      screen:try_resize(23, 4)
+      screen:try_resize(26, 5)
+      screen:expect([[
+        resiz^e                    |
+        {0:~                         }|*3
+                                  |
+      ]])
+    end)
+
     it('has minimum width/height values', function()
       feed('iresize')
       screen:try_resize(1, 1)
@@ -738,6 +756,57 @@ local function screen_tests(linegrid)
                                                            |
     ]])
   end)
+
+  it('does not draw rows again that would look the same', function()
+    insert([[
+      one
+      two
+      three
+      four]])
+    screen:expect([[
+      one                                                  |
+      two                                                  |
+      three                                                |
+      fou^r                                                 |
+      {0:~                                                    }|*9
+                                                           |
+    ]])
+    local stats = api.nvim__stats()
+    api.nvim__redraw({ valid = false, flush = true })
+    screen:expect_unchanged()
+    local new_stats = api.nvim__stats()
+    -- Only the cursor line is drawn again.
+    eq(stats.rows_drawn + 1, new_stats.rows_drawn)
+    eq(stats.rows_skipped + 3, new_stats.rows_skipped)
+
+    -- A match changes how lines are drawn.
+    screen:add_extra_attr_ids({ [100] = { foreground = Screen.colors.Red } })
+    command('highlight Fixed guifg=Red')
+    fn.matchadd('Fixed', 'o')
+    screen:expect([[
+      {100:o}ne                                                  |
+      tw{100:o}                                                  |
+      three                                                |
+      f{100:o}u^r                                                 |
+      {0:~                                                    }|*9
+                                                           |
+    ]])
+    eq(new_stats.rows_skipped, api.nvim__stats().rows_skipped)
+  end)
+
+  it("combines redraws for events with 'redrawrate'", function()
+    command('set redrawrate=2')
+    local stats = api.nvim__stats()
+    for i = 1, 5 do
+      api.nvim_buf_set_lines(0, 0, -1, true, { 'line ' .. i })
+    end
+    screen:expect([[
+      ^line 5                                               |
+      {0:~                                                    }|*12
+                                                           |
+    ]])
+    t.ok(api.nvim__stats().frames_coalesced > stats.frames_coalesced)
+  end)
 end
 
 describe('Screen (char-based)', function()
@@ -722,4 +722,48 @@ describe('search highlighting', function()
       {6:t/(l)ast/scroll up(^E)/down(^Y)}^         |
     ]])
   end)
+
+  it('does not search lines that did not change again', function()
+    local lines = {}
+    for i = 1, 100 do
+      lines[i] = ('line %d'):format(i)
+    end
+    n.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    command([[let @/ = '\d\+']])
+    local function grid(top, changed)
+      local rows = {}
+      for i = top, top + 5 do
+        local row = changed and changed[i] or ('line {10:%d}'):format(i)
+        local width = #row:gsub('{%d+:(.-)}', '%1')
+        rows[#rows + 1] = (i == top and '^' or '') .. row .. (' '):rep(40 - width) .. '|'
+      end
+      return table.concat(rows, '\n') .. '\n' .. (' '):rep(40) .. '|\n'
+    end
+    screen:expect(grid(1))
+
+    local stats = n.api.nvim__stats()
+    command('redraw!')
+    screen:expect(grid(1))
+    eq(stats.hlcache_miss, n.api.nvim__stats().hlcache_miss)
+    eq(true, n.api.nvim__stats().hlcache_hit > stats.hlcache_hit)
+
+    fn.setline(3, 'line x 33 4')
+    screen:expect(grid(1, { [3] = 'line x {10:33} {10:4}' }))
+    feed('<C-E>')
+    screen:expect(grid(2, { [3] = 'line x {10:33} {10:4}' }))
+    feed('<C-Y>gg')
+    screen:expect(grid(1, { [3] = 'line x {10:33} {10:4}' }))
+    -- Lines below a deleted line were searched before.
+    stats = n.api.nvim__stats()
+    command('1delete | redraw!')
+    screen:expect(grid(1, {
+      [1] = 'line {10:2}',
+      [2] = 'line x {10:33} {10:4}',
+      [3] = 'line {10:4}',
+      [4] = 'line {10:5}',
+      [5] = 'line {10:6}',
+      [6] = 'line {10:7}',
+    }))
+    eq(stats.hlcache_miss, n.api.nvim__stats().hlcache_miss)
+  end)
 end)
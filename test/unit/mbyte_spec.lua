@@ -348,6 +348,32 @@ describe('mbyte', function()
     -- stylua: ignore end
   end)
 
+  describe('utf_valid_len', function()
+    local function valid_len(str)
+      return tonumber(lib.utf_valid_len(to_cstr(str), #str))
+    end
+
+    itp('accepts valid UTF-8', function()
+      eq(0, valid_len(''))
+      eq(5, valid_len('hello'))
+      eq(100, valid_len(('x'):rep(100)))
+      eq(10, valid_len('aé€𐍈'))
+      eq(42, valid_len(('x'):rep(33) .. 'é€𐍈'))
+    end)
+
+    itp('stops at an illegal byte', function()
+      eq(3, valid_len('abc
+8def'))
+      eq(1, valid_len('a­'))
+      eq(20, valid_len(('x'):rep(20) .. '95x' .. ('y'):rep(20)))
+    end)
+
+    itp('stops at an incomplete sequence at the end', function()
+      eq(3, valid_len('abcX'))
+      eq(19, valid_len(('x'):rep(19) .. ' '))
+    end)
+  end)
+
   describe('utf_fold', function()
     itp('does not crash with surrogates #30527', function()
       eq(0xddfb, lib.utf_fold(0xddfb)) -- low surrogate, invalid as a character
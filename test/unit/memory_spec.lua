@@ -48,3 +48,77 @@ describe('xstrlcat()', function()
     eq('ABCיהZd', test_xstrlcat('ABCיהZ', 'defgiיהZ', 10))
   end)
 end)
+
+describe('xmemcspn()', function()
+  local function test_xmemcspn(str, c1, c2)
+    return tonumber(cimp.xmemcspn(to_cstr(str), c1:byte(), c2:byte(), #str))
+  end
+
+  itp('finds NUL or one of two chars', function()
+    eq(3, test_xmemcspn('abc\ndef', '\n', '\n'))
+    eq(3, test_xmemcspn('abc\0def', '\n', '\n'))
+    eq(2, test_xmemcspn('ab\rc\ndef', '\r', '\n'))
+    eq(0, test_xmemcspn('\nabc', '\r', '\n'))
+    eq(0, test_xmemcspn('', '\r', '\n'))
+  end)
+
+  itp('returns the size when there is none', function()
+    eq(3, test_xmemcspn('abc', '\n', '\n'))
+    eq(100, test_xmemcspn(('x'):rep(100), '\r', '\n'))
+  end)
+
+  itp('finds chars after a long stretch without them', function()
+    for i = 0, 40 do
+      eq(i, test_xmemcspn(('x'):rep(i) .. '\n' .. ('y'):rep(40), '\n', '\n'))
+      eq(i, test_xmemcspn(('x'):rep(i) .. '\0' .. ('y'):rep(40), '\r', '\n'))
+    end
+  end)
+end)
+
+describe('xmemfind()', function()
+  local function test_xmemfind(str, needle, ic)
+    local s = to_cstr(str)
+    local p = cimp.xmemfind(s, #str, needle, #needle, ic or false)
+    if p == nil then
+      return nil
+    end
+    return tonumber(ffi.cast('char *', p) - s)
+  end
+
+  itp('finds text', function()
+    eq(3, test_xmemfind('abcdef', 'def'))
+    eq(0, test_xmemfind('abc', 'abc'))
+    eq(0, test_xmemfind('abc', ''))
+    eq(1, test_xmemfind('a\0bc', '\0b'))
+    eq(nil, test_xmemfind('abc', 'abcd'))
+    eq(nil, test_xmemfind('abcdef', 'dex'))
+    eq(nil, test_xmemfind('', 'a'))
+  end)
+
+  itp('ignores the case of ASCII letters', function()
+    eq(nil, test_xmemfind('xxABCxx', 'abc'))
+    eq(2, test_xmemfind('xxABCxx', 'abc', true))
+    eq(2, test_xmemfind('xxaBcxx', 'AbC', true))
+    eq(nil, test_xmemfind('xx@bcxx', 'abc', true))
+    eq(1, test_xmemfind('x[1]', '[1]', true))
+    eq(nil, test_xmemfind('x{1}', '[1]', true))
+  end)
+
+  itp('finds text after a long stretch without it', function()
+    for i = 0, 40 do
+      eq(i, test_xmemfind(('x'):rep(i) .. 'xyz' .. ('y'):rep(40), 'xyz'))
+      eq(i, test_xmemfind(('a'):rep(i) .. 'ABab' .. ('b'):rep(40), 'abab', true))
+      eq(nil, test_xmemfind(('a'):rep(i) .. 'ab' .. ('b'):rep(i), 'aab' .. ('b'):rep(i + 1)))
+    end
+  end)
+end)
+
+describe('xmemisascii()', function()
+  itp('finds bytes with the high bit set', function()
+    for i = 0, 40 do
+      local s = ('x'):rep(i)
+      eq(true, cimp.xmemisascii(to_cstr(s .. '\0y'), i + 2))
+      eq(false, cimp.xmemisascii(to_cstr(s .. 'é' .. s), 2 * i + 2))
+    end
+  end)
+end)